@@ -0,0 +1,47 @@
+#include <chrono>
+#include <iostream>
+
+#include "audio/FFTBackend.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+const ddsp::FFTBackend kBackends[] = { ddsp::FFTBackend::kJuce, ddsp::FFTBackend::kRadix2 };
+
+const char* backendName (ddsp::FFTBackend backend)
+{
+    return backend == ddsp::FFTBackend::kJuce ? "JUCE" : "radix-2";
+}
+
+} // namespace
+
+TEST (FFTBackendTest, BenchmarkBackends)
+{
+    constexpr int numRounds = 2000;
+
+    for (int order : { 7, 9, 11 })
+    {
+        for (const auto backend : kBackends)
+        {
+            auto fft = ddsp::createFFT (order, backend);
+            std::vector<float> buffer (2 * fft->getSize(), 0.f);
+            buffer[1] = 1.f;
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < numRounds; ++round)
+            {
+                fft->performRealOnlyForwardTransform (buffer.data());
+                fft->performRealOnlyInverseTransform (buffer.data());
+            }
+            const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            const double perRound_us = elapsed.count() / numRounds;
+
+            EXPECT_TRUE (std::isfinite (buffer[1]));
+            std::cout << "Size " << (1 << order) << ", " << backendName (backend) << ": " << perRound_us
+                      << " us per forward and inverse transform" << std::endl;
+        }
+    }
+    std::cout << "Fastest backend: " << backendName (ddsp::getFastestFFTBackend()) << std::endl;
+}
@@ -0,0 +1,189 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <numeric>
+
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/OscillatorBank.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+struct OscillatorBankFixture
+{
+    OscillatorBankFixture (int nh, int nos) : numHarmonics (nh), numSamples (nos)
+    {
+        juce::Random random (1234);
+        phases.resize (numSamples);
+        amplitudes.resize (numHarmonics * numSamples);
+        output.resize (numSamples);
+        activeHarmonics.resize (numHarmonics);
+        std::iota (activeHarmonics.begin(), activeHarmonics.end(), 0);
+
+        // A 440 Hz glide at 16 kHz that has already accumulated a few seconds of phase.
+        float phase = 1000.f;
+        for (auto& p : phases)
+        {
+            phase += juce::MathConstants<float>::twoPi * 440.f / ddsp::kModelSampleRate_Hz;
+            p = phase;
+        }
+        for (int j = 0; j < numHarmonics; ++j)
+        {
+            const float level = random.nextFloat() / static_cast<float> (numHarmonics);
+            std::fill (amplitudes.begin() + j * numSamples, amplitudes.begin() + (j + 1) * numSamples, level);
+        }
+    }
+
+    void process (ddsp::OscillatorBank& bank)
+    {
+        bank.process (phases.data(),
+                      amplitudes.data(),
+                      numSamples,
+                      activeHarmonics.data(),
+                      static_cast<int> (activeHarmonics.size()),
+                      output.data(),
+                      numSamples);
+    }
+
+    float amplitude (int harmonic, int sample) const { return amplitudes[harmonic * numSamples + sample]; }
+
+    int numHarmonics, numSamples;
+    std::vector<float> phases, amplitudes, output;
+    std::vector<int> activeHarmonics;
+};
+
+} // namespace
+
+TEST (OscillatorBankTest, BenchmarkAgainstDirectSin)
+{
+    constexpr int numHops = 2000;
+    OscillatorBankFixture fixture (ddsp::kHarmonicsSize, ddsp::kModelHopSize);
+    ddsp::OscillatorBank bank;
+    juce::dsp::Matrix<float> sinusoids (fixture.numSamples, fixture.numHarmonics);
+
+    const auto directStart = std::chrono::steady_clock::now();
+    for (int hop = 0; hop < numHops; ++hop)
+        for (int i = 0; i < fixture.numSamples; ++i)
+            for (int j = 0, harmonicOrder = 1; j < fixture.numHarmonics; j++, harmonicOrder++)
+                sinusoids (i, j) = std::sin (fixture.phases[i] * harmonicOrder) * fixture.amplitude (j, i);
+    const auto directEnd = std::chrono::steady_clock::now();
+
+    for (int hop = 0; hop < numHops; ++hop)
+        fixture.process (bank);
+    const auto bankEnd = std::chrono::steady_clock::now();
+
+    const auto perHop_us = [] (auto duration)
+    { return std::chrono::duration<double, std::micro> (duration).count() / numHops; };
+    const double direct_us = perHop_us (directEnd - directStart);
+    const double bank_us = perHop_us (bankEnd - directEnd);
+
+    std::cout << "Direct sin: " << direct_us << " us/hop, OscillatorBank: " << bank_us
+              << " us/hop, speedup: " << direct_us / bank_us << "x" << std::endl;
+    EXPECT_GT (sinusoids (0, 0) + fixture.output[0], -2.f);
+}
+
+TEST (HarmonicSynthesizerTest, BenchmarkRender)
+{
+    constexpr int numHops = 2000;
+    ddsp::HarmonicSynthesizer synthesizer (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    std::vector<float> distribution (ddsp::kHarmonicsSize), harmonics;
+    juce::Random random (42);
+
+    float checksum = 0.f;
+    const auto start = std::chrono::steady_clock::now();
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        for (auto& value : distribution)
+            value = random.nextFloat();
+        harmonics = distribution;
+        checksum += synthesizer.render (harmonics, 0.5f, 110.f + (hop % 100))[0];
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    std::cout << "HarmonicSynthesizer::render: "
+              << std::chrono::duration<double, std::micro> (end - start).count() / numHops << " us/hop" << std::endl;
+    EXPECT_TRUE (std::isfinite (checksum));
+}
+
+// Renders a bank of independent synthesizers, as a session with many plug-in instances would,
+// and reports the share of real time one core spends on them in each mode.
+TEST (HarmonicSynthesizerTest, BenchmarkConcurrentInstances)
+{
+    constexpr int numInstances = 16;
+    constexpr int numHops = 500;
+    constexpr double hopDuration_us = 1e6 * ddsp::kModelHopSize / ddsp::kModelSampleRate_Hz;
+
+    for (auto mode : { ddsp::HarmonicSynthesizer::SynthesisMode::kOscillatorBank,
+                       ddsp::HarmonicSynthesizer::SynthesisMode::kWavetable })
+    {
+        std::vector<std::unique_ptr<ddsp::HarmonicSynthesizer>> synthesizers;
+        for (int i = 0; i < numInstances; ++i)
+        {
+            synthesizers.push_back (std::make_unique<ddsp::HarmonicSynthesizer> (
+                ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz));
+            synthesizers.back()->setSynthesisMode (mode);
+        }
+
+        std::vector<float> distribution (ddsp::kHarmonicsSize), harmonics;
+        juce::Random random (42);
+        float checksum = 0.f;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            for (int i = 0; i < numInstances; ++i)
+            {
+                for (auto& value : distribution)
+                    value = random.nextFloat();
+                harmonics = distribution;
+                checksum += synthesizers[i]->render (harmonics, 0.5f, 55.f * (i + 1))[0];
+            }
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const double perHop_us = std::chrono::duration<double, std::micro> (end - start).count() / numHops;
+        std::cout << numInstances << " instances, "
+                  << (mode == ddsp::HarmonicSynthesizer::SynthesisMode::kWavetable ? "wavetable" : "oscillator bank")
+                  << ": " << perHop_us << " us/hop, " << 100.0 * perHop_us / hopDuration_us << "% of real time"
+                  << std::endl;
+        EXPECT_TRUE (std::isfinite (checksum));
+    }
+}
+
+TEST (HarmonicSynthesizerTest, BenchmarkStaticAgainstDynamicExtents)
+{
+    constexpr int numHops = 2000;
+
+    const auto benchmark = [] (ddsp::HarmonicSynthesizerBase& synthesizer)
+    {
+        std::vector<float> distribution (ddsp::kHarmonicsSize), harmonics;
+        juce::Random random (42);
+        float checksum = 0.f;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            for (auto& value : distribution)
+                value = random.nextFloat();
+            harmonics = distribution;
+            checksum += synthesizer.render (harmonics, 0.5f, 110.f + (hop % 100))[0];
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        EXPECT_TRUE (std::isfinite (checksum));
+        return std::chrono::duration<double, std::micro> (end - start).count() / numHops;
+    };
+
+    ddsp::HarmonicSynthesizer dynamicSynthesizer (
+        ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    auto staticSynthesizer = std::make_unique<ddsp::StaticHarmonicSynthesizer> (
+        ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+
+    const double dynamic_us = benchmark (dynamicSynthesizer);
+    const double static_us = benchmark (*staticSynthesizer);
+    std::cout << "HarmonicSynthesizer: " << dynamic_us << " us/hop, StaticHarmonicSynthesizer: " << static_us
+              << " us/hop" << std::endl;
+}
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <iostream>
+
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/NoiseSynthesizer.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+// Compares the old output path, synthesis at the model rate followed by resampling to the host rate,
+// with synthesis directly at the host rate, for the CPU time per hop and the latency added.
+TEST (HostRateSynthesisTest, BenchmarkAgainstResampledModelRate)
+{
+    constexpr int numHops = 500;
+
+    for (double sampleRate : { 44100.0, 48000.0, 96000.0 })
+    {
+        const int hopSize = static_cast<int> (sampleRate * ddsp::kModelHopSize / ddsp::kModelSampleRate_Hz);
+
+        std::vector<float> distribution (ddsp::kHarmonicsSize), harmonics;
+        std::vector<float> noiseMagnitudes (ddsp::kNoiseAmpsSize);
+        juce::Random random (42);
+        for (auto& value : distribution)
+            value = random.nextFloat();
+        for (auto& value : noiseMagnitudes)
+            value = random.nextFloat();
+
+        // Before: model-rate synthesis and a windowed sinc resampler.
+        auto modelRateHarmonics = std::make_unique<ddsp::StaticHarmonicSynthesizer> (
+            ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+        ddsp::StaticNoiseSynthesizer modelRateNoise (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        juce::WindowedSincInterpolator interpolator;
+        std::vector<float> synthesisBuffer (ddsp::kModelHopSize), outputBuffer (hopSize);
+        float checksum = 0.f;
+
+        const auto resampledStart = std::chrono::steady_clock::now();
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            harmonics = distribution;
+            const auto harmonicOutput = modelRateHarmonics->render (harmonics, 0.5f, 220.f);
+            const auto noiseOutput = modelRateNoise.render (noiseMagnitudes);
+            for (int i = 0; i < ddsp::kModelHopSize; ++i)
+                synthesisBuffer[i] = harmonicOutput[i] + noiseOutput[i];
+            interpolator.process (
+                ddsp::kModelSampleRate_Hz / sampleRate, synthesisBuffer.data(), outputBuffer.data(), hopSize);
+            checksum += outputBuffer[0];
+        }
+        const auto resampledEnd = std::chrono::steady_clock::now();
+
+        // After: both synthesizers render the host-rate hop directly.
+        auto hostRateHarmonics = std::make_unique<ddsp::HostRateHarmonicSynthesizer> (
+            ddsp::kHarmonicsSize, hopSize, static_cast<float> (sampleRate));
+        ddsp::HostRateNoiseSynthesizer hostRateNoise (ddsp::kNoiseAmpsSize, hopSize);
+
+        const auto directStart = std::chrono::steady_clock::now();
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            harmonics = distribution;
+            const auto harmonicOutput = hostRateHarmonics->render (harmonics, 0.5f, 220.f);
+            const auto noiseOutput = hostRateNoise.render (noiseMagnitudes);
+            for (int i = 0; i < hopSize; ++i)
+                outputBuffer[i] = harmonicOutput[i] + noiseOutput[i];
+            checksum += outputBuffer[0];
+        }
+        const auto directEnd = std::chrono::steady_clock::now();
+
+        const auto perHop_us = [] (auto duration)
+        { return std::chrono::duration<double, std::micro> (duration).count() / numHops; };
+        const double resamplerLatency_ms =
+            1000.0 * juce::WindowedSincInterpolator::getBaseLatency() / ddsp::kModelSampleRate_Hz;
+
+        std::cout << sampleRate << " Hz: resampled " << perHop_us (resampledEnd - resampledStart) << " us/hop, "
+                  << resamplerLatency_ms << " ms resampler latency; direct " << perHop_us (directEnd - directStart)
+                  << " us/hop, no added latency" << std::endl;
+        EXPECT_TRUE (std::isfinite (checksum));
+    }
+}
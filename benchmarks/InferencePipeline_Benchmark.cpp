@@ -0,0 +1,121 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "PluginProcessor.h"
+#include "audio/tflite/InferenceScheduler.h"
+#include "audio/tflite/ModelLibrary.h"
+#include "audio/tflite/PredictControlsModel.h"
+#include "util/InputUtils.h"
+
+#include <gtest/gtest.h>
+
+TEST (EndToEndTest, ScalesAcrossInstances)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr double duration_s = 2.0;
+    constexpr int numBlocks = static_cast<int> (duration_s * sampleRate / blockSize);
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+    juce::SharedResourcePointer<ddsp::InferenceScheduler> scheduler;
+
+    for (int numInstances : { 1, 4, 16 })
+    {
+        std::vector<std::unique_ptr<DDSPAudioProcessor>> processors;
+        for (int i = 0; i < numInstances; ++i)
+        {
+            processors.push_back (std::make_unique<DDSPAudioProcessor> (/*singleThreaded=*/false));
+            processors.back()->prepareToPlay (sampleRate, blockSize);
+        }
+
+        // Play the instances like a host would, one block each per block period.
+        const auto before = scheduler->getStatistics();
+        const auto start = std::chrono::steady_clock::now();
+        juce::AudioBuffer<float> block (1, blockSize);
+        juce::MidiBuffer midiBuffer;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (auto& processor : processors)
+            {
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    const int n = b * blockSize + i;
+                    const auto phase = juce::MathConstants<double>::twoPi * 220.0 * n / sampleRate;
+                    block.setSample (0, i, 0.3f * static_cast<float> (std::sin (phase)));
+                }
+                processor->processBlock (block, midiBuffer);
+            }
+            std::this_thread::sleep_until (start + std::chrono::duration<double> ((b + 1) * blockSize / sampleRate));
+        }
+        const auto after = scheduler->getStatistics();
+
+        for (auto& processor : processors)
+        {
+            processor->releaseResources();
+        }
+
+        const auto numHops = after.numHopsRendered - before.numHopsRendered;
+        std::cout << numInstances << " instances on " << scheduler->getNumWorkers() << " workers: "
+                  << numHops / duration_s << " hops/s, " << after.numDeadlineMisses - before.numDeadlineMisses
+                  << " deadline misses in " << after.numRuns - before.numRuns << " runs, "
+                  << after.numBatchedRuns - before.numBatchedRuns << " of them batched" << std::endl;
+        EXPECT_GT (numHops, 0);
+    }
+}
+
+TEST (PredictControlsModelTest, BenchmarkBatchedAgainstSingleCalls)
+{
+    constexpr int numStreams = 4;
+    constexpr int numHops = 200;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    ddsp::ModelLibrary modelLibrary;
+    const auto& modelInfo = modelLibrary.getModelList()[0];
+    const auto shared = ddsp::PredictControlsModel::getShared (modelInfo);
+
+    // Each stream on a model of its own, and all of them through the shared one.
+    std::vector<std::unique_ptr<ddsp::PredictControlsModel>> singles;
+    std::array<ddsp::PredictControlsModel::State, numStreams> states {};
+    std::array<ddsp::AudioFeatures, numStreams> features;
+    std::array<ddsp::SynthesisControls, numStreams> singleControls, batchedControls;
+    std::array<ddsp::PredictControlsModel::Request, numStreams> requests;
+    for (int i = 0; i < numStreams; ++i)
+    {
+        singles.push_back (std::make_unique<ddsp::PredictControlsModel> (modelInfo));
+        requests[i] = { &features[i], &states[i], &batchedControls[i] };
+    }
+
+    std::chrono::steady_clock::duration singleTime {}, batchedTime {};
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        for (int i = 0; i < numStreams; ++i)
+        {
+            features[i].f0_hz = 110.0f * std::pow (2.0f, i + 2.0f * hop / numHops);
+            features[i].f0_norm = ddsp::normalizedPitch (features[i].f0_hz);
+            features[i].loudness_norm = ddsp::normalizedLoudness (-20.0f - 5.0f * i);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numStreams; ++i)
+        {
+            singles[i]->call (features[i], singleControls[i]);
+        }
+        singleTime += std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        shared->callBatch (requests.data(), numStreams);
+        batchedTime += std::chrono::steady_clock::now() - start;
+    }
+
+    std::cout << modelInfo.name << ": " << numStreams << " streams "
+              << (shared->supportsBatching() ? "batched" : "one at a time (no batch dimension)") << ", "
+              << std::chrono::duration<double, std::micro> (singleTime).count() / numHops << " us per hop alone, "
+              << std::chrono::duration<double, std::micro> (batchedTime).count() / numHops << " us together"
+              << std::endl;
+}
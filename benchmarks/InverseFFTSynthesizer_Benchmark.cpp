@@ -0,0 +1,82 @@
+#include <chrono>
+#include <iostream>
+
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/InverseFFTSynthesizer.h"
+#include "audio/tflite/ModelLibrary.h"
+#include "audio/tflite/PredictControlsModel.h"
+#include "util/Constants.h"
+#include "util/InputUtils.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+double signalToNoiseRatio_dB (double signalEnergy, double noiseEnergy)
+{
+    return 10.0 * std::log10 (signalEnergy / std::max (noiseEnergy, 1e-30));
+}
+
+} // namespace
+
+// Drives both engines with the controls every embedded model predicts for a pitch and loudness sweep,
+// and reports how close the two renders are and how long each engine takes per hop.
+TEST (InverseFFTSynthesizerTest, BenchmarkAgainstHarmonicSynthesizerAcrossModels)
+{
+    constexpr int numHops = 500;
+
+    // For message manager, alert windows, etc.
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    ddsp::ModelLibrary modelLibrary;
+    for (const auto& modelInfo : modelLibrary.getModelList())
+    {
+        ddsp::PredictControlsModel model (modelInfo);
+        ddsp::HarmonicSynthesizer oscillatorBank (
+            ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+        ddsp::InverseFFTSynthesizer inverseFFT (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+
+        ddsp::AudioFeatures features;
+        ddsp::SynthesisControls controls;
+        std::chrono::steady_clock::duration oscillatorBankTime {}, inverseFFTTime {};
+        double signalEnergy = 0.0, noiseEnergy = 0.0;
+
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            // A slow two-octave pitch sweep under a constant loudness.
+            features.f0_hz = 110.f * std::pow (2.f, 2.f * hop / numHops);
+            features.f0_norm = ddsp::normalizedPitch (features.f0_hz);
+            features.loudness_norm = ddsp::normalizedLoudness (-30.f);
+            model.call (features, controls);
+
+            auto harmonics = controls.harmonics;
+            const auto start = std::chrono::steady_clock::now();
+            const auto& reference = oscillatorBank.render (harmonics, controls.amplitude, controls.f0_hz);
+            const auto middle = std::chrono::steady_clock::now();
+            const auto& output = inverseFFT.render (controls.harmonics, controls.amplitude, controls.f0_hz);
+            const auto end = std::chrono::steady_clock::now();
+
+            oscillatorBankTime += middle - start;
+            inverseFFTTime += end - middle;
+
+            for (int i = 0; i < ddsp::kModelHopSize; ++i)
+            {
+                ASSERT_TRUE (std::isfinite (output[i]));
+                signalEnergy += reference[i] * reference[i];
+                noiseEnergy += (output[i] - reference[i]) * (output[i] - reference[i]);
+            }
+        }
+
+        const auto perHop_us = [] (auto duration)
+        { return std::chrono::duration<double, std::micro> (duration).count() / numHops; };
+        const double snr_dB = signalToNoiseRatio_dB (signalEnergy, noiseEnergy);
+
+        std::cout << modelInfo.name << ": SNR " << snr_dB << " dB, HarmonicSynthesizer "
+                  << perHop_us (oscillatorBankTime) << " us/hop, InverseFFTSynthesizer " << perHop_us (inverseFFTTime)
+                  << " us/hop" << std::endl;
+
+        // The engines interpolate controls differently within a hop, so only gross errors are caught here.
+        EXPECT_GT (snr_dB, 10.0) << modelInfo.name;
+    }
+}
@@ -0,0 +1,38 @@
+#include <chrono>
+#include <iostream>
+
+#include "audio/NoiseGenerator.h"
+
+#include <gtest/gtest.h>
+
+TEST (NoiseGeneratorTest, BenchmarkAgainstJuceRandom)
+{
+    constexpr int numSamples = 1024, numBlocks = 20000;
+    std::vector<float> buffer (numSamples);
+    float checksum = 0.f;
+
+    juce::Random random (42);
+    auto start = std::chrono::steady_clock::now();
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        for (auto& sample : buffer)
+            sample = juce::jmap (random.nextFloat(), -1.f, 1.f);
+        checksum += buffer[0];
+    }
+    const double random_us =
+        std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numBlocks;
+
+    ddsp::NoiseGenerator generator (42);
+    start = std::chrono::steady_clock::now();
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        generator.fillUniform (buffer.data(), numSamples);
+        checksum += buffer[0];
+    }
+    const double generator_us =
+        std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numBlocks;
+
+    EXPECT_TRUE (std::isfinite (checksum));
+    std::cout << numSamples << " samples: juce::Random " << random_us << " us, NoiseGenerator " << generator_us
+              << " us" << std::endl;
+}
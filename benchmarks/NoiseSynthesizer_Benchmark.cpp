@@ -0,0 +1,161 @@
+#include <chrono>
+#include <iostream>
+
+#include "audio/NoiseSynthesizer.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<float> randomMagnitudes (juce::Random& random)
+{
+    std::vector<float> magnitudes (ddsp::kNoiseAmpsSize);
+    for (auto& value : magnitudes)
+        value = random.nextFloat();
+    return magnitudes;
+}
+
+} // namespace
+
+TEST (NoiseSynthesizerTest, BenchmarkStaticAgainstDynamicExtents)
+{
+    constexpr int numHops = 2000;
+
+    const auto benchmark = [] (auto& synthesizer)
+    {
+        juce::Random random (42);
+        const auto magnitudes = randomMagnitudes (random);
+        float checksum = 0.f;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int hop = 0; hop < numHops; ++hop)
+            checksum += synthesizer.render (magnitudes)[0];
+        const auto end = std::chrono::steady_clock::now();
+
+        EXPECT_TRUE (std::isfinite (checksum));
+        return std::chrono::duration<double, std::micro> (end - start).count() / numHops;
+    };
+
+    ddsp::NoiseSynthesizer dynamicSynthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    ddsp::StaticNoiseSynthesizer staticSynthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+
+    const double dynamic_us = benchmark (dynamicSynthesizer);
+    const double static_us = benchmark (staticSynthesizer);
+    std::cout << "NoiseSynthesizer: " << dynamic_us << " us/hop, StaticNoiseSynthesizer: " << static_us << " us/hop"
+              << std::endl;
+}
+
+// Times the convolution stage of the synthesizer, with the filter held steady so it is designed once,
+// against the previous per-hop design: a circular convolution of a buffer full of fresh noise, a
+// forward FFT of the filter on every hop, and a crop that drops the filter tail.
+TEST (NoiseSynthesizerTest, BenchmarkOverlapAddAgainstCircularConvolution)
+{
+    constexpr int numHops = 5000;
+    constexpr int convolutionOrder = 9, convolutionSize = 1 << convolutionOrder;
+    constexpr int impulseResponseSize = 2 * (ddsp::kNoiseAmpsSize - 1);
+
+    juce::Random random (42);
+    const auto magnitudes = randomMagnitudes (random);
+
+    ddsp::StaticNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    synthesizer.reset();
+    float checksum = 0.f;
+    auto start = std::chrono::steady_clock::now();
+    for (int hop = 0; hop < numHops; ++hop)
+        checksum += synthesizer.render (magnitudes)[0];
+    const double overlapAdd_us =
+        std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numHops;
+
+    juce::dsp::FFT fft (convolutionOrder);
+    std::vector<float> impulseResponse (2 * convolutionSize, 0.f), spectrum (2 * convolutionSize);
+    std::vector<float> whiteNoise (2 * convolutionSize), output (ddsp::kModelHopSize);
+    for (int i = 0; i < impulseResponseSize; ++i)
+        impulseResponse[i] = random.nextFloat() - 0.5f;
+
+    start = std::chrono::steady_clock::now();
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        for (auto& sample : whiteNoise)
+            sample = juce::jmap (random.nextFloat(), -1.f, 1.f);
+        std::copy (impulseResponse.begin(), impulseResponse.end(), spectrum.begin());
+
+        fft.performRealOnlyForwardTransform (whiteNoise.data());
+        fft.performRealOnlyForwardTransform (spectrum.data());
+        auto noiseBins = reinterpret_cast<std::complex<float>*> (whiteNoise.data());
+        auto filterBins = reinterpret_cast<std::complex<float>*> (spectrum.data());
+        for (int i = 0; i < convolutionSize / 2 + 1; ++i)
+            noiseBins[i] *= filterBins[i];
+        fft.performRealOnlyInverseTransform (whiteNoise.data());
+
+        const auto first = whiteNoise.begin() + (impulseResponseSize - 1) / 2 - 1;
+        std::copy (first, first + ddsp::kModelHopSize, output.begin());
+        checksum += output[0];
+    }
+    const double circular_us =
+        std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numHops;
+
+    EXPECT_TRUE (std::isfinite (checksum));
+    std::cout << "Overlap-add: " << overlapAdd_us << " us/hop, per-hop circular convolution: " << circular_us
+              << " us/hop" << std::endl;
+}
+
+TEST (NoiseSynthesizerTest, BenchmarkSpectralAgainstTimeDomain)
+{
+    constexpr int numHops = 5000;
+    juce::Random random (23);
+    const auto steady = randomMagnitudes (random);
+
+    for (const auto mode : { ddsp::NoiseSynthesisMode::kTimeDomain, ddsp::NoiseSynthesisMode::kSpectral })
+    {
+        ddsp::StaticNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        synthesizer.setSynthesisMode (mode);
+        synthesizer.reset();
+        float checksum = 0.f;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int hop = 0; hop < numHops; ++hop)
+            checksum += synthesizer.render (steady)[0];
+        const double perHop_us =
+            std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numHops;
+
+        const bool spectral = mode == ddsp::NoiseSynthesisMode::kSpectral;
+        EXPECT_TRUE (std::isfinite (checksum));
+        std::cout << (spectral ? "Spectral" : "Time-domain") << " noise: " << perHop_us << " us/hop, "
+                  << static_cast<double> (synthesizer.getNumForwardFFTs()) / numHops << " forward and "
+                  << static_cast<double> (synthesizer.getNumInverseFFTs()) / numHops << " inverse FFTs/hop"
+                  << std::endl;
+    }
+}
+
+TEST (NoiseSynthesizerTest, BenchmarkMatrixAgainstInverseFFTDesign)
+{
+    constexpr int numHops = 5000;
+
+    for (int hopSize : { ddsp::kModelHopSize, 960 })
+    {
+        for (const auto design : { ddsp::ImpulseResponseDesign::kInverseFFT, ddsp::ImpulseResponseDesign::kMatrix })
+        {
+            // Design a filter on every hop.
+            ddsp::HostRateNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, hopSize);
+            synthesizer.setImpulseResponseDesign (design);
+            synthesizer.setImpulseResponseCacheThreshold (0.f);
+            synthesizer.reset();
+            juce::Random random (31);
+            const auto magnitudes = randomMagnitudes (random);
+            float checksum = 0.f;
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int hop = 0; hop < numHops; ++hop)
+                checksum += synthesizer.render (magnitudes)[0];
+            const double perHop_us =
+                std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numHops;
+
+            EXPECT_TRUE (std::isfinite (checksum));
+            std::cout << "Hop size " << hopSize << ", "
+                      << (design == ddsp::ImpulseResponseDesign::kMatrix ? "matrix" : "inverse FFT")
+                      << " design: " << perHop_us << " us/hop" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <iostream>
+
+#include "audio/PolyphaseResampler.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<float> sine (double frequency_Hz, double sampleRate, int numSamples)
+{
+    std::vector<float> samples (numSamples);
+    for (int n = 0; n < numSamples; ++n)
+        samples[n] = static_cast<float> (std::sin (juce::MathConstants<double>::twoPi * frequency_Hz * n / sampleRate));
+    return samples;
+}
+
+// Time per hop of converting a 48 kHz stream to the model rate a hop at a time.
+template <typename Convert>
+double benchmarkHops (Convert&& convert)
+{
+    constexpr int numHops = 2000;
+    const auto start = std::chrono::steady_clock::now();
+    for (int hop = 0; hop < numHops; ++hop)
+        convert();
+    return std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count() / numHops;
+}
+
+} // namespace
+
+TEST (PolyphaseResamplerTest, BenchmarkAgainstJuceInterpolators)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double ratio = sampleRate / ddsp::kModelSampleRate_Hz;
+    const int hopSize = static_cast<int> (sampleRate * ddsp::kModelHopSize / ddsp::kModelSampleRate_Hz);
+    const int frameSize = static_cast<int> (sampleRate * ddsp::kModelFrameSize / ddsp::kModelSampleRate_Hz);
+    const auto input = sine (440.0, sampleRate, frameSize);
+    std::vector<float> output (ddsp::kModelFrameSize);
+
+    // What InferencePipeline used to do: resample the whole frame again every hop.
+    juce::WindowedSincInterpolator frameInterpolator;
+    const double frame_us = benchmarkHops (
+        [&] { frameInterpolator.process (ratio, input.data(), output.data(), ddsp::kModelFrameSize); });
+
+    // The JUCE interpolators fed only the new hop. Neither filters out what aliases on the way down.
+    juce::WindowedSincInterpolator sincInterpolator;
+    const double sinc_us =
+        benchmarkHops ([&] { sincInterpolator.process (ratio, input.data(), output.data(), ddsp::kModelHopSize); });
+    juce::LagrangeInterpolator lagrangeInterpolator;
+    const double lagrange_us =
+        benchmarkHops ([&] { lagrangeInterpolator.process (ratio, input.data(), output.data(), ddsp::kModelHopSize); });
+    EXPECT_TRUE (std::isfinite (output[0]));
+
+    std::cout << "Resampling a hop at 48 kHz: " << frame_us << " us for the whole frame (WindowedSinc), " << sinc_us
+              << " us WindowedSinc, " << lagrange_us << " us Lagrange" << std::endl;
+
+    for (const auto quality :
+         { ddsp::ResamplerQuality::kDraft, ddsp::ResamplerQuality::kStandard, ddsp::ResamplerQuality::kHigh })
+    {
+        ddsp::PolyphaseResampler resampler (sampleRate, ddsp::kModelSampleRate_Hz, quality);
+        const double polyphase_us =
+            benchmarkHops ([&] { resampler.process (input.data(), hopSize, output.data()); });
+        EXPECT_TRUE (std::isfinite (output[0]));
+        std::cout << "Polyphase, " << resampler.getNumTapsPerPhase() << " taps: " << polyphase_us << " us ("
+                  << frame_us / polyphase_us << "x faster than the whole frame)" << std::endl;
+    }
+}
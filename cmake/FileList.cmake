@@ -21,12 +21,28 @@ set(DDSP_SOURCES
 
     # audio
     src/audio/AudioRingBuffer.h
+    src/audio/AudioRingBuffer.cpp
+    src/audio/FillLevelController.h
+    src/audio/FillLevelController.cpp
     src/audio/MidiInputProcessor.h
     src/audio/MidiInputProcessor.cpp
+    src/audio/FFTBackend.h
+    src/audio/FFTBackend.cpp
+    src/audio/HarmonicSynthesizerBase.h
+    src/audio/PhaseAccumulator.h
+    src/audio/PhaseAccumulator.cpp
+    src/audio/OscillatorBank.h
+    src/audio/OscillatorBank.cpp
     src/audio/HarmonicSynthesizer.h
     src/audio/HarmonicSynthesizer.cpp
+    src/audio/InverseFFTSynthesizer.h
+    src/audio/InverseFFTSynthesizer.cpp
+    src/audio/NoiseGenerator.h
+    src/audio/NoiseGenerator.cpp
     src/audio/NoiseSynthesizer.h
     src/audio/NoiseSynthesizer.cpp
+    src/audio/PolyphaseResampler.h
+    src/audio/PolyphaseResampler.cpp
 
     # tflite
     src/audio/tflite/ModelBase.h
@@ -37,6 +53,10 @@ set(DDSP_SOURCES
     src/audio/tflite/FeatureExtractionModel.cpp
     src/audio/tflite/PredictControlsModel.h
     src/audio/tflite/PredictControlsModel.cpp
+    src/audio/tflite/InferenceScheduler.h
+    src/audio/tflite/InferenceScheduler.cpp
+    src/audio/tflite/ModelHandoff.h
+    src/audio/tflite/ModelHandoff.cpp
     src/audio/tflite/InferencePipeline.h
     src/audio/tflite/InferencePipeline.cpp
 
@@ -59,7 +79,10 @@ set(DDSP_SOURCES
 
     # util
     src/util/Constants.h
+    src/util/Extent.h
     src/util/InputUtils.h
+    src/util/LightweightSemaphore.h
+    src/util/SingleSlotQueue.h
 )
 
 set(DDSP_ASSETS
@@ -90,4 +113,33 @@ set(DDSP_ASSETS
 set(DDSP_TEST_SOURCES
 
     tests/InferencePipeline_Test.cpp
+    tests/AudioRingBuffer_Test.cpp
+    tests/FFTBackend_Test.cpp
+    tests/FillLevelController_Test.cpp
+    tests/HarmonicSynthesizer_Test.cpp
+    tests/InverseFFTSynthesizer_Test.cpp
+    tests/NoiseGenerator_Test.cpp
+    tests/NoiseSynthesizer_Test.cpp
+    tests/PhaseAccumulator_Test.cpp
+    tests/PolyphaseResampler_Test.cpp
+    tests/LightweightSemaphore_Test.cpp
+    tests/InferenceScheduler_Test.cpp
+    tests/SingleSlotQueue_Test.cpp
+)
+
+set(DDSP_ALLOCATION_TEST_SOURCES
+
+    tests/ModelHandoff_Test.cpp
+)
+
+set(DDSP_BENCHMARK_SOURCES
+
+    benchmarks/FFTBackend_Benchmark.cpp
+    benchmarks/HarmonicSynthesizer_Benchmark.cpp
+    benchmarks/HostRateSynthesis_Benchmark.cpp
+    benchmarks/InferencePipeline_Benchmark.cpp
+    benchmarks/InverseFFTSynthesizer_Benchmark.cpp
+    benchmarks/NoiseGenerator_Benchmark.cpp
+    benchmarks/NoiseSynthesizer_Benchmark.cpp
+    benchmarks/PolyphaseResampler_Benchmark.cpp
 )
\ No newline at end of file
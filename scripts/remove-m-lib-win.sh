@@ -34,7 +34,9 @@ for PLUGIN_TARGET in DDSPEffect_VST3 \
                      DDSPEffect_Standalone \
                      DDSPSynth_VST3 \
                      DDSPSynth_Standalone \
-                     DDSPUnitTestRunner
+                     DDSPUnitTestRunner \
+                     DDSPAllocationTestRunner \
+                     DDSPBenchmarkRunner
 do
     grep -rl ';m.lib;' ${PLUGIN_TARGET}.vcxproj | xargs sed -i 's/;m.lib;/;/g'
 done
@@ -34,13 +34,17 @@ DDSPAudioProcessor::DDSPAudioProcessor (bool st)
                           ),
 #endif
       singleThreaded (st),
-      tree (*this, nullptr, "PARAMETERS", createParameterLayout()),
+      tree (*this,
+            nullptr,
+            "PARAMETERS",
+            createParameterLayout ([this] (int mode, int) { return getLatencyModeLabel (mode); })),
       ddspPipeline (tree)
 {
     ddspPipeline.reset();
+    tree.addParameterListener ("LatencyMode", this);
 }
 
-DDSPAudioProcessor::~DDSPAudioProcessor() {}
+DDSPAudioProcessor::~DDSPAudioProcessor() { tree.removeParameterListener ("LatencyMode", this); }
 
 //==============================================================================
 const juce::String DDSPAudioProcessor::getName() const { return JucePlugin_Name; }
@@ -91,12 +95,14 @@ void DDSPAudioProcessor::changeProgramName (int index, const juce::String& newNa
 //==============================================================================
 void DDSPAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // The pitch detection model needs a full 64ms frame to get an accurate reading.
-    // Therefore the pulgin latency is set to 64ms.
-    setLatencySamples ((kTotalInferenceLatency_ms / 1000.0f) * sampleRate);
-
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
     reverb.setSampleRate (sampleRate);
 
+    const auto latencyMode = static_cast<int> (*tree.getRawParameterValue ("LatencyMode"));
+    ddspPipeline.setLatencyMode (static_cast<LatencyMode> (latencyMode));
+    // Hosts prepare again whenever they switch between playback and bouncing.
+    ddspPipeline.setOfflineRendering (isNonRealtime());
     ddspPipeline.prepareToPlay (sampleRate, samplesPerBlock);
 
     if (isNonRealtime())
@@ -110,21 +116,31 @@ void DDSPAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
         loadModel (currentModel);
     }
 
-    if (! singleThreaded)
+    if (! singleThreaded && ! isNonRealtime())
     {
-        ddspPipeline.startTimer (kModelInferenceTimerCallbackInterval_ms);
+        ddspPipeline.startWorker();
     }
+
+    // The pitch detection model needs a full analysis frame to get an accurate reading, 64ms in the
+    // standard latency mode. The plugin latency is that frame plus the output the worker keeps buffered.
+    setLatencySamples (ddspPipeline.getLatencySamples());
 }
 
 void DDSPAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    preparedBlockSize = 0;
 
-    // Only engage timer thread if not in single-threaded mode.
+    // Only engage the worker thread if not in single-threaded mode.
     if (! singleThreaded)
     {
-        ddspPipeline.stopTimer();
+        ddspPipeline.stopWorker();
+    }
+
+    if (isNonRealtime())
+    {
+        DBG ("Offline real-time factor: " << ddspPipeline.getOfflineRealTimeFactor());
     }
 }
 
@@ -174,11 +190,11 @@ void DDSPAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
     buffer.clear();
 
     // Synchronous model inference block.
-    if (singleThreaded || isNonRealtime())
+    if (isNonRealtime() || ! ddspPipeline.isWorkerRunning())
     {
-        // We have to stop the timer here and not in PrepareToPlay so it will block the
-        // Audio thread until it is done with the last timer callback.
-        ddspPipeline.stopTimer();
+        // We have to stop the worker here and not in PrepareToPlay so it will block the
+        // Audio thread until it is done with the last hop it was rendering.
+        ddspPipeline.stopWorker();
         ddspPipeline.render();
     }
 
@@ -213,6 +229,30 @@ void DDSPAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
     }
 }
 
+void DDSPAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    jassert (parameterID == "LatencyMode");
+    const auto mode = static_cast<LatencyMode> (static_cast<int> (newValue));
+    if (preparedBlockSize == 0 || mode == ddspPipeline.getLatencyMode())
+        return;
+
+    // The mode is not automatable, so it changes from an editor or a restored state rather than during
+    // playback. Holding the callback lock keeps processBlock() out while the pipeline is rebuilt.
+    suspendProcessing (true);
+    prepareToPlay (preparedSampleRate, preparedBlockSize);
+    suspendProcessing (false);
+}
+
+juce::String DDSPAudioProcessor::getLatencyModeLabel (int mode) const
+{
+    static const juce::StringArray modeNames { "Standard", "Low", "Lowest" };
+    if (preparedBlockSize == 0)
+        return modeNames[mode];
+
+    const int latency = ddspPipeline.getLatencySamples (static_cast<LatencyMode> (mode));
+    return juce::String (juce::roundToInt (1000.0 * latency / preparedSampleRate)) + " ms";
+}
+
 //==============================================================================
 bool DDSPAudioProcessor::hasEditor() const
 {
@@ -276,7 +316,8 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() { return new DDSPAudioP
 
 void DDSPAudioProcessor::loadModel (int modelIdx)
 {
-    modelLoaded = false;
+    // The pipeline swaps models without interrupting the audio, so only the first load has to be
+    // waited for.
     ddspPipeline.loadModel (modelLibrary.getModelList()[modelIdx]);
     currentModel = modelIdx;
     modelLoaded = true;
@@ -290,6 +331,8 @@ float DDSPAudioProcessor::getRMS() const { return ddspPipeline.getRMS(); }
 
 float DDSPAudioProcessor::getPitch() const { return ddspPipeline.getPitch(); }
 
+double DDSPAudioProcessor::getOfflineRealTimeFactor() const { return ddspPipeline.getOfflineRealTimeFactor(); }
+
 float DDSPAudioProcessor::getPitchOffset() const { return *tree.getRawParameterValue ("InputPitch"); }
 
 float DDSPAudioProcessor::getLoudnessOffset() const { return *tree.getRawParameterValue ("InputGain"); }
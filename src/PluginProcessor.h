@@ -23,7 +23,7 @@ limitations under the License.
 //==============================================================================
 /**
 */
-class DDSPAudioProcessor : public juce::AudioProcessor
+class DDSPAudioProcessor : public juce::AudioProcessor, private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     //==============================================================================
@@ -71,14 +71,25 @@ public:
     float getPitch() const;
     float getPitchOffset() const;
     float getLoudnessOffset() const;
+    // Time spent rendering divided by the audio rendered, while bouncing.
+    double getOfflineRealTimeFactor() const;
     const ddsp::PredictControlsModel::Metadata getPredictControlsModelMetadata() const;
     juce::AudioProcessorValueTreeState& getValueTree();
     ddsp::ModelLibrary& getModelLibrary();
 
 private:
+    // Prepares again for a new latency mode, if prepared already, which reports the new latency to the host.
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    // The latency in milliseconds `mode` gives as prepared, or the name of the mode until prepared.
+    juce::String getLatencyModeLabel (int mode) const;
+
     bool singleThreaded = false;
-    bool modelLoaded = false;
-    int currentModel = 0;
+    // Rate and block size of the last prepareToPlay(); zero once the resources are released.
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+    // Models may be loaded from any thread while the audio thread plays.
+    std::atomic<bool> modelLoaded = false;
+    std::atomic<int> currentModel = 0;
 
     // Param state.
     juce::AudioProcessorValueTreeState tree;
@@ -0,0 +1,199 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "audio/AudioRingBuffer.h"
+
+namespace ddsp
+{
+
+AudioRingBuffer::AudioRingBuffer (int numChannels, int c) { setSize (numChannels, c); }
+
+void AudioRingBuffer::setSize (int numChannels, int c)
+{
+    jassert (numChannels > 0 && c > 0);
+    capacity = c;
+    storage.setSize (numChannels, capacity);
+    reset();
+}
+
+void AudioRingBuffer::reset()
+{
+    storage.clear();
+    writePosition = 0;
+    readPosition = 0;
+    numOverflows = 0;
+    numUnderflows = 0;
+}
+
+int AudioRingBuffer::getNumChannels() const { return storage.getNumChannels(); }
+
+int AudioRingBuffer::getCapacity() const { return capacity; }
+
+int AudioRingBuffer::getFreeSpace() const
+{
+    const auto used = writePosition.load (std::memory_order_relaxed) - readPosition.load (std::memory_order_acquire);
+    return capacity - static_cast<int> (used);
+}
+
+int AudioRingBuffer::getNumReady() const
+{
+    return static_cast<int> (writePosition.load (std::memory_order_acquire)
+                             - readPosition.load (std::memory_order_relaxed));
+}
+
+template <typename Sample>
+AudioRingBuffer::View<Sample>
+    AudioRingBuffer::viewAt (Sample* const* channels, juce::uint64 position, int numSamples) const
+{
+    const int start = static_cast<int> (position % static_cast<juce::uint64> (capacity));
+    const int size1 = std::min (numSamples, capacity - start);
+    return { channels, storage.getNumChannels(), start, size1, numSamples - size1 };
+}
+
+AudioRingBuffer::WriteView AudioRingBuffer::prepareToWrite (int numSamples)
+{
+    numSamples = juce::jlimit (0, getFreeSpace(), numSamples);
+    return viewAt (storage.getArrayOfWritePointers(), writePosition.load (std::memory_order_relaxed), numSamples);
+}
+
+void AudioRingBuffer::finishedWrite (int numSamples)
+{
+    jassert (numSamples <= getFreeSpace());
+    writePosition.store (writePosition.load (std::memory_order_relaxed) + static_cast<juce::uint64> (numSamples),
+                         std::memory_order_release);
+}
+
+int AudioRingBuffer::push (const juce::AudioBuffer<float>& source, int numSamples)
+{
+    if (numSamples < 0)
+        numSamples = source.getNumSamples();
+    jassert (numSamples <= source.getNumSamples());
+
+    const auto view = prepareToWrite (numSamples);
+    if (view.getNumSamples() < numSamples)
+        ++numOverflows;
+
+    for (int channel = 0; channel < view.getNumChannels(); ++channel)
+    {
+        const float* input = source.getReadPointer (std::min (channel, source.getNumChannels() - 1));
+        const auto first = view.getFirstBlock (channel);
+        const auto second = view.getSecondBlock (channel);
+        std::copy (input, input + first.size(), first.begin());
+        std::copy (input + first.size(), input + first.size() + second.size(), second.begin());
+    }
+
+    finishedWrite (view.getNumSamples());
+    return view.getNumSamples();
+}
+
+int AudioRingBuffer::pushSilence (int numSamples)
+{
+    const auto view = prepareToWrite (numSamples);
+    if (view.getNumSamples() < numSamples)
+        ++numOverflows;
+
+    for (int channel = 0; channel < view.getNumChannels(); ++channel)
+    {
+        std::ranges::fill (view.getFirstBlock (channel), 0.f);
+        std::ranges::fill (view.getSecondBlock (channel), 0.f);
+    }
+
+    finishedWrite (view.getNumSamples());
+    return view.getNumSamples();
+}
+
+AudioRingBuffer::ReadView AudioRingBuffer::prepareToRead (int numSamples, int offset) const
+{
+    jassert (offset >= 0);
+    numSamples = juce::jlimit (0, std::max (0, getNumReady() - offset), numSamples);
+    return viewAt (storage.getArrayOfReadPointers(),
+                   readPosition.load (std::memory_order_relaxed) + static_cast<juce::uint64> (offset),
+                   numSamples);
+}
+
+void AudioRingBuffer::finishedRead (int numSamples)
+{
+    jassert (numSamples <= getNumReady());
+    readPosition.store (readPosition.load (std::memory_order_relaxed) + static_cast<juce::uint64> (numSamples),
+                        std::memory_order_release);
+}
+
+int AudioRingBuffer::copy (juce::AudioBuffer<float>& destination) const
+{
+    const auto view = prepareToRead (destination.getNumSamples());
+    for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+    {
+        const int ringChannel = std::min (channel, view.getNumChannels() - 1);
+        const auto first = view.getFirstBlock (ringChannel);
+        const auto second = view.getSecondBlock (ringChannel);
+        float* output = destination.getWritePointer (channel);
+        output = std::copy (first.begin(), first.end(), output);
+        std::copy (second.begin(), second.end(), output);
+    }
+    return view.getNumSamples();
+}
+
+int AudioRingBuffer::read (juce::AudioBuffer<float>& destination)
+{
+    const int numRead = copy (destination);
+    if (numRead < destination.getNumSamples())
+    {
+        ++numUnderflows;
+        destination.clear (numRead, destination.getNumSamples() - numRead);
+    }
+
+    finishedRead (numRead);
+    return numRead;
+}
+
+int AudioRingBuffer::readSkipping (juce::AudioBuffer<float>& destination, int numToSkip, int fadeLength)
+{
+    const int numSamples = destination.getNumSamples();
+    numToSkip = juce::jlimit (0, std::max (0, getNumReady() - numSamples), numToSkip);
+    if (numToSkip == 0)
+    {
+        read (destination);
+        return 0;
+    }
+
+    fadeLength = std::min (fadeLength, numSamples);
+    const auto view = prepareToRead (numToSkip + numSamples);
+    for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+    {
+        const int ringChannel = std::min (channel, view.getNumChannels() - 1);
+        const auto first = view.getFirstBlock (ringChannel);
+        const auto second = view.getSecondBlock (ringChannel);
+        const int firstSize = static_cast<int> (first.size());
+        const auto at = [&] (int i) { return i < firstSize ? first[i] : second[i - firstSize]; };
+
+        float* output = destination.getWritePointer (channel);
+        for (int i = 0; i < fadeLength; ++i)
+        {
+            const float gain = (i + 1.f) / (fadeLength + 1.f);
+            output[i] = at (i) + gain * (at (i + numToSkip) - at (i));
+        }
+        for (int i = fadeLength; i < numSamples; ++i)
+            output[i] = at (i + numToSkip);
+    }
+
+    finishedRead (numToSkip + numSamples);
+    return numToSkip;
+}
+
+juce::int64 AudioRingBuffer::getNumOverflows() const { return numOverflows.load(); }
+
+juce::int64 AudioRingBuffer::getNumUnderflows() const { return numUnderflows.load(); }
+
+} // namespace ddsp
@@ -13,64 +13,114 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-
 #pragma once
 
+#include <span>
+
 #include "JuceHeader.h"
 
 namespace ddsp
 {
 
-class AudioRingBuffer : public juce::AbstractFifo
+// Lock-free single-producer, single-consumer FIFO of multichannel audio.
+// The producer and the consumer work on the ring's storage in place through views, so no audio has
+// to pass through an intermediate buffer. The read and write positions live on separate cache lines
+// so that the two threads do not contend for one. Positions only ever grow, which keeps a full ring
+// distinct from an empty one without a spare slot.
+class AudioRingBuffer
 {
 public:
-    AudioRingBuffer (int bufferSize) : AbstractFifo (bufferSize) { buffer.setSize (1, bufferSize); }
-    // Copies the incoming buffer into the ring buffer.
-    void push (const juce::AudioBuffer<float>& bufferToAdd)
+    // A run of samples in the ring, which wraps around the end of the storage into a second block.
+    template <typename Sample>
+    class View
     {
-        int start1, size1, start2, size2;
-        prepareToWrite (bufferToAdd.getNumSamples(), start1, size1, start2, size2);
-        if (size1 > 0)
+    public:
+        View() = default;
+        View (Sample* const* c, int nc, int s, int s1, int s2)
+            : channels (c), numChannels (nc), start (s), size1 (s1), size2 (s2)
         {
-            buffer.copyFrom (0, start1, bufferToAdd.getReadPointer (0), size1);
         }
-        if (size2 > 0)
-        {
-            buffer.copyFrom (0, start2, bufferToAdd.getReadPointer (0, size1), size2);
-        }
-        finishedWrite (size1 + size2);
-    }
-    // Advances the read pointer by numSamples. Does not clear the samples or return them.
-    void pop (int numSamples)
-    {
-        int start1, size1, start2, size2;
-        prepareToRead (numSamples, start1, size1, start2, size2);
-        finishedRead (size1 + size2);
-    }
-    // Copies the front of the buffer into bufferToFill.
-    void copy (juce::AudioBuffer<float>& bufferToFill)
-    {
-        int start1, size1, start2, size2;
-        prepareToRead (bufferToFill.getNumSamples(), start1, size1, start2, size2);
-        if (size1 > 0)
+
+        int getNumChannels() const { return numChannels; }
+        int getNumSamples() const { return size1 + size2; }
+        bool isContiguous() const { return size2 == 0; }
+
+        std::span<Sample> getFirstBlock (int channel) const
         {
-            bufferToFill.copyFrom (0, 0, buffer.getReadPointer (0, start1), size1);
+            return { channels[channel] + start, static_cast<size_t> (size1) };
         }
-        if (size2 > 0)
+        std::span<Sample> getSecondBlock (int channel) const
         {
-            bufferToFill.copyFrom (0, size1, buffer.getReadPointer (0, start2), size2);
+            return { channels[channel], static_cast<size_t> (size2) };
         }
-    }
 
-    // Zero-pads the buffer.
-    void clear()
-    {
-        reset();
-        buffer.clear();
-    }
+    private:
+        Sample* const* channels = nullptr;
+        int numChannels = 0, start = 0, size1 = 0, size2 = 0;
+    };
+
+    using WriteView = View<float>;
+    using ReadView = View<const float>;
+
+    AudioRingBuffer (int numChannels, int capacity);
+
+    // Room for a block being written, a block being read, and `latency` samples waiting in between.
+    static int capacityFor (int maxBlockSize, int latency) { return latency + 2 * maxBlockSize; }
+
+    // Reallocates and empties the ring. Neither side may be running.
+    void setSize (int numChannels, int capacity);
+    // Empties the ring and clears the counters. Neither side may be running.
+    void reset();
+
+    int getNumChannels() const;
+    int getCapacity() const;
+
+    // Producer side.
+    int getFreeSpace() const;
+    // A view of up to `numSamples` free samples to fill, and the commit that publishes them.
+    WriteView prepareToWrite (int numSamples);
+    void finishedWrite (int numSamples);
+    // Copies the first `numSamples` samples of `source` (all of it by default). Channels the source
+    // does not have are copied from its last channel. Samples that do not fit are dropped and counted
+    // as an overflow. Returns the number of samples written.
+    int push (const juce::AudioBuffer<float>& source, int numSamples = -1);
+    int pushSilence (int numSamples);
+
+    // Consumer side.
+    int getNumReady() const;
+    // A view of up to `numSamples` of the oldest samples after the first `offset`, and the release
+    // that frees samples from the front.
+    ReadView prepareToRead (int numSamples, int offset = 0) const;
+    void finishedRead (int numSamples);
+    // Copies the oldest samples into `destination` without consuming them. Returns the number copied.
+    int copy (juce::AudioBuffer<float>& destination) const;
+    // Moves the oldest samples into `destination`. When fewer are ready, the rest of it is cleared and
+    // the shortfall is counted as an underflow. Returns the number of samples read.
+    int read (juce::AudioBuffer<float>& destination);
+    // Like read(), but drops `numToSkip` samples from the front of the ring first, crossfading the
+    // first `fadeLength` samples of `destination` from the dropped samples into the ones that follow.
+    // Drops only what is ready beyond `destination`. Returns the number of samples dropped.
+    int readSkipping (juce::AudioBuffer<float>& destination, int numToSkip, int fadeLength);
+
+    // Calls to push() that dropped samples and calls to read() that came up short since the last reset().
+    juce::int64 getNumOverflows() const;
+    juce::int64 getNumUnderflows() const;
 
 private:
-    juce::AudioBuffer<float> buffer;
+    static constexpr size_t kCacheLine_bytes = 64;
+
+    template <typename Sample>
+    View<Sample> viewAt (Sample* const* channels, juce::uint64 position, int numSamples) const;
+
+    juce::AudioBuffer<float> storage;
+    int capacity = 0;
+
+    // Written by the producer only.
+    alignas (kCacheLine_bytes) std::atomic<juce::uint64> writePosition = { 0 };
+    std::atomic<juce::int64> numOverflows = { 0 };
+    // Written by the consumer only.
+    alignas (kCacheLine_bytes) std::atomic<juce::uint64> readPosition = { 0 };
+    std::atomic<juce::int64> numUnderflows = { 0 };
 };
 
 } // namespace ddsp
@@ -0,0 +1,290 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*
+The bundled engine computes a real FFT of size N as a complex FFT of size N / 2
+over the even and odd samples packed as real and imaginary parts, followed by
+one pass that separates the two spectra and combines them. The complex FFT is
+an iterative radix-2 transform on split real and imaginary arrays, with the
+twiddle factors of every stage stored contiguously, so each butterfly loop is
+a unit-stride loop over plain floats that compilers vectorize. The inverse runs
+the same steps backwards, using the conjugation identity for the inverse
+complex FFT.
+
+The spectrum kernels spell out the complex product rather than using
+std::complex's operator*, which must handle infinities and NaNs per IEEE and
+compiles to a library call per element without -ffast-math.
+*/
+
+#include "audio/FFTBackend.h"
+
+#include <chrono>
+
+namespace ddsp
+{
+
+namespace
+{
+    class JuceFFTEngine : public FFTEngine
+    {
+    public:
+        explicit JuceFFTEngine (int order) : fft (order) {}
+
+        int getSize() const override { return fft.getSize(); }
+        void performRealOnlyForwardTransform (float* data) override
+        {
+            fft.performRealOnlyForwardTransform (data, true);
+        }
+        void performRealOnlyInverseTransform (float* data) override { fft.performRealOnlyInverseTransform (data); }
+
+    private:
+        juce::dsp::FFT fft;
+    };
+
+    class Radix2FFTEngine : public FFTEngine
+    {
+    public:
+        explicit Radix2FFTEngine (int order)
+            : size (1 << order),
+              complexSize (size / 2),
+              real (static_cast<size_t> (complexSize)),
+              imag (static_cast<size_t> (complexSize)),
+              bitReversed (static_cast<size_t> (complexSize)),
+              splitReal (static_cast<size_t> (complexSize / 2 + 1)),
+              splitImag (static_cast<size_t> (complexSize / 2 + 1))
+        {
+            jassert (order >= 2);
+            const int complexOrder = order - 1;
+
+            for (int i = 0; i < complexSize; ++i)
+            {
+                int reversed = 0;
+                for (int bit = 0; bit < complexOrder; ++bit)
+                    reversed |= ((i >> bit) & 1) << (complexOrder - 1 - bit);
+                bitReversed[static_cast<size_t> (i)] = reversed;
+            }
+
+            // Stage s combines pairs of transforms of size h = 2^s and needs e^(-i pi j / h) for j < h.
+            for (int h = 1; h < complexSize; h *= 2)
+            {
+                for (int j = 0; j < h; ++j)
+                {
+                    const double angle = -juce::MathConstants<double>::pi * j / h;
+                    twiddleReal.push_back (static_cast<float> (std::cos (angle)));
+                    twiddleImag.push_back (static_cast<float> (std::sin (angle)));
+                }
+            }
+
+            // e^(-2 pi i k / N) for separating the spectra of the even and odd samples.
+            for (int k = 0; k <= complexSize / 2; ++k)
+            {
+                const double angle = -juce::MathConstants<double>::twoPi * k / size;
+                splitReal[static_cast<size_t> (k)] = static_cast<float> (std::cos (angle));
+                splitImag[static_cast<size_t> (k)] = static_cast<float> (std::sin (angle));
+            }
+        }
+
+        int getSize() const override { return size; }
+
+        void performRealOnlyForwardTransform (float* data) override
+        {
+            // Pack the even samples into the real and the odd samples into the imaginary parts.
+            for (int n = 0; n < complexSize; ++n)
+            {
+                const auto target = static_cast<size_t> (bitReversed[static_cast<size_t> (n)]);
+                real[target] = data[2 * n];
+                imag[target] = data[2 * n + 1];
+            }
+
+            transform (real.data(), imag.data());
+
+            // X[k] = E[k] + w^k O[k], where E[k] = (Z[k] + conj Z[M - k]) / 2 and O[k] = (Z[k] - conj Z[M - k]) / 2i.
+            for (int k = 0; k <= complexSize / 2; ++k)
+            {
+                const int mirror = (complexSize - k) & (complexSize - 1);
+                const float zr = real[static_cast<size_t> (k)], zi = imag[static_cast<size_t> (k)];
+                const float mr = real[static_cast<size_t> (mirror)], mi = imag[static_cast<size_t> (mirror)];
+
+                const float evenReal = 0.5f * (zr + mr), evenImag = 0.5f * (zi - mi);
+                const float oddReal = 0.5f * (zi + mi), oddImag = -0.5f * (zr - mr);
+                const float wr = splitReal[static_cast<size_t> (k)], wi = splitImag[static_cast<size_t> (k)];
+                const float rotatedReal = wr * oddReal - wi * oddImag;
+                const float rotatedImag = wr * oddImag + wi * oddReal;
+
+                data[2 * k] = evenReal + rotatedReal;
+                data[2 * k + 1] = evenImag + rotatedImag;
+                // X[M - k] = conj (E[k] - w^k O[k]).
+                data[2 * (complexSize - k)] = evenReal - rotatedReal;
+                data[2 * (complexSize - k) + 1] = -(evenImag - rotatedImag);
+            }
+        }
+
+        void performRealOnlyInverseTransform (float* data) override
+        {
+            // Recombine Z[k] = E[k] + i O[k] from X[k] and X[M - k], conjugated for the inverse.
+            for (int k = 0; k <= complexSize / 2; ++k)
+            {
+                const float xr = data[2 * k], xi = data[2 * k + 1];
+                const float mr = data[2 * (complexSize - k)], mi = -data[2 * (complexSize - k) + 1];
+
+                const float evenReal = 0.5f * (xr + mr), evenImag = 0.5f * (xi + mi);
+                const float differenceReal = 0.5f * (xr - mr), differenceImag = 0.5f * (xi - mi);
+                // O[k] = (X[k] - conj X[M - k]) / (2 w^k), and 1 / w^k = conj w^k.
+                const float wr = splitReal[static_cast<size_t> (k)], wi = -splitImag[static_cast<size_t> (k)];
+                const float oddReal = wr * differenceReal - wi * differenceImag;
+                const float oddImag = wr * differenceImag + wi * differenceReal;
+
+                // Z[k] = E[k] + i O[k] and Z[M - k] = conj E[k] + i conj O[k], both conjugated.
+                storeConjugated (k, evenReal - oddImag, evenImag + oddReal);
+                if (k != 0 && k != complexSize - k)
+                    storeConjugated (complexSize - k, evenReal + oddImag, -evenImag + oddReal);
+            }
+
+            transform (real.data(), imag.data());
+
+            // Conjugate back, scale and unpack.
+            const float scale = 1.f / static_cast<float> (complexSize);
+            for (int n = 0; n < complexSize; ++n)
+            {
+                data[2 * n] = real[static_cast<size_t> (n)] * scale;
+                data[2 * n + 1] = -imag[static_cast<size_t> (n)] * scale;
+            }
+        }
+
+    private:
+        void storeConjugated (int k, float zr, float zi)
+        {
+            const auto target = static_cast<size_t> (bitReversed[static_cast<size_t> (k)]);
+            real[target] = zr;
+            imag[target] = -zi;
+        }
+
+        // In-place forward complex FFT of bit-reversed input.
+        void transform (float* re, float* im) const
+        {
+            const float* stageReal = twiddleReal.data();
+            const float* stageImag = twiddleImag.data();
+            for (int h = 1; h < complexSize; h *= 2)
+            {
+                for (int start = 0; start < complexSize; start += 2 * h)
+                {
+                    float* aReal = re + start;
+                    float* aImag = im + start;
+                    float* bReal = aReal + h;
+                    float* bImag = aImag + h;
+                    for (int j = 0; j < h; ++j)
+                    {
+                        const float tr = stageReal[j] * bReal[j] - stageImag[j] * bImag[j];
+                        const float ti = stageReal[j] * bImag[j] + stageImag[j] * bReal[j];
+                        bReal[j] = aReal[j] - tr;
+                        bImag[j] = aImag[j] - ti;
+                        aReal[j] += tr;
+                        aImag[j] += ti;
+                    }
+                }
+                stageReal += h;
+                stageImag += h;
+            }
+        }
+
+        const int size, complexSize;
+        std::vector<float> real, imag;
+        std::vector<int> bitReversed;
+        std::vector<float> twiddleReal, twiddleImag;
+        std::vector<float> splitReal, splitImag;
+    };
+
+    FFTBackend benchmarkFFTBackends()
+    {
+        constexpr int order = 9, numRounds = 200;
+        const FFTBackend backends[] = { FFTBackend::kJuce, FFTBackend::kRadix2 };
+
+        auto fastest = FFTBackend::kJuce;
+        auto fastestTime = std::chrono::steady_clock::duration::max();
+        for (const auto backend : backends)
+        {
+            auto fft = createFFT (order, backend);
+            std::vector<float> buffer (2 * static_cast<size_t> (fft->getSize()), 0.f);
+            buffer[1] = 1.f;
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < numRounds; ++round)
+            {
+                fft->performRealOnlyForwardTransform (buffer.data());
+                fft->performRealOnlyInverseTransform (buffer.data());
+            }
+            const auto time = std::chrono::steady_clock::now() - start;
+
+            if (time < fastestTime)
+            {
+                fastest = backend;
+                fastestTime = time;
+            }
+        }
+        return fastest;
+    }
+} // namespace
+
+std::unique_ptr<FFTEngine> createFFT (int order, FFTBackend backend)
+{
+    switch (backend)
+    {
+        case FFTBackend::kRadix2:
+            return std::make_unique<Radix2FFTEngine> (order);
+        case FFTBackend::kJuce:
+        default:
+            return std::make_unique<JuceFFTEngine> (order);
+    }
+}
+
+FFTBackend getFastestFFTBackend()
+{
+    static const FFTBackend fastest = benchmarkFFTBackends();
+    return fastest;
+}
+
+void multiplySpectra (std::complex<float>* dest,
+                      const std::complex<float>* a,
+                      const std::complex<float>* b,
+                      int numBins)
+{
+    auto d = reinterpret_cast<float*> (dest);
+    auto x = reinterpret_cast<const float*> (a);
+    auto y = reinterpret_cast<const float*> (b);
+    for (int i = 0; i < numBins; ++i)
+    {
+        const float re = x[2 * i] * y[2 * i] - x[2 * i + 1] * y[2 * i + 1];
+        const float im = x[2 * i] * y[2 * i + 1] + x[2 * i + 1] * y[2 * i];
+        d[2 * i] = re;
+        d[2 * i + 1] = im;
+    }
+}
+
+void multiplyAccumulateSpectra (std::complex<float>* dest,
+                                const std::complex<float>* a,
+                                const std::complex<float>* b,
+                                int numBins)
+{
+    auto d = reinterpret_cast<float*> (dest);
+    auto x = reinterpret_cast<const float*> (a);
+    auto y = reinterpret_cast<const float*> (b);
+    for (int i = 0; i < numBins; ++i)
+    {
+        d[2 * i] += x[2 * i] * y[2 * i] - x[2 * i + 1] * y[2 * i + 1];
+        d[2 * i + 1] += x[2 * i] * y[2 * i + 1] + x[2 * i + 1] * y[2 * i];
+    }
+}
+
+} // namespace ddsp
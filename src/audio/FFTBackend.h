@@ -0,0 +1,67 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <complex>
+#include <memory>
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// FFT implementations an FFTEngine can be created with.
+enum class FFTBackend
+{
+    // juce::dsp::FFT, which uses whichever engine JUCE was built with (IPP, vDSP, FFTW) and its
+    // own fallback otherwise.
+    kJuce,
+    // The bundled radix-2 engine, which has no dependencies and vectorizes on any compiler.
+    kRadix2,
+};
+
+// Real-only FFT of a power-of-two size with the buffer layout of juce::dsp::FFT: the buffer holds
+// 2 * getSize() floats, the forward transform writes the getSize() / 2 + 1 non-negative frequency
+// bins as interleaved complex values, and the inverse transform reads those bins and scales by
+// 1 / getSize().
+class FFTEngine
+{
+public:
+    virtual ~FFTEngine() = default;
+
+    virtual int getSize() const = 0;
+    virtual void performRealOnlyForwardTransform (float* data) = 0;
+    virtual void performRealOnlyInverseTransform (float* data) = 0;
+};
+
+std::unique_ptr<FFTEngine> createFFT (int order, FFTBackend backend);
+
+// The backend that ran a round of real transforms fastest on this CPU. The benchmark takes a few
+// milliseconds and runs once, on the first call; call it at startup rather than from the audio thread.
+FFTBackend getFastestFFTBackend();
+
+// dest[i] = a[i] * b[i] for numBins complex values. dest may be a.
+void multiplySpectra (std::complex<float>* dest,
+                      const std::complex<float>* a,
+                      const std::complex<float>* b,
+                      int numBins);
+// dest[i] += a[i] * b[i] for numBins complex values.
+void multiplyAccumulateSpectra (std::complex<float>* dest,
+                                const std::complex<float>* a,
+                                const std::complex<float>* b,
+                                int numBins);
+
+} // namespace ddsp
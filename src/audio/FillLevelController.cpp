@@ -0,0 +1,72 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*
+The inference worker fills the output FIFO a hop at a time while the audio
+thread drains it a block at a time, so the depth seen ahead of each read
+follows a sawtooth. Its troughs are what matter: they are the margin left
+for the worker to finish the next hop. Tracking the lowest depth over a
+window of reads measures that margin without reacting to the sawtooth itself.
+
+An underrun needs no action here. The ring buffer pads the block with
+silence and the late samples are played one shortfall later, so the depth
+is restored, but the latency has grown. Once a whole window has passed with
+the trough above the target, the excess is dropped (crossfaded by the
+caller) and the latency is back where it was set.
+*/
+
+#include "audio/FillLevelController.h"
+
+namespace ddsp
+{
+
+void FillLevelController::prepare (int target, int window, int tol)
+{
+    jassert (target >= 0 && window > 0 && tol >= 0);
+    targetLevel = target;
+    windowSize = window;
+    tolerance = tol;
+    reset();
+}
+
+void FillLevelController::reset()
+{
+    samplesInWindow = 0;
+    lowestLevel = std::numeric_limits<int>::max();
+    numSamplesDropped = 0;
+}
+
+int FillLevelController::update (int numReady, int numSamples)
+{
+    lowestLevel = std::min (lowestLevel, numReady);
+    samplesInWindow += numSamples;
+    if (samplesInWindow < windowSize)
+        return 0;
+
+    const int excess = lowestLevel - targetLevel;
+    samplesInWindow = 0;
+    lowestLevel = std::numeric_limits<int>::max();
+    if (excess <= tolerance)
+        return 0;
+
+    numSamplesDropped += excess;
+    return excess;
+}
+
+int FillLevelController::getTargetLevel() const { return targetLevel; }
+
+juce::int64 FillLevelController::getNumSamplesDropped() const { return numSamplesDropped; }
+
+} // namespace ddsp
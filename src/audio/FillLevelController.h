@@ -0,0 +1,57 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <limits>
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// Keeps the depth of a FIFO that is consumed in blocks near a target. The consumer reports how many
+// samples are ready before each read; once per window the lowest of those levels is compared with the
+// target and whatever stands above it (by more than a tolerance) is returned to be dropped.
+// The controller only ever lowers the level: a FIFO that runs dry pads the output with silence and
+// comes back one shortfall deeper, which the next windows then trim back to the target.
+class FillLevelController
+{
+public:
+    // `targetLevel` is the least number of samples that should be ready ahead of a read, `windowSize`
+    // the number of samples read between decisions and `tolerance` the excess that is left alone.
+    void prepare (int targetLevel, int windowSize, int tolerance);
+    // Starts a new window.
+    void reset();
+
+    // Call before each read of `numSamples` with the samples ready. Returns the number of samples to
+    // drop ahead of the read, 0 on all but the last read of a window.
+    int update (int numReady, int numSamples);
+
+    int getTargetLevel() const;
+    // Samples dropped since the last reset().
+    juce::int64 getNumSamplesDropped() const;
+
+private:
+    int targetLevel = 0;
+    int windowSize = 0;
+    int tolerance = 0;
+
+    int samplesInWindow = 0;
+    int lowestLevel = std::numeric_limits<int>::max();
+    juce::int64 numSamplesDropped = 0;
+};
+
+} // namespace ddsp
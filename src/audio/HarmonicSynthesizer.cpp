@@ -22,6 +22,16 @@ are prepared through normalization and then interpolated with previously
 generated values. The instantaneous phase is calculated from the frequency
 shift and subsequently totaled and wrapped. Values are calculated for
 each harmonic at each sample and then summed to yield the final buffer.
+Harmonics that stay above Nyquist or below kHarmonicCullingThreshold_dB for
+the whole hop are left out of the sum.
+
+In wavetable ("economy") mode the harmonic sum is not evaluated per sample.
+Since the harmonic distribution is a fixed mix of the previous and current
+controls at every sample (see midwayLerp), one cycle of the current hop's
+waveform is built with a single inverse FFT and read back at the
+instantaneous phase. Crossfading from the previous hop's table with the same
+midway envelope gives exactly the amplitudes the oscillator bank would use,
+up to the table's interpolation error.
 */
 
 #include "audio/HarmonicSynthesizer.h"
@@ -56,74 +66,112 @@ namespace
 
 using namespace juce;
 
-HarmonicSynthesizer::HarmonicSynthesizer (int nh, int nos, float sr)
-    : previousPhase (0.f),
+template <int NumHarmonics, int NumOutputSamples>
+BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::BasicHarmonicSynthesizer (int nh, int nos, float sr)
+    : phaseAccumulator (sr),
       previousF0 (0.f),
       previousAmplitude (0.f),
       numHarmonics (nh),
       numOutputSamples (nos),
       sampleRate (sr),
-      harmonicSeries (numHarmonics),
-      harmonicAmplitudes (numHarmonics, std::vector<float> (numOutputSamples, 0)),
-      phases (numOutputSamples),
-      sinusoids (numOutputSamples, numHarmonics)
+      harmonicAmplitudeStride ((nos + kFloatsPerAlignment - 1) / kFloatsPerAlignment * kFloatsPerAlignment),
+      wavetableFFT (createFFT (juce::roundToInt (std::log2 (kWavetableSize)), getFastestFFTBackend()))
 {
-    previousHarmonicDistribution.resize (numHarmonics);
-    frameFrequencies.resize (numHarmonics);
-    renderBuffer.resize (numOutputSamples);
-
-    harmonicSeries.resize (numHarmonics);
-    frequencyEnvelope.resize (numOutputSamples);
-    std::iota (std::begin (harmonicSeries), std::end (harmonicSeries), 1.f);
+    // Leave room to align the start of the slab.
+    resizeBuffer (harmonicAmplitudeStorage, numHarmonics * harmonicAmplitudeStride + kFloatsPerAlignment);
+    harmonicAmplitudes = snapPointerToAlignment (harmonicAmplitudeStorage.data(), OscillatorBank::kAlignment_bytes);
+
+    resizeBuffer (previousHarmonicDistribution, numHarmonics);
+    resizeBuffer (phases, numOutputSamples);
+    resizeBuffer (renderBuffer, numOutputSamples);
+    resizeBuffer (frequencyEnvelope, numOutputSamples);
+    resizeBuffer (activeHarmonics, numHarmonics);
+
+    wavetableFFTBuffer.fill (0.f);
+    for (auto& wavetable : wavetables)
+        wavetable.fill (0.f);
+    resizeBuffer (crossfadeEnvelope, numOutputSamples);
+    midwayLerp (0.f, 1.f, crossfadeEnvelope.data(), numOutputSamples);
 }
 
-const std::vector<float>&
-    HarmonicSynthesizer::render (std::vector<float>& harmonicDistribution, float amplitude, float f0)
+template <int NumHarmonics, int NumOutputSamples>
+std::span<const float>
+    BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::render (std::vector<float>& harmonicDistribution,
+                                                                      float amplitude,
+                                                                      float f0)
 {
-    normalizeHarmonicDistribution (harmonicDistribution, amplitude, f0);
+    normalizeHarmonicDistribution (harmonicDistribution, amplitude, f0, sampleRate);
     previousAmplitude = amplitude;
 
+    collectActiveHarmonics (harmonicDistribution, f0);
+
     // Interpolate frequency envelope, harmonic distribution and store state.
-    midwayLerp (previousF0.value_or (f0), f0, frequencyEnvelope);
+    midwayLerp (previousF0.value_or (f0), f0, frequencyEnvelope.data(), numOutputSamples);
+
+    if (synthesisMode.load() == SynthesisMode::kWavetable)
+    {
+        // The tables are only kept up to date in wavetable mode; after a switch, rebuild the last one.
+        if (! previousWavetableValid)
+        {
+            createWavetable (previousHarmonicDistribution, wavetables[currentWavetableIndex].data());
+        }
+        currentWavetableIndex = 1 - currentWavetableIndex;
+        createWavetable (harmonicDistribution, wavetables[currentWavetableIndex].data());
+        previousWavetableValid = true;
+
+        previousF0 = f0;
+        std::copy (harmonicDistribution.begin(), harmonicDistribution.end(), previousHarmonicDistribution.begin());
+
+        return synthesizeFromWavetables();
+    }
+
+    previousWavetableValid = false;
     previousF0 = f0;
 
     for (int i = 0; i < numHarmonics; i++)
     {
-        midwayLerp (previousHarmonicDistribution[i], harmonicDistribution[i], harmonicAmplitudes[i]);
+        if (harmonicDistribution[i] == 0.f && previousHarmonicDistribution[i] == 0.f)
+        {
+            continue;
+        }
+        midwayLerp (previousHarmonicDistribution[i],
+                    harmonicDistribution[i],
+                    harmonicAmplitudes + i * harmonicAmplitudeStride,
+                    numOutputSamples);
     }
-    previousHarmonicDistribution = harmonicDistribution;
+    std::copy (harmonicDistribution.begin(), harmonicDistribution.end(), previousHarmonicDistribution.begin());
 
     return synthesizeHarmonics();
 }
 
-void HarmonicSynthesizer::normalizeHarmonicDistribution (std::vector<float>& harmonicDistribution,
-                                                         float amplitude,
-                                                         float f0)
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::collectActiveHarmonics (
+    const std::vector<float>& harmonicDistribution,
+    float f0)
 {
-    // The DDSP models sometimes predict harmonic values above their nyquist frequency.
-    // Here we remove those and normalize the sum to 1.
-
-    // Calculate the frequencies for this frame: f0 x harmonic series.
-    FloatVectorOperations::multiply (frameFrequencies.data(), harmonicSeries.data(), f0, numHarmonics);
-
-    // Remove harmonics above Nyquist: this is at the model sample rate, not the DAW sample rate.
-    // This step is prior to normalization during training, so we replicate that order here.
-    for (int i = 0; i < frameFrequencies.size(); i++)
+    // A harmonic's amplitude ramps from its previous to its current value over the hop, so it can only
+    // be skipped when both are negligible. Harmonics that were above Nyquist for the previous and the
+    // current f0 were zeroed by normalizeHarmonicDistribution(), so the scan stops at the last index
+    // below Nyquist for the lower of the two.
+    const float lowestF0 = std::min (previousF0.value_or (f0), f0);
+    const float nyquist = harmonicNyquistFrequency (sampleRate);
+    const int maxHarmonics = static_cast<int> (numHarmonics);
+    const int nyquistCutoff =
+        lowestF0 > 0.f ? jlimit (0, maxHarmonics, static_cast<int> (std::ceil (nyquist / lowestF0)) - 1) : maxHarmonics;
+    const float threshold = Decibels::decibelsToGain (kHarmonicCullingThreshold_dB);
+
+    numActiveHarmonics = 0;
+    for (int i = 0; i < nyquistCutoff; i++)
     {
-        if (frameFrequencies[i] >= sampleRate / 2.f)
+        if (std::abs (harmonicDistribution[i]) > threshold || std::abs (previousHarmonicDistribution[i]) > threshold)
         {
-            harmonicDistribution[i] = 0.f;
+            activeHarmonics[numActiveHarmonics++] = i;
         }
     }
 
-    // Normalize so the frequency coeffecients sum up to 1 again.
-    auto total = std::accumulate (harmonicDistribution.begin(), harmonicDistribution.end(), 0.f);
-    if (total != 0.f)
-    {
-        FloatVectorOperations::multiply (harmonicDistribution.data(), 1.f / total, numHarmonics);
-    }
-
-    FloatVectorOperations::multiply (harmonicDistribution.data(), amplitude, numHarmonics);
+    lastNumActiveHarmonics = numActiveHarmonics;
+    lastNumCulledHarmonics = numHarmonics - numActiveHarmonics;
+    totalCulledHarmonics += numHarmonics - numActiveHarmonics;
 }
 
 /*
@@ -143,76 +191,191 @@ We are given a series of frequencies in Hz. To get θ(t), we first convert
 frequency to radians (ω). Since the instantaneous frequency of a sinusoid
 is defined as the derivative of the instantaneous phase (see
 https://ccrma.stanford.edu/~jos/fp/Sinusoids.html for more), we can take the
-integral of ω(t) at each sample to get θ(t) (you can think of std::partial_sum
-as doing a sort of Riemann sum style integration). For each harmonic sinusoid
+integral of ω(t) at each sample to get θ(t) (you can think of PhaseAccumulator
+as doing a sort of Riemann sum style integration, in double precision and
+wrapped to [0, 2π) so it does not drift). For each harmonic sinusoid
 at each sample t, y(t) is then calculated by taking the sin() and applying
 the appropriate amplitude value as calculated by the model. Finally, these
 harmonics are added together to create the final wave.
+
+The sin() of each harmonic is not evaluated directly; OscillatorBank derives
+sin(k * θ(t)) from sin(θ(t)) and cos(θ(t)) by complex rotation, which keeps
+the cost per harmonic to a handful of SIMD multiplies. The weighted harmonics
+are accumulated tile by tile straight into the render buffer, so no
+samples x harmonics intermediate is ever stored.
 */
-const std::vector<float>& HarmonicSynthesizer::synthesizeHarmonics()
+template <int NumHarmonics, int NumOutputSamples>
+std::span<const float> BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::synthesizeHarmonics()
 {
     // Generates audio from sample-wise frequencies for a bank of oscillators.
 
-    // Calculate the angular frequency. Hz -> radians per sample.
-    FloatVectorOperations::multiply (
-        frequencyEnvelope.data(), MathConstants<float>::twoPi / sampleRate, numOutputSamples);
+    computePhases();
 
-    // Calculate the integration of angular frequency as instantaneous phase.
-    std::partial_sum (frequencyEnvelope.begin(), frequencyEnvelope.end(), phases.begin());
+    // Apply phases for each sample to its harmonic series, apply the appropriate
+    // DDSP model amplitudes to each active harmonic and sum up the harmonics for each timestep.
+    oscillatorBank.process (phases.data(),
+                            harmonicAmplitudes,
+                            harmonicAmplitudeStride,
+                            activeHarmonics.data(),
+                            numActiveHarmonics,
+                            renderBuffer.data(),
+                            numOutputSamples);
 
-    // Add previous total phase.
-    FloatVectorOperations::add (phases.data(), previousPhase, numOutputSamples);
+    return renderBuffer;
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::computePhases()
+{
+    // Integrate the frequency envelope into the wrapped instantaneous phase of the fundamental.
+    phaseAccumulator.process (frequencyEnvelope.data(), phases.data(), numOutputSamples);
+}
 
-    // Wrap and store the total phase.
-    previousPhase = fmod (phases.back(), MathConstants<float>::twoPi);
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::createWavetable (
+    std::span<const float> harmonicDistribution,
+    float* wavetable)
+{
+    // One cycle of sum_k a_k sin (k x) is the inverse FFT of a spectrum with -a_k * N / 2 in the
+    // imaginary part of bin k. The distribution has already been cut at Nyquist, so the table holds
+    // the same harmonics the oscillator bank would synthesize.
+    wavetableFFTBuffer.fill (0.f);
 
-    // Apply phases for each sample to its harmonic series.
-    // Apply the appropriate DDSP model amplitudes to each harmonic.
-    // `sinusoids` has the shape `numOutputSamples` x `numHarmonics`.
-    for (int i = 0; i < sinusoids.getNumRows(); i++)
+    const int numTableHarmonics = std::min (static_cast<int> (numHarmonics), kWavetableSize / 2 - 1);
+    for (int i = 0; i < numTableHarmonics; i++)
     {
-        for (int j = 0, harmonicOrder = 1; j < sinusoids.getNumColumns(); j++, harmonicOrder++)
-        {
-            sinusoids (i, j) = (sin (phases[i] * harmonicOrder)) * harmonicAmplitudes[j][i];
-        }
+        wavetableFFTBuffer[2 * (i + 1) + 1] = -0.5f * kWavetableSize * harmonicDistribution[i];
     }
 
-    // Sum up the harmonics for each timestep.
-    for (int i = 0; i < sinusoids.getNumRows(); i++)
+    wavetableFFT->performRealOnlyInverseTransform (wavetableFFTBuffer.data());
+
+    wavetable[0] = wavetableFFTBuffer[kWavetableSize - 1];
+    std::copy (wavetableFFTBuffer.begin(), wavetableFFTBuffer.begin() + kWavetableSize, wavetable + 1);
+    wavetable[kWavetableSize + 1] = wavetableFFTBuffer[0];
+    wavetable[kWavetableSize + 2] = wavetableFFTBuffer[1];
+}
+
+/*
+Reads both tables at the instantaneous phase of every sample and crossfades from
+the previous to the current one with the midway envelope used for the harmonic
+amplitudes in the oscillator bank mode. The tables are read with 4-point cubic
+Hermite interpolation, which keeps the error of the first 60 harmonics of a
+kWavetableSize = 512 table well below the level of the harmonics themselves.
+*/
+template <int NumHarmonics, int NumOutputSamples>
+std::span<const float> BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::synthesizeFromWavetables()
+{
+    computePhases();
+
+    const auto readCubic = [] (const float* y, float t)
     {
-        auto rowStart = sinusoids.begin() + (i * sinusoids.getNumColumns());
-        auto rowEnd = rowStart + sinusoids.getNumColumns();
-        renderBuffer[i] = std::accumulate (rowStart, rowEnd, 0.f);
+        const float c1 = 0.5f * (y[2] - y[0]);
+        const float c2 = y[0] - 2.5f * y[1] + 2.f * y[2] - 0.5f * y[3];
+        const float c3 = 0.5f * (y[3] - y[0]) + 1.5f * (y[1] - y[2]);
+        return ((c3 * t + c2) * t + c1) * t + y[1];
+    };
+
+    const float* previousWavetable = wavetables[1 - currentWavetableIndex].data();
+    const float* currentWavetable = wavetables[currentWavetableIndex].data();
+    const float samplesPerRadian = kWavetableSize / MathConstants<float>::twoPi;
+    for (int n = 0; n < numOutputSamples; n++)
+    {
+        // The phases are already wrapped to [0, 2pi).
+        const float position = phases[n] * samplesPerRadian;
+        const int index = std::min (static_cast<int> (position), kWavetableSize - 1);
+        const float fraction = position - static_cast<float> (index);
+
+        // Sample `index` of the cycle is stored at `index + 1`, so the four taps start at `index`.
+        const float previous = readCubic (previousWavetable + index, fraction);
+        const float current = readCubic (currentWavetable + index, fraction);
+
+        renderBuffer[n] = previous + crossfadeEnvelope[n] * (current - previous);
     }
 
     return renderBuffer;
 }
 
-void HarmonicSynthesizer::midwayLerp (float first, float last, std::vector<float>& result)
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::midwayLerp (float first,
+                                                                          float last,
+                                                                          float* result,
+                                                                          int numSamples)
 {
     // This interpolation is a mix between linear and nearest neighbor, with the first half
     // being linear between the two given values and the last half repeating the last value.
     // This type of interpolation was chosen over a simple linear approach due to "swooping"
     // artifacts generated over the 20ms hop size when the two endpoint values are sufficiently
     // far apart.
-    const auto middle = result.begin() + result.size() / 2;
-    interpolateLinearly (result.begin(), middle, first, last);
-    std::fill (middle, result.end(), last);
+    const auto middle = result + numSamples / 2;
+    interpolateLinearly (result, middle, first, last);
+    std::fill (middle, result + numSamples, last);
 }
 
-void HarmonicSynthesizer::reset()
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::setSynthesisMode (SynthesisMode mode)
 {
-    previousPhase = 0;
+    synthesisMode = mode;
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+HarmonicSynthesisMode BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::getSynthesisMode() const
+{
+    return synthesisMode.load();
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+PhaseAccumulator::State BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::getPhaseState() const
+{
+    return phaseAccumulator.snapshot();
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::setPhaseState (const PhaseAccumulator::State& state)
+{
+    phaseAccumulator.restore (state);
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+int BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::getNumActiveHarmonics() const
+{
+    return lastNumActiveHarmonics.load();
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+int BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::getNumCulledHarmonics() const
+{
+    return lastNumCulledHarmonics.load();
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+juce::int64 BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::getTotalCulledHarmonics() const
+{
+    return totalCulledHarmonics.load();
+}
+
+template <int NumHarmonics, int NumOutputSamples>
+void BasicHarmonicSynthesizer<NumHarmonics, NumOutputSamples>::reset()
+{
+    phaseAccumulator.reset();
     previousF0.reset();
     previousAmplitude = 0;
-    sinusoids.clear();
-    harmonicAmplitudes = std::vector<std::vector<float>> (numHarmonics, std::vector<float> (numOutputSamples, 0.0f));
+    FloatVectorOperations::clear (harmonicAmplitudes, numHarmonics * harmonicAmplitudeStride);
+    numActiveHarmonics = 0;
+    lastNumActiveHarmonics = 0;
+    lastNumCulledHarmonics = 0;
+    totalCulledHarmonics = 0;
 
     std::fill (previousHarmonicDistribution.begin(), previousHarmonicDistribution.end(), 0.f);
-    std::fill (frameFrequencies.begin(), frameFrequencies.end(), 0.f);
     std::fill (frequencyEnvelope.begin(), frequencyEnvelope.end(), 0.f);
     std::fill (phases.begin(), phases.end(), 0.f);
     std::fill (renderBuffer.begin(), renderBuffer.end(), 0.f);
+    for (auto& wavetable : wavetables)
+        wavetable.fill (0.f);
+    previousWavetableValid = false;
 }
 
+template class BasicHarmonicSynthesizer<kDynamicExtent, kDynamicExtent>;
+template class BasicHarmonicSynthesizer<kHarmonicsSize, kModelHopSize>;
+template class BasicHarmonicSynthesizer<kHarmonicsSize, kDynamicExtent>;
+
 } // namespace ddsp
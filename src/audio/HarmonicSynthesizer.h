@@ -17,38 +17,129 @@ limitations under the License.
 #pragma once
 
 #include <optional>
+#include <span>
 
 #include "JuceHeader.h"
 
+#include "audio/FFTBackend.h"
+#include "audio/HarmonicSynthesizerBase.h"
+#include "audio/OscillatorBank.h"
+#include "audio/PhaseAccumulator.h"
+#include "util/Constants.h"
+#include "util/Extent.h"
+
 namespace ddsp
 {
 
-class HarmonicSynthesizer
+enum class HarmonicSynthesisMode
+{
+    // One oscillator per audible harmonic. Cost grows with samples x harmonics.
+    kOscillatorBank,
+    // "Economy" mode: one band-limited single-cycle table per hop, read with an interpolating
+    // phase accumulator. Cost grows with samples only.
+    kWavetable,
+};
+
+// Additive synthesizer for the harmonic part of the DDSP model outputs.
+// The harmonic count and hop size are either template arguments, which turns every buffer into a
+// std::array and fixes the trip counts of the per-hop loops, or kDynamicExtent to set them at
+// construction for models with other shapes.
+template <int NumHarmonics, int NumOutputSamples>
+class BasicHarmonicSynthesizer : public HarmonicSynthesizerBase
 {
 public:
-    HarmonicSynthesizer (int numHarmonics, int numOutputSamples, float sampleRate);
+    using SynthesisMode = HarmonicSynthesisMode;
+
+    // Number of samples in one cycle of the wavetable. Must be a power of two.
+    static constexpr int kWavetableSize = 512;
+
+    // With static extents the sizes passed in must match the template arguments.
+    BasicHarmonicSynthesizer (int numHarmonics, int numOutputSamples, float sampleRate);
 
     // Clears all internal scratch buffers and state variables.
-    void reset();
+    void reset() override;
+
+    std::span<const float> render (std::vector<float>& harmonicDistribution, float amplitude, float f0) override;
 
-    const std::vector<float>& render (std::vector<float>& harmonicDistribution, float amplitude, float f0);
+    // Takes effect from the next call to render(). Safe to call from any thread.
+    void setSynthesisMode (SynthesisMode mode);
+    SynthesisMode getSynthesisMode() const;
+
+    // Phase of the fundamental, for carrying a note over to another synthesizer or back to an earlier point.
+    PhaseAccumulator::State getPhaseState() const;
+    void setPhaseState (const PhaseAccumulator::State& state);
+
+    // Number of harmonics synthesized and skipped during the last call to render().
+    int getNumActiveHarmonics() const;
+    int getNumCulledHarmonics() const;
+    // Running total of skipped harmonics since the last reset().
+    juce::int64 getTotalCulledHarmonics() const;
 
 private:
-    void normalizeHarmonicDistribution (std::vector<float>& harmonicDistribution, float amplitude, float f0);
-    const std::vector<float>& synthesizeHarmonics();
-    void midwayLerp (float first, float last, std::vector<float>& result);
+    // Rows of the amplitude slab are rounded up to whole OscillatorBank::kAlignment_bytes lines.
+    static constexpr int kFloatsPerAlignment = OscillatorBank::kAlignment_bytes / sizeof (float);
+    static constexpr int kAmplitudeStride =
+        NumOutputSamples == kDynamicExtent
+            ? kDynamicExtent
+            : (NumOutputSamples + kFloatsPerAlignment - 1) / kFloatsPerAlignment * kFloatsPerAlignment;
+    // The slab holds one spare line so that its start can be aligned.
+    static constexpr int kAmplitudeStorageSize =
+        NumHarmonics == kDynamicExtent || kAmplitudeStride == kDynamicExtent
+            ? kDynamicExtent
+            : NumHarmonics * kAmplitudeStride + kFloatsPerAlignment;
+    // One cycle plus one guard sample before and two after it for cubic interpolation.
+    static constexpr int kWavetableStorageSize = kWavetableSize + 3;
+
+    void collectActiveHarmonics (const std::vector<float>& harmonicDistribution, float f0);
+    std::span<const float> synthesizeHarmonics();
+    std::span<const float> synthesizeFromWavetables();
+    void computePhases();
+    void createWavetable (std::span<const float> harmonicDistribution, float* wavetable);
+    void midwayLerp (float first, float last, float* result, int numSamples);
 
     // Harmonic synthesizer state-related variables.
-    std::vector<float> previousHarmonicDistribution;
-    float previousPhase;
+    ExtentBuffer<float, NumHarmonics> previousHarmonicDistribution;
+    PhaseAccumulator phaseAccumulator;
     std::optional<float> previousF0;
     float previousAmplitude;
 
-    int numHarmonics, numOutputSamples;
+    const Extent<NumHarmonics> numHarmonics;
+    const Extent<NumOutputSamples> numOutputSamples;
     float sampleRate;
-    std::vector<float> harmonicSeries, frequencyEnvelope, frameFrequencies, phases, renderBuffer;
-    std::vector<std::vector<float>> harmonicAmplitudes;
-    juce::dsp::Matrix<float> sinusoids;
+    ExtentBuffer<float, NumOutputSamples> frequencyEnvelope, phases, renderBuffer;
+    // Per-sample harmonic amplitudes in one aligned slab with the shape `numHarmonics` x
+    // `harmonicAmplitudeStride`. Each row starts on an OscillatorBank::kAlignment_bytes boundary.
+    ExtentBuffer<float, kAmplitudeStorageSize> harmonicAmplitudeStorage;
+    float* harmonicAmplitudes;
+    const Extent<kAmplitudeStride> harmonicAmplitudeStride;
+    OscillatorBank oscillatorBank;
+
+    // Indices of the harmonics that are audible during the current hop.
+    ExtentBuffer<int, NumHarmonics> activeHarmonics;
+    int numActiveHarmonics = 0;
+    std::atomic<int> lastNumActiveHarmonics = { 0 };
+    std::atomic<int> lastNumCulledHarmonics = { 0 };
+    std::atomic<juce::int64> totalCulledHarmonics = { 0 };
+
+    std::atomic<SynthesisMode> synthesisMode = { SynthesisMode::kOscillatorBank };
+    std::unique_ptr<FFTEngine> wavetableFFT;
+    std::array<float, 2 * kWavetableSize> wavetableFFTBuffer;
+    // Wavetables of the previous and the current hop; `currentWavetableIndex` selects the latter.
+    std::array<std::array<float, kWavetableStorageSize>, 2> wavetables;
+    int currentWavetableIndex = 0;
+    bool previousWavetableValid = false;
+    ExtentBuffer<float, NumOutputSamples> crossfadeEnvelope;
 };
 
+// Runtime-sized synthesizer for models with any harmonic count and hop size.
+using HarmonicSynthesizer = BasicHarmonicSynthesizer<kDynamicExtent, kDynamicExtent>;
+// Synthesizer specialized for the shape of the embedded models.
+using StaticHarmonicSynthesizer = BasicHarmonicSynthesizer<kHarmonicsSize, kModelHopSize>;
+// Synthesizer for the embedded models at the host sample rate.
+using HostRateHarmonicSynthesizer = BasicHarmonicSynthesizer<kHarmonicsSize, kDynamicExtent>;
+
+extern template class BasicHarmonicSynthesizer<kDynamicExtent, kDynamicExtent>;
+extern template class BasicHarmonicSynthesizer<kHarmonicsSize, kModelHopSize>;
+extern template class BasicHarmonicSynthesizer<kHarmonicsSize, kDynamicExtent>;
+
 } // namespace ddsp
@@ -0,0 +1,107 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <span>
+
+#include "JuceHeader.h"
+
+#include "audio/tflite/ModelTypes.h"
+#include "util/Constants.h"
+
+namespace ddsp
+{
+
+// Harmonic synthesis engines InferencePipeline can be constructed with.
+enum class HarmonicSynthesisEngine
+{
+    // Per-sample oscillator bank (HarmonicSynthesizer). Cost grows with samples x harmonics.
+    kOscillatorBank,
+    // Band-limited wavetable rebuilt every hop (HarmonicSynthesizer in its economy mode). Cost grows with samples.
+    kWavetable,
+    // Spectral peaks, inverse FFT and overlap-add (InverseFFTSynthesizer). Cost grows with the FFT size.
+    kInverseFFT,
+};
+
+class HarmonicSynthesizerBase
+{
+public:
+    virtual ~HarmonicSynthesizerBase() = default;
+
+    // Clears all internal scratch buffers and state variables.
+    virtual void reset() = 0;
+
+    // Renders one hop from the DDSP model outputs. The harmonic distribution is normalized in place.
+    virtual std::span<const float> render (std::vector<float>& harmonicDistribution, float amplitude, float f0) = 0;
+
+    // Renders `numFrames` consecutive hops into `output`, one hop after the other. The frames are left
+    // untouched and the result is bit-identical to calling render() for each frame in turn.
+    void renderFrames (const SynthesisControls* frames, int numFrames, float* output)
+    {
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            frameHarmonics.assign (frames[frame].harmonics.begin(), frames[frame].harmonics.end());
+            const auto hop = render (frameHarmonics, frames[frame].amplitude, frames[frame].f0_hz);
+            output = std::copy (hop.begin(), hop.end(), output);
+        }
+    }
+
+protected:
+    // The models only ever produce harmonics below the Nyquist frequency of the rate they were trained at,
+    // whatever rate they are synthesized at.
+    static float harmonicNyquistFrequency (float sampleRate)
+    {
+        return std::min (sampleRate, kModelSampleRate_Hz) / 2.f;
+    }
+
+    static void normalizeHarmonicDistribution (std::vector<float>& harmonicDistribution,
+                                               float amplitude,
+                                               float f0,
+                                               float sampleRate)
+    {
+        // The DDSP models sometimes predict harmonic values above their nyquist frequency.
+        // Here we remove those and normalize the sum to 1.
+
+        // Remove harmonics above Nyquist: this is at the model sample rate, not the DAW sample rate.
+        // This step is prior to normalization during training, so we replicate that order here.
+        const float nyquist = harmonicNyquistFrequency (sampleRate);
+        for (size_t i = 0; i < harmonicDistribution.size(); i++)
+        {
+            if (static_cast<float> (i + 1) * f0 >= nyquist)
+            {
+                harmonicDistribution[i] = 0.f;
+            }
+        }
+
+        // Normalize so the frequency coeffecients sum up to 1 again.
+        const auto numHarmonics = static_cast<int> (harmonicDistribution.size());
+        auto total = std::accumulate (harmonicDistribution.begin(), harmonicDistribution.end(), 0.f);
+        if (total != 0.f)
+        {
+            juce::FloatVectorOperations::multiply (harmonicDistribution.data(), 1.f / total, numHarmonics);
+        }
+
+        juce::FloatVectorOperations::multiply (harmonicDistribution.data(), amplitude, numHarmonics);
+    }
+
+private:
+    // Copy of the frame being rendered by renderFrames(), which render() normalizes in place. Sized
+    // like the controls up front, so that copying them in never allocates on the render thread.
+    std::vector<float> frameHarmonics = std::vector<float> (kHarmonicsSize);
+};
+
+} // namespace ddsp
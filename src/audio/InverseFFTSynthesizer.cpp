@@ -0,0 +1,230 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Additive synthesis in the frequency domain, after Rodet & Depalle's FFT^-1
+method. Instead of running an oscillator per harmonic per sample, each hop
+writes every harmonic as a spectral peak into one frame, runs a single inverse
+FFT and overlap-adds the result. The cost is O(N log N) per hop for the FFT plus
+a few bins per harmonic, so it barely grows with the number of harmonics.
+
+A sinusoid windowed by a Blackman-Harris window has almost all of its energy in
+the main lobe of the window's transform, 2 * kLobeHalfWidth bins wide (the side
+lobes are at -92 dB). For a harmonic at fractional bin b with amplitude A and
+phase φ at the frame center, bin m of the frame receives
+
+    X[m] = (A / 2i) (-1)^m e^(iφ) W(m - b)
+
+where W is the real-valued transform of the centered window, read from a
+precomputed oversampled table. Peaks close to DC are folded back by adding the
+conjugate of their negative-frequency image.
+
+After the inverse FFT the frame holds the Blackman-Harris windowed harmonics.
+The central two hops are divided by that window and multiplied by a triangular
+window, and consecutive frames are overlap-added one hop apart.
+
+Frames are centered on hop boundaries. The hop returned by render() is the
+second half of the previous frame crossfaded into the first half of the
+current one, so the harmonic amplitudes move from the previous controls to the
+current ones across the hop, as in HarmonicSynthesizer, without extra latency.
+The phase of the fundamental is accumulated with the same frequency envelope
+as HarmonicSynthesizer, so for steady controls both engines produce the same
+waveform.
+*/
+
+#include "audio/InverseFFTSynthesizer.h"
+
+namespace ddsp
+{
+
+namespace
+{
+    // Four-term Blackman-Harris window coefficients.
+    constexpr double kBlackmanHarris[] = { 0.35875, 0.48829, 0.14128, 0.01168 };
+
+    // Periodic Blackman-Harris window of `size` samples, peaking at size / 2.
+    double blackmanHarris (int n, int size)
+    {
+        const double x = juce::MathConstants<double>::twoPi * n / size;
+        return kBlackmanHarris[0] - kBlackmanHarris[1] * std::cos (x) + kBlackmanHarris[2] * std::cos (2.0 * x)
+               - kBlackmanHarris[3] * std::cos (3.0 * x);
+    }
+
+    int fftOrderForFrame (int frameSize)
+    {
+        int order = 0;
+        while ((1 << order) < frameSize)
+        {
+            ++order;
+        }
+        return order;
+    }
+} // namespace
+
+using namespace juce;
+
+InverseFFTSynthesizer::InverseFFTSynthesizer (int nh, int nos, float sr)
+    : previousPhase (0.0),
+      centerPhase (0.0),
+      previousF0 (0.f),
+      numHarmonics (nh),
+      numOutputSamples (nos),
+      sampleRate (sr),
+      fft (createFFT (fftOrderForFrame (2 * nos), getFastestFFTBackend()))
+{
+    frame.resize (fft->getSize() * 2);
+    overlapBuffer.resize (numOutputSamples);
+    renderBuffer.resize (numOutputSamples);
+    createWindows();
+}
+
+std::span<const float>
+    InverseFFTSynthesizer::render (std::vector<float>& harmonicDistribution, float amplitude, float f0)
+{
+    normalizeHarmonicDistribution (harmonicDistribution, amplitude, f0, sampleRate);
+
+    // Accumulate the phase of the fundamental over the hop exactly as HarmonicSynthesizer does for its
+    // midway-interpolated frequency envelope: linear over the first half, constant over the second.
+    const auto toRadiansPerSample = MathConstants<double>::twoPi / sampleRate;
+    const double first = previousF0.value_or (f0), last = f0;
+    const int rampLength = numOutputSamples / 2;
+    const double hopPhase = rampLength * first + 0.5 * (last - first) * (rampLength - 1)
+                            + (numOutputSamples - rampLength) * last;
+    previousPhase = std::fmod (previousPhase + hopPhase * toRadiansPerSample, MathConstants<double>::twoPi);
+    previousF0 = f0;
+
+    // The frame is centered on the first sample of the next hop.
+    centerPhase = previousPhase + f0 * toRadiansPerSample;
+
+    writeHarmonicsToSpectrum (harmonicDistribution, f0);
+    fft->performRealOnlyInverseTransform (frame.data());
+    overlapAdd();
+
+    return renderBuffer;
+}
+
+void InverseFFTSynthesizer::writeHarmonicsToSpectrum (const std::vector<float>& harmonicDistribution, float f0)
+{
+    const int fftSize = fft->getSize();
+    const int halfSize = fftSize / 2;
+    const double binsPerHz = fftSize / static_cast<double> (sampleRate);
+    auto* spectrum = reinterpret_cast<std::complex<float>*> (frame.data());
+
+    std::fill (frame.begin(), frame.end(), 0.f);
+
+    for (int k = 0; k < numHarmonics; ++k)
+    {
+        const float harmonicAmplitude = harmonicDistribution[k];
+        if (harmonicAmplitude == 0.f)
+        {
+            continue;
+        }
+
+        const double harmonicOrder = k + 1;
+        const double bin = harmonicOrder * f0 * binsPerHz;
+        const double phase = std::fmod (harmonicOrder * centerPhase, MathConstants<double>::twoPi);
+
+        // (A / 2i) e^(iφ) = (A / 2) (sin φ - i cos φ).
+        const float peakReal = 0.5f * harmonicAmplitude * static_cast<float> (std::sin (phase));
+        const float peakImag = -0.5f * harmonicAmplitude * static_cast<float> (std::cos (phase));
+
+        const int firstBin = static_cast<int> (std::ceil (bin - kLobeHalfWidth));
+        const int lastBin = static_cast<int> (std::floor (bin + kLobeHalfWidth));
+        for (int m = firstBin; m <= lastBin; ++m)
+        {
+            // Linearly interpolated main lobe at the distance m - b from the peak.
+            const double position = (m - bin + kLobeHalfWidth) * kLobeOversampling;
+            const int index = jlimit (0, static_cast<int> (lobe.size()) - 2, static_cast<int> (position));
+            const float fraction = static_cast<float> (position - index);
+            float gain = lobe[index] + fraction * (lobe[index + 1] - lobe[index]);
+            if ((m & 1) != 0)
+            {
+                gain = -gain;
+            }
+
+            const std::complex<float> value (gain * peakReal, gain * peakImag);
+
+            // Add the peak at bin m and the conjugate of its mirror image at bin N - m, keeping only
+            // the bins in [0, N / 2] that the real-only inverse transform reads.
+            const int wrapped = ((m % fftSize) + fftSize) % fftSize;
+            if (wrapped <= halfSize)
+            {
+                spectrum[wrapped] += value;
+            }
+            const int mirrored = (fftSize - wrapped) % fftSize;
+            if (mirrored <= halfSize)
+            {
+                spectrum[mirrored] += std::conj (value);
+            }
+        }
+    }
+}
+
+void InverseFFTSynthesizer::overlapAdd()
+{
+    // The frame is centered at N / 2; the two hops around the center are used.
+    const float* framePastHop = frame.data() + fft->getSize() / 2 - numOutputSamples;
+    const float* frameNextHop = frame.data() + fft->getSize() / 2;
+
+    // This hop: tail of the previous frame plus the head of the current one.
+    FloatVectorOperations::copy (renderBuffer.data(), overlapBuffer.data(), numOutputSamples);
+    FloatVectorOperations::addWithMultiply (
+        renderBuffer.data(), framePastHop, synthesisWindow.data(), numOutputSamples);
+
+    // Keep the tail of the current frame for the next hop.
+    FloatVectorOperations::multiply (
+        overlapBuffer.data(), frameNextHop, synthesisWindow.data() + numOutputSamples, numOutputSamples);
+}
+
+void InverseFFTSynthesizer::createWindows()
+{
+    const int fftSize = fft->getSize();
+
+    // W(δ) = Σ_u w[N/2 + u] cos (2π δ u / N), the transform of the window centered at the origin.
+    lobe.resize (2 * kLobeHalfWidth * kLobeOversampling + 2);
+    for (int i = 0; i < static_cast<int> (lobe.size()); ++i)
+    {
+        const double offset = static_cast<double> (i) / kLobeOversampling - kLobeHalfWidth;
+        double sum = 0.0;
+        for (int n = 0; n < fftSize; ++n)
+        {
+            const int u = n - fftSize / 2;
+            sum += blackmanHarris (n, fftSize) * std::cos (MathConstants<double>::twoPi * offset * u / fftSize);
+        }
+        lobe[i] = static_cast<float> (sum);
+    }
+
+    // Triangle over two hops, divided by the analysis window at the same positions.
+    synthesisWindow.resize (2 * numOutputSamples);
+    for (int i = 0; i < 2 * numOutputSamples; ++i)
+    {
+        const int u = i - numOutputSamples;
+        const double triangle = 1.0 - std::abs (u) / static_cast<double> (numOutputSamples);
+        synthesisWindow[i] = static_cast<float> (triangle / blackmanHarris (fftSize / 2 + u, fftSize));
+    }
+}
+
+void InverseFFTSynthesizer::reset()
+{
+    previousPhase = 0.0;
+    centerPhase = 0.0;
+    previousF0.reset();
+    std::fill (frame.begin(), frame.end(), 0.f);
+    std::fill (overlapBuffer.begin(), overlapBuffer.end(), 0.f);
+    std::fill (renderBuffer.begin(), renderBuffer.end(), 0.f);
+}
+
+} // namespace ddsp
@@ -0,0 +1,68 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <optional>
+
+#include "JuceHeader.h"
+
+#include "audio/FFTBackend.h"
+#include "audio/HarmonicSynthesizerBase.h"
+
+namespace ddsp
+{
+
+class InverseFFTSynthesizer : public HarmonicSynthesizerBase
+{
+public:
+    InverseFFTSynthesizer (int numHarmonics, int numOutputSamples, float sampleRate);
+
+    // Clears all internal scratch buffers and state variables.
+    void reset() override;
+
+    std::span<const float> render (std::vector<float>& harmonicDistribution, float amplitude, float f0) override;
+
+    // Half-width of the window's main lobe in bins. Each harmonic is written into 2 * kLobeHalfWidth bins.
+    static constexpr int kLobeHalfWidth = 4;
+    // Number of main lobe samples stored per bin.
+    static constexpr int kLobeOversampling = 64;
+
+private:
+    void createWindows();
+    void writeHarmonicsToSpectrum (const std::vector<float>& harmonicDistribution, float f0);
+    void overlapAdd();
+
+    // Harmonic synthesizer state-related variables.
+    double previousPhase;
+    // Phase of the fundamental at the center of the current frame.
+    double centerPhase;
+    std::optional<float> previousF0;
+
+    const int numHarmonics, numOutputSamples;
+    const float sampleRate;
+
+    std::unique_ptr<FFTEngine> fft;
+    // Interleaved complex spectrum of the current frame; becomes the time-domain frame after the inverse FFT.
+    std::vector<float> frame;
+    // Main lobe of the Blackman-Harris window's transform, sampled every 1 / kLobeOversampling bins.
+    std::vector<float> lobe;
+    // Triangular overlap-add window divided by the Blackman-Harris analysis window, over two hops.
+    std::vector<float> synthesisWindow;
+    std::vector<float> overlapBuffer, renderBuffer;
+};
+
+} // namespace ddsp
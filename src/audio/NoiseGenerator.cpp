@@ -0,0 +1,163 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*
+Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+SC '11) encrypts a 128-bit counter with a 64-bit key in ten rounds of 32-bit
+multiplies and xors. The counter holds the block index in its low 64 bits and
+the stream in the next 32, and the key is the seed.
+
+Blocks do not depend on each other, so the kernel runs kNumLanes of them side
+by side in plain arrays. The rounds are then the same operation on every lane,
+which the compiler turns into vector multiplies and xors without any
+intrinsics. The top 24 bits of each word are used as a signed integer and
+scaled to [-1, 1), which is exact in float.
+*/
+
+#include "audio/NoiseGenerator.h"
+
+namespace ddsp
+{
+
+namespace
+{
+    using juce::uint32;
+    using juce::uint64;
+
+    constexpr uint32 kMultiplier0 = 0xD2511F53;
+    constexpr uint32 kMultiplier1 = 0xCD9E8D57;
+    constexpr uint32 kKeyIncrement0 = 0x9E3779B9;
+    constexpr uint32 kKeyIncrement1 = 0xBB67AE85;
+    constexpr int kNumRounds = 10;
+
+    // Blocks encrypted together by the vectorized kernel.
+    constexpr int kNumLanes = 16;
+
+    struct Lanes
+    {
+        uint32 word[4][kNumLanes];
+    };
+
+    // Encrypts the counters in place.
+    void philoxRounds (Lanes& counters, std::array<uint32, 2> key)
+    {
+        for (int round = 0; round < kNumRounds; ++round)
+        {
+            for (int lane = 0; lane < kNumLanes; ++lane)
+            {
+                const uint64 product0 = static_cast<uint64> (kMultiplier0) * counters.word[0][lane];
+                const uint64 product1 = static_cast<uint64> (kMultiplier1) * counters.word[2][lane];
+
+                const uint32 word0 = static_cast<uint32> (product1 >> 32) ^ counters.word[1][lane] ^ key[0];
+                const uint32 word2 = static_cast<uint32> (product0 >> 32) ^ counters.word[3][lane] ^ key[1];
+                counters.word[0][lane] = word0;
+                counters.word[1][lane] = static_cast<uint32> (product1);
+                counters.word[2][lane] = word2;
+                counters.word[3][lane] = static_cast<uint32> (product0);
+            }
+
+            key[0] += kKeyIncrement0;
+            key[1] += kKeyIncrement1;
+        }
+    }
+
+    void loadCounters (Lanes& counters, uint64 firstBlock, uint32 stream)
+    {
+        for (int lane = 0; lane < kNumLanes; ++lane)
+        {
+            const uint64 block = firstBlock + static_cast<uint64> (lane);
+            counters.word[0][lane] = static_cast<uint32> (block);
+            counters.word[1][lane] = static_cast<uint32> (block >> 32);
+            counters.word[2][lane] = stream;
+            counters.word[3][lane] = 0;
+        }
+    }
+
+    float toUniform (uint32 bits)
+    {
+        constexpr float scale = 1.f / (1 << 23);
+        return static_cast<float> (static_cast<juce::int32> (bits) >> 8) * scale;
+    }
+} // namespace
+
+NoiseGenerator::NoiseGenerator (uint64 seed, uint32 s) { setSeed (seed, s); }
+
+void NoiseGenerator::setSeed (uint64 seed, uint32 s)
+{
+    key = { static_cast<uint32> (seed), static_cast<uint32> (seed >> 32) };
+    stream = s;
+    position = 0;
+}
+
+void NoiseGenerator::fillUniform (float* output, int numSamples)
+{
+    // Finish the block an earlier call stopped inside of.
+    const int offset = static_cast<int> (position % kBlockSize);
+    if (offset != 0 && numSamples > 0)
+    {
+        float block[kBlockSize];
+        generateBlocks (position / kBlockSize, 1, block);
+        const int numFromBlock = std::min (kBlockSize - offset, numSamples);
+        std::copy (block + offset, block + offset + numFromBlock, output);
+        output += numFromBlock;
+        numSamples -= numFromBlock;
+        position += static_cast<uint64> (numFromBlock);
+    }
+
+    const int numBlocks = numSamples / kBlockSize;
+    generateBlocks (position / kBlockSize, numBlocks, output);
+    output += numBlocks * kBlockSize;
+    numSamples -= numBlocks * kBlockSize;
+    position += static_cast<uint64> (numBlocks * kBlockSize);
+
+    if (numSamples > 0)
+    {
+        float block[kBlockSize];
+        generateBlocks (position / kBlockSize, 1, block);
+        std::copy (block, block + numSamples, output);
+        position += static_cast<uint64> (numSamples);
+    }
+}
+
+void NoiseGenerator::generateBlocks (uint64 firstBlock, int numBlocks, float* output) const
+{
+    Lanes counters;
+    for (int group = 0; group < numBlocks; group += kNumLanes)
+    {
+        loadCounters (counters, firstBlock + static_cast<uint64> (group), stream);
+        philoxRounds (counters, key);
+
+        // The last group may not need every lane.
+        const int numLanes = std::min (kNumLanes, numBlocks - group);
+        float* groupOutput = output + group * kBlockSize;
+        for (int lane = 0; lane < numLanes; ++lane)
+            for (int word = 0; word < kBlockSize; ++word)
+                groupOutput[lane * kBlockSize + word] = toUniform (counters.word[word][lane]);
+    }
+}
+
+std::array<uint32, 4> NoiseGenerator::generateBlock (uint64 block) const
+{
+    Lanes counters;
+    loadCounters (counters, block, stream);
+    philoxRounds (counters, key);
+    return { counters.word[0][0], counters.word[1][0], counters.word[2][0], counters.word[3][0] };
+}
+
+uint64 NoiseGenerator::getPosition() const { return position; }
+
+void NoiseGenerator::seek (uint64 p) { position = p; }
+
+} // namespace ddsp
@@ -0,0 +1,59 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// Counter-based white noise source (Philox4x32-10). Every block of four samples is a pure function
+// of the seed, the stream and the block's position, so streams are reproducible, independent of how
+// they are split into calls, can be seeked, and are generated many blocks at a time.
+class NoiseGenerator
+{
+public:
+    // Samples per Philox block.
+    static constexpr int kBlockSize = 4;
+
+    // Different seeds give unrelated noise; different streams of one seed give unrelated noise too,
+    // e.g. one per instance or per voice.
+    explicit NoiseGenerator (juce::uint64 seed = 0, juce::uint32 stream = 0);
+
+    // Restarts at the beginning of the given stream.
+    void setSeed (juce::uint64 seed, juce::uint32 stream = 0);
+
+    // Writes the next `numSamples` samples of uniform noise in [-1, 1) to `output`.
+    void fillUniform (float* output, int numSamples);
+
+    // Number of samples generated since the beginning of the stream, and a jump to any such point.
+    juce::uint64 getPosition() const;
+    void seek (juce::uint64 position);
+
+    // The four raw 32-bit words of block `block`, without touching the position. A pure function of
+    // the block index, for drawing random integers per event (NoiseSynthesizer picks the spectrum and
+    // read offset of each spectral hop this way) and for checking against published test vectors.
+    std::array<juce::uint32, 4> generateBlock (juce::uint64 block) const;
+
+private:
+    void generateBlocks (juce::uint64 firstBlock, int numBlocks, float* output) const;
+
+    std::array<juce::uint32, 2> key;
+    juce::uint32 stream;
+    juce::uint64 position = 0;
+};
+
+} // namespace ddsp
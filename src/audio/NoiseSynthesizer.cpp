@@ -23,7 +23,48 @@ to the impulse response in the time domain in order to smooth and enhance it.
 See https://ccrma.stanford.edu/~jos/sasp/Windowing_Desired_Impulse_Response.html
 for more details.
  
-The filter and noise are generated dynamically for every call to render().
+The noise is one continuous stream filtered by overlap-add: each hop draws a
+hop's worth of fresh noise, convolves it linearly with that hop's filter, and
+adds the filter tail it leaves behind to the start of the next hop. The filter
+is linear phase and causal, so the noise of a hop comes out centred half an
+impulse response after the hop starts. Cancelling that would need the next
+hop's filter before the next hop's magnitudes are known, so the delay is kept
+and reported by getGroupDelay() instead, for the caller to delay whatever it
+mixes the noise with.
+
+The filter is only redesigned
+when the noise magnitudes move away from the ones it was last designed from: the
+design is linear in the magnitudes, so reusing it while the largest change stays
+below a small fraction of the largest magnitude keeps the spectral error at that
+fraction of the filter's peak gain. Sustained notes skip the inverse FFT, window,
+rotate and forward FFT of the impulse response on most hops this way.
+
+The design can also run as a matrix-vector product. Sampling the bands,
+the inverse FFT, the window and the rotation are all linear, so the impulse
+response is a sum of the impulse responses of the individual bands weighted by
+their magnitudes. Those are designed once at construction. The impulse
+response of a real, zero-phase spectrum is symmetric about its centre, so only
+the second half is stored and summed, and the first half is mirrored from it.
+
+The spectral mode skips the white noise altogether. White noise has a flat
+spectrum with random phases, so a bank of random-phase spectra is built once,
+scaled so that their inverse transforms have the variance of uniform noise in
+[-1, 1). Each hop multiplies one of them by the filter and runs a single
+inverse FFT. The result is filtered noise that is periodic over the FFT size, so
+it can be read from any offset around the circle. A counter-based draw per hop
+picks the spectrum, never the previous hop's, and the offset. Consecutive hops
+are then independent, and they are joined with a power-complementary (sine and
+cosine) crossfade, which keeps the variance through the join. The crossfade
+spans an impulse response, so that the join is centred on the same group delay
+as the ramp of the time-domain filter.
+
+The model's noise magnitudes describe bands evenly spaced from 0 Hz to the
+model's Nyquist frequency. Above the model rate, the filter is designed at the
+synthesis rate by interpolating those bands at the FFT bins below the model
+Nyquist frequency and leaving the bins above it empty. The impulse response
+gets longer in proportion to keep the same frequency resolution. White noise at
+a higher rate spreads the same power over a wider band, so the filter gain is
+raised by sqrt (rate / model rate) to keep the level in the audible band.
 */
 
 #include "audio/NoiseSynthesizer.h"
@@ -32,80 +73,311 @@ The filter and noise are generated dynamically for every call to render().
 namespace ddsp
 {
 
+namespace
+{
+    int fftOrderForSize (int size) { return juce::roundToInt (std::log2 (size)); }
+} // namespace
+
 using namespace juce;
 
-NoiseSynthesizer::NoiseSynthesizer (int nna, int nos)
-    : impulseResponseSize ((nna - 1) * 2), numOutputSamples (nos), windowFFT (7), convolveFFT (9)
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::BasicNoiseSynthesizer (int nna, int nos, juce::uint64 s)
+    : numNoiseAmplitudes (nna),
+      numOutputSamples (nos),
+      impulseResponseSize (impulseResponseSizeFor (nna, nos)),
+      convolutionSize (nextPowerOfTwo (nos + impulseResponseSizeFor (nna, nos) - 1)),
+      crossfadeSize (crossfadeSizeFor (nos, impulseResponseSize, convolutionSize)),
+      designMatrixStride (designMatrixStrideFor (impulseResponseSizeFor (nna, nos))),
+      bandsPerBin (2.f * (nna - 1) * nos / (static_cast<float> (kModelHopSize) * impulseResponseSize)),
+      impulseResponseGain (std::sqrt (nos / static_cast<float> (kModelHopSize))),
+      seed (s),
+      windowFFT (createFFT (fftOrderForSize (impulseResponseSize), getFastestFFTBackend())),
+      convolveFFT (createFFT (fftOrderForSize (convolutionSize), getFastestFFTBackend()))
 {
     createZeroPhaseHannWindow();
-    noiseAudio.resize (numOutputSamples);
-    magnitudes.resize (windowFFT.getSize());
-    windowedImpulseResponse.resize (convolveFFT.getSize() * 2);
-    whiteNoise.resize (convolveFFT.getSize() * 2);
+    resizeBuffer (noiseAudio, numOutputSamples);
+    resizeBuffer (magnitudes, impulseResponseSize);
+    resizeBuffer (windowedImpulseResponse, convolutionSize * 2);
+    resizeBuffer (whiteNoise, convolutionSize * 2);
+    resizeBuffer (overlapTail, impulseResponseSize);
+    resizeBuffer (cachedMagnitudes, numNoiseAmplitudes);
+    resizeBuffer (crossfadeTail, crossfadeSize);
+    resizeBuffer (crossfadeWindow, crossfadeSize);
+    for (int i = 0; i < crossfadeSize; i++)
+        crossfadeWindow[i] = std::sin (MathConstants<float>::halfPi * (i + 0.5f) / static_cast<float> (crossfadeSize));
+    createNoiseSpectrumBank();
+    createDesignMatrix();
 }
 
-const std::vector<float>& NoiseSynthesizer::render (const std::vector<float>& mags)
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+std::span<const float> BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::render (
+    const std::vector<float>& mags)
 {
-    applyWindowToImpulseResponse (mags);
-    convolve();
+    updateImpulseResponse (mags);
+    renderHop (noiseAudio.data());
     return noiseAudio;
 }
 
-void NoiseSynthesizer::applyWindowToImpulseResponse (const std::vector<float>& mags)
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::renderFrames (const SynthesisControls* frames,
+                                                                               int numFrames,
+                                                                               float* output)
+{
+    // The white noise of each hop is drawn after the previous hop's, so the frames stay in order.
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        updateImpulseResponse (frames[frame].noiseAmps);
+        renderHop (output + frame * numOutputSamples);
+    }
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::renderHop (float* output)
+{
+    const auto mode = synthesisMode.load();
+    if (mode != previousSynthesisMode)
+    {
+        // Start the new mode afresh rather than joining it to the other mode's state.
+        std::fill (overlapTail.begin(), overlapTail.end(), 0.f);
+        crossfadeTailValid = false;
+        previousSynthesisMode = mode;
+    }
+
+    if (mode == NoiseSynthesisMode::kSpectral)
+        shapeNoiseSpectrum (output);
+    else
+        convolve (output);
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::updateImpulseResponse (const std::vector<float>& mags)
+{
+    if (canReuseImpulseResponse (mags))
+    {
+        ++numImpulseResponseCacheHits;
+        return;
+    }
+
+    if (impulseResponseDesign.load() == ImpulseResponseDesign::kMatrix)
+        multiplyDesignMatrix (mags);
+    else
+        applyWindowToImpulseResponse (mags);
+
+    convolveFFT->performRealOnlyForwardTransform (windowedImpulseResponse.data());
+    ++numForwardFFTs;
+    std::copy (mags.begin(), mags.end(), cachedMagnitudes.begin());
+    impulseResponseCached = true;
+    ++numImpulseResponseDesigns;
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+bool BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::canReuseImpulseResponse (
+    const std::vector<float>& mags) const
+{
+    jassert (static_cast<int> (mags.size()) == numNoiseAmplitudes);
+
+    const float threshold = impulseResponseCacheThreshold.load();
+    if (! impulseResponseCached || threshold <= 0.f)
+        return false;
+
+    // Compare against the magnitudes the filter was designed from, not the last hop's, so that slow
+    // drifts still trigger a redesign.
+    float largestChange = 0.f, largestMagnitude = 0.f;
+    for (int i = 0; i < numNoiseAmplitudes; ++i)
+    {
+        largestChange = std::max (largestChange, std::abs (mags[i] - cachedMagnitudes[i]));
+        largestMagnitude = std::max (largestMagnitude, std::abs (cachedMagnitudes[i]));
+    }
+
+    return largestChange <= threshold * largestMagnitude;
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::applyWindowToImpulseResponse (
+    const std::vector<float>& mags)
 {
-    // Clear and fill complex vector for ifft
+    jassert (static_cast<int> (mags.size()) == numNoiseAmplitudes);
+
+    // Clear and fill complex vector for ifft, sampling the noise bands at the bins of the synthesis rate.
     std::fill (magnitudes.begin(), magnitudes.end(), 0.f);
-    for (int i = 0; i < mags.size(); i++)
-        magnitudes[i].real (mags[i]);
+    const int lastBand = numNoiseAmplitudes - 1;
+    for (int i = 0; i <= impulseResponseSize / 2; i++)
+    {
+        const float band = i * bandsPerBin;
+        if (band > static_cast<float> (lastBand))
+            break;
+
+        const int index = static_cast<int> (band);
+        const float fraction = band - static_cast<float> (index);
+        const float magnitude =
+            index < lastBand ? mags[index] + fraction * (mags[index + 1] - mags[index]) : mags[lastBand];
+        magnitudes[i].real (magnitude * impulseResponseGain);
+    }
 
     // Cast complex* to float* for use with JUCE fft
     auto impulseResponse = reinterpret_cast<float*> (magnitudes.data());
 
     // Obtain impulse response
-    windowFFT.performRealOnlyInverseTransform (impulseResponse);
+    windowFFT->performRealOnlyInverseTransform (impulseResponse);
+    ++numInverseFFTs;
 
     // Apply the window to the IR
     juce::FloatVectorOperations::multiply (impulseResponse, zpHannWindow.data(), impulseResponseSize);
 
     // Put into causal form
-    std::rotate (impulseResponse, impulseResponse + windowFFT.getSize() / 2, impulseResponse + windowFFT.getSize());
+    std::rotate (impulseResponse, impulseResponse + windowFFT->getSize() / 2, impulseResponse + windowFFT->getSize());
 
     std::fill (windowedImpulseResponse.begin(), windowedImpulseResponse.end(), 0.f);
     std::copy (impulseResponse, impulseResponse + impulseResponseSize, windowedImpulseResponse.begin());
 }
 
-void NoiseSynthesizer::convolve()
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::multiplyDesignMatrix (const std::vector<float>& mags)
 {
-    for (int i = 0; i < whiteNoise.size(); i++)
-        whiteNoise[i] = jmap (random.nextFloat(), -1.f, 1.f);
+    jassert (static_cast<int> (mags.size()) == numNoiseAmplitudes);
+
+    // Sum the second half of the impulse response straight into place, from its centre on. Its last
+    // tap lands one past the end of the impulse response and belongs at its start.
+    const int centre = impulseResponseSize / 2;
+    const int numTaps = centre + 1;
+    auto secondHalf = windowedImpulseResponse.data() + centre;
 
-    convolveFFT.performRealOnlyForwardTransform (whiteNoise.data());
-    convolveFFT.performRealOnlyForwardTransform (windowedImpulseResponse.data());
+    juce::FloatVectorOperations::multiply (secondHalf, designMatrix, mags[0], numTaps);
+    for (int band = 1; band < numNoiseAmplitudes; band++)
+        juce::FloatVectorOperations::addWithMultiply (
+            secondHalf, designMatrix + band * designMatrixStride, mags[band], numTaps);
+
+    // Mirror the first half, and clear the zero padding.
+    for (int i = 1; i <= centre; i++)
+        windowedImpulseResponse[centre - i] = secondHalf[i];
+    std::fill (windowedImpulseResponse.begin() + impulseResponseSize, windowedImpulseResponse.end(), 0.f);
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::convolve (float* output)
+{
+    // Draw the next hop of the noise stream and zero-pad it for a linear convolution.
+    noiseGenerator.fillUniform (whiteNoise.data(), numOutputSamples);
+    std::fill (whiteNoise.begin() + numOutputSamples, whiteNoise.end(), 0.f);
+
+    convolveFFT->performRealOnlyForwardTransform (whiteNoise.data());
+    ++numForwardFFTs;
 
     auto whiteNoiseFreqs = reinterpret_cast<std::complex<float>*> (whiteNoise.data());
-    auto impulseResponseFreqs = reinterpret_cast<std::complex<float>*> (windowedImpulseResponse.data());
+    auto impulseResponseFreqs = reinterpret_cast<const std::complex<float>*> (windowedImpulseResponse.data());
 
     // Filter the white noise
-    for (int i = 0; i < convolveFFT.getSize() / 2 + 1; i++)
-        whiteNoiseFreqs[i] *= impulseResponseFreqs[i];
+    multiplySpectra (whiteNoiseFreqs, whiteNoiseFreqs, impulseResponseFreqs, convolveFFT->getSize() / 2 + 1);
+
+    convolveFFT->performRealOnlyInverseTransform (whiteNoise.data());
+    ++numInverseFFTs;
+
+    overlapAdd (whiteNoise.data(), output);
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::overlapAdd (float* filteredNoise, float* output)
+{
+    // The hop's filtered noise is numOutputSamples + impulseResponseSize - 1 samples long. Its start
+    // overlaps the tail of the previous hops, and what runs past the hop becomes the new tail.
+    const int tailSize = impulseResponseSize - 1;
+    juce::FloatVectorOperations::add (filteredNoise, overlapTail.data(), tailSize);
+    std::copy (filteredNoise, filteredNoise + numOutputSamples, output);
+    std::copy (filteredNoise + numOutputSamples, filteredNoise + numOutputSamples + tailSize, overlapTail.begin());
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::shapeNoiseSpectrum (float* output)
+{
+    // Pick a spectrum other than the previous hop's, and where to start reading its filtered noise.
+    const auto choice = spectrumSelector.generateBlock (spectralHopIndex++);
+    const int spectrum = (previousNoiseSpectrum + 1 + static_cast<int> (choice[0] % (kNumNoiseSpectra - 1)))
+                         % kNumNoiseSpectra;
+    const int offset = static_cast<int> (choice[1] % static_cast<juce::uint32> (convolutionSize));
+    previousNoiseSpectrum = spectrum;
+
+    const int numBins = convolutionSize / 2 + 1;
+    auto noiseFreqs = noiseSpectra.data() + spectrum * numBins;
+    auto impulseResponseFreqs = reinterpret_cast<const std::complex<float>*> (windowedImpulseResponse.data());
+    auto filteredFreqs = reinterpret_cast<std::complex<float>*> (whiteNoise.data());
+
+    // Filter the noise spectrum
+    multiplySpectra (filteredFreqs, noiseFreqs, impulseResponseFreqs, numBins);
+
+    convolveFFT->performRealOnlyInverseTransform (whiteNoise.data());
+    ++numInverseFFTs;
+
+    const int wrapMask = convolutionSize - 1;
+    const auto filteredNoise = [&] (int i) { return whiteNoise[(offset + i) & wrapMask]; };
 
-    convolveFFT.performRealOnlyInverseTransform (whiteNoise.data());
+    for (int i = 0; i < crossfadeSize; i++)
+    {
+        const float fadingIn = filteredNoise (i) * (crossfadeTailValid ? crossfadeWindow[i] : 1.f);
+        output[i] = fadingIn + (crossfadeTailValid ? crossfadeTail[i] : 0.f);
+    }
+    for (int i = crossfadeSize; i < numOutputSamples; i++)
+        output[i] = filteredNoise (i);
 
-    cropAndCompensateDelay (whiteNoise, impulseResponseSize);
+    // The continuation of this hop fades out under the start of the next one.
+    for (int i = 0; i < crossfadeSize; i++)
+        crossfadeTail[i] = filteredNoise (numOutputSamples + i) * crossfadeWindow[crossfadeSize - 1 - i];
+    crossfadeTailValid = true;
 }
 
-void NoiseSynthesizer::cropAndCompensateDelay (const std::vector<float>& inputAudio, int irSize)
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::createNoiseSpectrumBank()
 {
-    // Compensate for the group delay of the filter by trimming the front.
-    // The group delay is constant because the filter is linear phase.
-    auto start = inputAudio.begin() + ((irSize - 1) / 2 - 1);
-    std::copy (start, start + numOutputSamples, noiseAudio.begin());
+    // Uniform noise in [-1, 1) has a variance of 1/3. The inverse FFT scales by 1 / N, so a flat
+    // spectrum of magnitude sqrt (N / 3) transforms back to noise with that variance.
+    const int numBins = convolutionSize / 2 + 1;
+    const float magnitude = std::sqrt (convolutionSize / 3.f);
+    resizeBuffer (noiseSpectra, kNumNoiseSpectra * numBins);
+
+    NoiseGenerator generator (seed, 2);
+    std::vector<float> phases (numBins);
+    for (int spectrum = 0; spectrum < kNumNoiseSpectra; spectrum++)
+    {
+        generator.fillUniform (phases.data(), numBins);
+        auto bins = noiseSpectra.data() + spectrum * numBins;
+        for (int i = 0; i < numBins; i++)
+            bins[i] = std::polar (magnitude, MathConstants<float>::pi * phases[i]);
+
+        // The DC and Nyquist bins of a real signal are real.
+        bins[0] = phases[0] < 0.f ? -magnitude : magnitude;
+        bins[numBins - 1] = phases[numBins - 1] < 0.f ? -magnitude : magnitude;
+    }
 }
 
-void NoiseSynthesizer::createZeroPhaseHannWindow()
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::createDesignMatrix()
+{
+    resizeBuffer (designMatrixStorage, numNoiseAmplitudes * designMatrixStride + kFloatsPerAlignment);
+    designMatrix = snapPointerToAlignment (designMatrixStorage.data(), kDesignMatrixAlignment_bytes);
+
+    // Design the impulse response of each band on its own.
+    const int centre = impulseResponseSize / 2;
+    std::vector<float> band (numNoiseAmplitudes, 0.f);
+    for (int j = 0; j < numNoiseAmplitudes; j++)
+    {
+        band[j] = 1.f;
+        applyWindowToImpulseResponse (band);
+        band[j] = 0.f;
+
+        auto column = designMatrix + j * designMatrixStride;
+        std::copy (
+            windowedImpulseResponse.begin() + centre, windowedImpulseResponse.begin() + impulseResponseSize, column);
+        column[centre] = windowedImpulseResponse[0];
+    }
+
+    std::fill (windowedImpulseResponse.begin(), windowedImpulseResponse.end(), 0.f);
+    numInverseFFTs = 0;
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::createZeroPhaseHannWindow()
 {
     // Create Hann Window
-    zpHannWindow.resize (impulseResponseSize);
+    resizeBuffer (zpHannWindow, impulseResponseSize);
     for (int i = 0; i < zpHannWindow.size(); i++)
         zpHannWindow[i] = 0.5f * (1.f - cos (MathConstants<float>::twoPi * i / (float) zpHannWindow.size()));
 
@@ -113,13 +385,99 @@ void NoiseSynthesizer::createZeroPhaseHannWindow()
     std::rotate (zpHannWindow.begin(), zpHannWindow.begin() + zpHannWindow.size() / 2, zpHannWindow.end());
 }
 
-void NoiseSynthesizer::reset()
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::reset()
 {
     std::fill (noiseAudio.begin(), noiseAudio.end(), 0.f);
     std::fill (whiteNoise.begin(), whiteNoise.end(), 0.f);
     std::fill (windowedImpulseResponse.begin(), windowedImpulseResponse.end(), 0.f);
+    std::fill (overlapTail.begin(), overlapTail.end(), 0.f);
     std::fill (magnitudes.begin(), magnitudes.end(), 0.f);
-    random.setSeed (42);
+    std::fill (cachedMagnitudes.begin(), cachedMagnitudes.end(), 0.f);
+    impulseResponseCached = false;
+    numImpulseResponseCacheHits = 0;
+    numImpulseResponseDesigns = 0;
+    numForwardFFTs = 0;
+    numInverseFFTs = 0;
+    noiseGenerator.setSeed (seed);
+
+    std::fill (crossfadeTail.begin(), crossfadeTail.end(), 0.f);
+    crossfadeTailValid = false;
+    previousNoiseSpectrum = 0;
+    spectralHopIndex = 0;
+    spectrumSelector.setSeed (seed, 1);
+    previousSynthesisMode = synthesisMode.load();
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::setSynthesisMode (NoiseSynthesisMode mode)
+{
+    synthesisMode = mode;
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+NoiseSynthesisMode BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getSynthesisMode() const
+{
+    return synthesisMode.load();
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::setImpulseResponseDesign (
+    ImpulseResponseDesign design)
+{
+    impulseResponseDesign = design;
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+ImpulseResponseDesign BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getImpulseResponseDesign() const
+{
+    return impulseResponseDesign.load();
 }
 
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+int BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getGroupDelay() const
+{
+    return impulseResponseSize / 2;
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+juce::int64 BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getNumForwardFFTs() const
+{
+    return numForwardFFTs.load();
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+juce::int64 BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getNumInverseFFTs() const
+{
+    return numInverseFFTs.load();
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+void BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::setImpulseResponseCacheThreshold (float threshold)
+{
+    impulseResponseCacheThreshold = std::max (threshold, 0.f);
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+float BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getImpulseResponseCacheThreshold() const
+{
+    return impulseResponseCacheThreshold.load();
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+juce::int64 BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getNumImpulseResponseCacheHits() const
+{
+    return numImpulseResponseCacheHits.load();
+}
+
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+juce::int64 BasicNoiseSynthesizer<NumNoiseAmplitudes, NumOutputSamples>::getNumImpulseResponseDesigns() const
+{
+    return numImpulseResponseDesigns.load();
+}
+
+template class BasicNoiseSynthesizer<kDynamicExtent, kDynamicExtent>;
+template class BasicNoiseSynthesizer<kNoiseAmpsSize, kModelHopSize>;
+template class BasicNoiseSynthesizer<kNoiseAmpsSize, kDynamicExtent>;
+
 } // namespace ddsp
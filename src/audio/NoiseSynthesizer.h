@@ -16,35 +16,217 @@ limitations under the License.
 
 #pragma once
 
+#include <span>
+
 #include "JuceHeader.h"
 
+#include "audio/FFTBackend.h"
+#include "audio/NoiseGenerator.h"
+#include "audio/tflite/ModelTypes.h"
+#include "util/Constants.h"
+#include "util/Extent.h"
+
 namespace ddsp
 {
 
-class NoiseSynthesizer
+enum class NoiseSynthesisMode
+{
+    // Fresh white noise every hop, transformed and filtered by overlap-add.
+    kTimeDomain,
+    // Random-phase spectra from a bank built at construction, filtered in the frequency domain and
+    // crossfaded between hops. Skips the forward FFT and the per-sample noise generation.
+    kSpectral,
+};
+
+enum class ImpulseResponseDesign
+{
+    // Sample the noise bands at the FFT bins, inverse FFT, window and rotate into causal form.
+    kInverseFFT,
+    // Weigh the windowed impulse responses of the individual bands, precomputed at construction, by
+    // the noise magnitudes. The design is linear, so the result is the same.
+    kMatrix,
+};
+
+// Filtered noise synthesizer for the noise magnitudes of the DDSP model outputs.
+// The number of noise magnitudes and the hop size are either template arguments, which makes every
+// buffer a std::array, or kDynamicExtent to set them at construction.
+// One hop always spans the duration of a model hop, so the hop size also sets the synthesis rate:
+// kModelHopSize samples per hop synthesize at the model rate, 960 at 48 kHz, and so on.
+template <int NumNoiseAmplitudes, int NumOutputSamples>
+class BasicNoiseSynthesizer
 {
 public:
-    NoiseSynthesizer (int numNoiseAmplitudes, int numOutputSamples);
+    // Keeps the error of a reused filter around 60 dB below its strongest band.
+    static constexpr float kDefaultImpulseResponseCacheThreshold = 1e-3f;
+    // Random-phase spectra in the bank of the spectral mode.
+    static constexpr int kNumNoiseSpectra = 16;
+    static constexpr juce::uint64 kDefaultSeed = 42;
+
+    // With static extents the sizes passed in must match the template arguments. Synthesizers with
+    // different seeds play unrelated noise, so every instance that is heard alongside others needs
+    // its own; the same seed always plays the same noise after reset().
+    BasicNoiseSynthesizer (int numNoiseAmplitudes, int numOutputSamples, juce::uint64 seed = kDefaultSeed);
 
     // Clears all internal scratch buffers and state variables.
     void reset();
 
-    const std::vector<float>& render (const std::vector<float>& mags);
+    std::span<const float> render (const std::vector<float>& mags);
+
+    // Renders `numFrames` consecutive hops from the frames' noise magnitudes straight into `output`.
+    // Bit-identical to calling render() for each frame in turn.
+    void renderFrames (const SynthesisControls* frames, int numFrames, float* output);
+
+    // The filter of the last designed hop is reused while no noise magnitude has moved from the
+    // ones it was designed from by more than `threshold` times the largest of them. 0 designs a
+    // filter for every hop.
+    void setImpulseResponseCacheThreshold (float threshold);
+    float getImpulseResponseCacheThreshold() const;
+
+    // Hops that reused the cached filter and hops that designed a new one since the last reset().
+    juce::int64 getNumImpulseResponseCacheHits() const;
+    juce::int64 getNumImpulseResponseDesigns() const;
+
+    // Takes effect from the next hop. Safe to call from any thread. The noise restarts without a
+    // crossfade when the mode changes, so it is meant to be chosen up front.
+    void setSynthesisMode (NoiseSynthesisMode mode);
+    NoiseSynthesisMode getSynthesisMode() const;
+
+    // Takes effect from the next filter that is designed. Safe to call from any thread.
+    void setImpulseResponseDesign (ImpulseResponseDesign design);
+    ImpulseResponseDesign getImpulseResponseDesign() const;
+
+    // Samples by which the noise trails the magnitudes of its hop: the group delay of the linear-phase
+    // filter, half an impulse response. Anything mixed with the noise has to be delayed by as much to
+    // stay in line with it.
+    int getGroupDelay() const;
+
+    // FFTs run since the last reset(), including the ones that design the filter.
+    juce::int64 getNumForwardFFTs() const;
+    juce::int64 getNumInverseFFTs() const;
 
 private:
+    static constexpr int nextPowerOfTwo (int n)
+    {
+        int power = 1;
+        while (power < n)
+        {
+            power *= 2;
+        }
+        return power;
+    }
+
+    // The model's impulse response length, scaled to the synthesis rate and rounded up for the FFT.
+    static constexpr int impulseResponseSizeFor (int numNoiseAmplitudes, int numOutputSamples)
+    {
+        return nextPowerOfTwo ((numNoiseAmplitudes - 1) * 2 * numOutputSamples / kModelHopSize);
+    }
+
+    static constexpr bool kIsStatic = NumNoiseAmplitudes != kDynamicExtent && NumOutputSamples != kDynamicExtent;
+    static constexpr int kImpulseResponseSize =
+        kIsStatic ? impulseResponseSizeFor (NumNoiseAmplitudes, NumOutputSamples) : kDynamicExtent;
+    // A hop of noise and the filter's tail fit in one linear convolution.
+    static constexpr int kConvolutionSize =
+        kIsStatic ? nextPowerOfTwo (NumOutputSamples + kImpulseResponseSize - 1) : kDynamicExtent;
+    static constexpr int kConvolutionBufferSize = kIsStatic ? 2 * kConvolutionSize : kDynamicExtent;
+    static constexpr int kSpectrumBankSize = kIsStatic ? kNumNoiseSpectra * (kConvolutionSize / 2 + 1) : kDynamicExtent;
+    // Hops of spectral noise are crossfaded over an impulse response, which centres the join on the
+    // group delay like the filter's own ramp in the time domain, or over as much of the next hop as
+    // one spectrum can supply if that is less.
+    static constexpr int crossfadeSizeFor (int numOutputSamples, int impulseResponseSize, int convolutionSize)
+    {
+        return std::min ({ impulseResponseSize, numOutputSamples, convolutionSize - numOutputSamples });
+    }
+    static constexpr int kCrossfadeSize =
+        kIsStatic ? crossfadeSizeFor (NumOutputSamples, kImpulseResponseSize, kConvolutionSize) : kDynamicExtent;
+    // The impulse response is symmetric about its centre, so the design matrix holds its second half,
+    // impulseResponseSize / 2 + 1 taps, for each band. Columns start on kDesignMatrixAlignment_bytes
+    // boundaries and the storage holds one spare line so that its start can be aligned.
+    static constexpr int kDesignMatrixAlignment_bytes = 64;
+    static constexpr int kFloatsPerAlignment = kDesignMatrixAlignment_bytes / sizeof (float);
+    static constexpr int designMatrixStrideFor (int impulseResponseSize)
+    {
+        return (impulseResponseSize / 2 + 1 + kFloatsPerAlignment - 1) / kFloatsPerAlignment * kFloatsPerAlignment;
+    }
+    static constexpr int kDesignMatrixStride =
+        kIsStatic ? designMatrixStrideFor (kImpulseResponseSize) : kDynamicExtent;
+    static constexpr int kDesignMatrixStorageSize =
+        kIsStatic ? NumNoiseAmplitudes * kDesignMatrixStride + kFloatsPerAlignment : kDynamicExtent;
+
     void createZeroPhaseHannWindow();
+    void createNoiseSpectrumBank();
+    void createDesignMatrix();
+
+    void renderHop (float* output);
 
+    void updateImpulseResponse (const std::vector<float>& mags);
+    bool canReuseImpulseResponse (const std::vector<float>& mags) const;
     void applyWindowToImpulseResponse (const std::vector<float>& mags);
-    void convolve();
-    void cropAndCompensateDelay (const std::vector<float>& audio, int irSize);
+    void multiplyDesignMatrix (const std::vector<float>& mags);
+    void convolve (float* output);
+    void overlapAdd (float* filteredNoise, float* output);
+    void shapeNoiseSpectrum (float* output);
+
+    ExtentBuffer<float, kImpulseResponseSize> zpHannWindow;
+    ExtentBuffer<float, NumOutputSamples> noiseAudio;
+    ExtentBuffer<float, kConvolutionBufferSize> windowedImpulseResponse, whiteNoise;
+    // Filtered noise of the previous hops that reaches into the next one, impulseResponseSize - 1 samples.
+    ExtentBuffer<float, kImpulseResponseSize> overlapTail;
+    ExtentBuffer<std::complex<float>, kImpulseResponseSize> magnitudes;
+    // Noise magnitudes the spectrum in `windowedImpulseResponse` was designed from.
+    ExtentBuffer<float, NumNoiseAmplitudes> cachedMagnitudes;
+    bool impulseResponseCached = false;
 
-    std::vector<float> zpHannWindow, noiseAudio, windowedImpulseResponse, whiteNoise;
-    std::vector<std::complex<float>> magnitudes;
+    // Column j is the second half of the impulse response designed from band j alone.
+    ExtentBuffer<float, kDesignMatrixStorageSize> designMatrixStorage;
+    float* designMatrix;
 
-    const int impulseResponseSize, numOutputSamples;
+    // Spectral mode: kNumNoiseSpectra spectra of convolutionSize / 2 + 1 bins each.
+    ExtentBuffer<std::complex<float>, kSpectrumBankSize> noiseSpectra;
+    // Rising half of the power-complementary crossfade, and the faded-out continuation of the last hop.
+    ExtentBuffer<float, kCrossfadeSize> crossfadeWindow, crossfadeTail;
+    bool crossfadeTailValid = false;
+    int previousNoiseSpectrum = 0;
+    juce::uint64 spectralHopIndex = 0;
 
-    juce::dsp::FFT windowFFT, convolveFFT;
-    juce::Random random;
+    const Extent<NumNoiseAmplitudes> numNoiseAmplitudes;
+    const Extent<NumOutputSamples> numOutputSamples;
+    const Extent<kImpulseResponseSize> impulseResponseSize;
+    const Extent<kConvolutionSize> convolutionSize;
+    const Extent<kCrossfadeSize> crossfadeSize;
+    const Extent<kDesignMatrixStride> designMatrixStride;
+
+    // Noise bands per FFT bin of the impulse response at the synthesis rate.
+    const float bandsPerBin;
+    // Keeps the noise power below the model Nyquist frequency independent of the synthesis rate.
+    const float impulseResponseGain;
+    // Keys the white noise, the spectrum selection and the spectrum bank, one stream each.
+    const juce::uint64 seed;
+
+    std::unique_ptr<FFTEngine> windowFFT, convolveFFT;
+    NoiseGenerator noiseGenerator;
+    // Picks the spectrum and read offset of each spectral hop.
+    NoiseGenerator spectrumSelector;
+
+    std::atomic<ImpulseResponseDesign> impulseResponseDesign = { ImpulseResponseDesign::kInverseFFT };
+    std::atomic<NoiseSynthesisMode> synthesisMode = { NoiseSynthesisMode::kTimeDomain };
+    NoiseSynthesisMode previousSynthesisMode = NoiseSynthesisMode::kTimeDomain;
+    std::atomic<juce::int64> numForwardFFTs = { 0 };
+    std::atomic<juce::int64> numInverseFFTs = { 0 };
+
+    std::atomic<float> impulseResponseCacheThreshold = { kDefaultImpulseResponseCacheThreshold };
+    std::atomic<juce::int64> numImpulseResponseCacheHits = { 0 };
+    std::atomic<juce::int64> numImpulseResponseDesigns = { 0 };
 };
 
+// Runtime-sized synthesizer for models with any number of noise magnitudes and hop size.
+using NoiseSynthesizer = BasicNoiseSynthesizer<kDynamicExtent, kDynamicExtent>;
+// Synthesizer specialized for the shape of the embedded models.
+using StaticNoiseSynthesizer = BasicNoiseSynthesizer<kNoiseAmpsSize, kModelHopSize>;
+// Synthesizer for the embedded models at the host sample rate.
+using HostRateNoiseSynthesizer = BasicNoiseSynthesizer<kNoiseAmpsSize, kDynamicExtent>;
+
+extern template class BasicNoiseSynthesizer<kDynamicExtent, kDynamicExtent>;
+extern template class BasicNoiseSynthesizer<kNoiseAmpsSize, kModelHopSize>;
+extern template class BasicNoiseSynthesizer<kNoiseAmpsSize, kDynamicExtent>;
+
 } // namespace ddsp
@@ -0,0 +1,206 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Evaluating sin (k * θ) for every harmonic k at every sample is expensive, so the
+bank only evaluates the fundamental rotor z = e^(iθ) = cos θ + i sin θ once per
+sample and reaches the higher harmonics through the complex recurrence
+
+    e^(ikθ) = e^(i(k-1)θ) * e^(iθ)
+
+whose imaginary part is the desired sin (kθ). The recurrence runs across the
+harmonic index, so the samples of a tile are independent of each other and map
+directly onto SIMD lanes. juce::dsp::SIMDRegister picks SSE, AVX or NEON for the
+target at compile time; a scalar loop is used where JUCE provides no SIMD support.
+
+Samples are processed in tiles of kTileSize so that the amplitudes, rotors and
+output of a tile stay in L1 while every harmonic is accumulated into the output.
+
+Only the harmonics named in the active list are accumulated. To skip over the
+inactive ones without stepping through each of them, the powers z^2, z^4, z^8...
+of the fundamental rotor are precomputed per tile by repeated squaring, and a gap
+of d harmonics costs one rotation per set bit of d. The cost of a hop therefore
+scales with the number of audible partials rather than the harmonic count.
+
+Each complex multiply in float adds a rounding error of a few ulps to the rotor
+magnitude. To keep the harmonics from slowly growing or decaying, the rotors are
+renormalized every kRenormalizationInterval rotations with one Newton step of
+1 / |z|, which is exact to first order since |z| stays within ~1e-6 of 1.
+Against a double-precision reference the output SNR is above 100 dB for 60
+harmonics (see tests/HarmonicSynthesizer_Test.cpp).
+*/
+
+#include "audio/OscillatorBank.h"
+
+namespace ddsp
+{
+
+namespace
+{
+    // Multiplies the rotors (aReal, aImag) by (bReal, bImag) lane by lane into (outReal, outImag),
+    // optionally pulling the result back onto the unit circle. The output may alias either input.
+    void multiplyRotors (const float* aReal,
+                         const float* aImag,
+                         const float* bReal,
+                         const float* bImag,
+                         float* outReal,
+                         float* outImag,
+                         bool renormalize)
+    {
+#if JUCE_USE_SIMD
+        using Vec = juce::dsp::SIMDRegister<float>;
+        constexpr int step = static_cast<int> (Vec::SIMDNumElements);
+        static_assert (OscillatorBank::kTileSize % step == 0, "The tile must hold a whole number of SIMD registers.");
+
+        for (int i = 0; i < OscillatorBank::kTileSize; i += step)
+        {
+            const auto ar = Vec::fromRawArray (aReal + i);
+            const auto ai = Vec::fromRawArray (aImag + i);
+            const auto br = Vec::fromRawArray (bReal + i);
+            const auto bi = Vec::fromRawArray (bImag + i);
+
+            auto nextReal = ar * br - ai * bi;
+            auto nextImag = ar * bi + ai * br;
+
+            if (renormalize)
+            {
+                const auto gain = Vec::expand (1.5f) - (nextReal * nextReal + nextImag * nextImag) * 0.5f;
+                nextReal *= gain;
+                nextImag *= gain;
+            }
+
+            nextReal.copyToRawArray (outReal + i);
+            nextImag.copyToRawArray (outImag + i);
+        }
+#else
+        for (int i = 0; i < OscillatorBank::kTileSize; ++i)
+        {
+            auto nextReal = aReal[i] * bReal[i] - aImag[i] * bImag[i];
+            auto nextImag = aReal[i] * bImag[i] + aImag[i] * bReal[i];
+
+            if (renormalize)
+            {
+                const float gain = 1.5f - 0.5f * (nextReal * nextReal + nextImag * nextImag);
+                nextReal *= gain;
+                nextImag *= gain;
+            }
+
+            outReal[i] = nextReal;
+            outImag[i] = nextImag;
+        }
+#endif
+    }
+} // namespace
+
+void OscillatorBank::process (const float* phases,
+                              const float* harmonicAmplitudes,
+                              int amplitudeStride,
+                              const int* activeHarmonics,
+                              int numActiveHarmonics,
+                              float* output,
+                              int numSamples)
+{
+    // Find how many powers of the fundamental are needed to cover the largest gap in the list.
+    int largestStep = 1;
+    for (int i = 0, previousOrder = 1; i < numActiveHarmonics; ++i)
+    {
+        largestStep = std::max (largestStep, activeHarmonics[i] + 1 - previousOrder);
+        previousOrder = activeHarmonics[i] + 1;
+    }
+    int numPowers = 1;
+    while (numPowers < kNumRotorPowers && (1 << numPowers) <= largestStep)
+    {
+        ++numPowers;
+    }
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += kTileSize)
+    {
+        const int tileSize = std::min (kTileSize, numSamples - tileStart);
+
+        float* tileOutput = output + tileStart;
+        juce::FloatVectorOperations::clear (tileOutput, tileSize);
+
+        if (numActiveHarmonics == 0)
+        {
+            continue;
+        }
+
+        // Lanes past the end of the signal hold a unit rotor so the tile can always be processed whole.
+        for (int i = 0; i < kTileSize; ++i)
+        {
+            const float phase = i < tileSize ? phases[tileStart + i] : 0.f;
+            powerReal[0][i] = std::cos (phase);
+            powerImag[0][i] = std::sin (phase);
+        }
+        computeRotorPowers (numPowers);
+
+        std::copy (powerReal[0], powerReal[0] + kTileSize, harmonicReal);
+        std::copy (powerImag[0], powerImag[0] + kTileSize, harmonicImag);
+
+        // Every active harmonic is accumulated straight into the output while the tile is still in cache.
+        int harmonicOrder = 1, rotationsSinceRenormalization = 0;
+        for (int i = 0; i < numActiveHarmonics; ++i)
+        {
+            // Step the rotor up to the next active harmonic using the binary expansion of the gap.
+            for (int remaining = activeHarmonics[i] + 1 - harmonicOrder; remaining > 0;)
+            {
+                int powerIndex = 0;
+                while (powerIndex + 1 < numPowers && (2 << powerIndex) <= remaining)
+                {
+                    ++powerIndex;
+                }
+                const bool renormalize = ++rotationsSinceRenormalization == kRenormalizationInterval;
+                if (renormalize)
+                {
+                    rotationsSinceRenormalization = 0;
+                }
+                rotateHarmonicRotors (powerIndex, renormalize);
+                remaining -= 1 << powerIndex;
+            }
+            harmonicOrder = activeHarmonics[i] + 1;
+
+            const float* amplitudes = harmonicAmplitudes + activeHarmonics[i] * amplitudeStride + tileStart;
+            juce::FloatVectorOperations::addWithMultiply (tileOutput, harmonicImag, amplitudes, tileSize);
+        }
+    }
+}
+
+void OscillatorBank::computeRotorPowers (int numPowers)
+{
+    for (int m = 1; m < numPowers; ++m)
+    {
+        multiplyRotors (powerReal[m - 1],
+                        powerImag[m - 1],
+                        powerReal[m - 1],
+                        powerImag[m - 1],
+                        powerReal[m],
+                        powerImag[m],
+                        /*renormalize=*/true);
+    }
+}
+
+void OscillatorBank::rotateHarmonicRotors (int powerIndex, bool renormalize)
+{
+    multiplyRotors (harmonicReal,
+                    harmonicImag,
+                    powerReal[powerIndex],
+                    powerImag[powerIndex],
+                    harmonicReal,
+                    harmonicImag,
+                    renormalize);
+}
+
+} // namespace ddsp
@@ -0,0 +1,64 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// Bank of harmonic oscillators that share the phase trajectory of a fundamental.
+class OscillatorBank
+{
+public:
+    // Number of samples processed per tile. A multiple of every SIMD register width JUCE supports.
+    // A tile of 60 harmonic amplitude rows takes 15 KiB, which stays resident in a 32 KiB L1 cache
+    // together with the rotors and the output.
+    static constexpr int kTileSize = 64;
+    // The rotors are pulled back onto the unit circle after this many rotations.
+    static constexpr int kRenormalizationInterval = 16;
+    // Alignment of the tile buffers and of the rows callers are encouraged to pass in.
+    static constexpr int kAlignment_bytes = 64;
+    // Powers z^1, z^2, z^4, ... of the fundamental rotor kept for skipping over inactive harmonics.
+    static constexpr int kNumRotorPowers = 6;
+
+    // Writes the sum of sin (k * phases[n]) * harmonicAmplitudes[(k - 1) * amplitudeStride + n]
+    // over the harmonics k - 1 listed in `activeHarmonics` into output[n] for n in [0, numSamples).
+    // `activeHarmonics` holds zero-based harmonic indices in strictly increasing order; the
+    // amplitude rows of harmonics that are not listed are never read.
+    void process (const float* phases,
+                  const float* harmonicAmplitudes,
+                  int amplitudeStride,
+                  const int* activeHarmonics,
+                  int numActiveHarmonics,
+                  float* output,
+                  int numSamples);
+
+private:
+    void computeRotorPowers (int numPowers);
+    void rotateHarmonicRotors (int powerIndex, bool renormalize);
+
+    // Rotors of the fundamental raised to the powers 2^m, e^(i * 2^m * phase), for each sample of the
+    // current tile. Index 0 holds the fundamental itself.
+    alignas (kAlignment_bytes) float powerReal[kNumRotorPowers][kTileSize];
+    alignas (kAlignment_bytes) float powerImag[kNumRotorPowers][kTileSize];
+    // Rotor of the current harmonic, e^(i * k * phase), for each sample of the current tile.
+    alignas (kAlignment_bytes) float harmonicReal[kTileSize];
+    alignas (kAlignment_bytes) float harmonicImag[kTileSize];
+};
+
+} // namespace ddsp
@@ -0,0 +1,77 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+A float phase that is integrated for a whole hop before it is wrapped grows to
+hundreds of radians, where a float only resolves steps of ~1e-5, and the error
+is multiplied by the harmonic order when the harmonics are derived from it.
+Converting the frequency to radians in float also leaves a relative error of
+~1e-7 in every increment, which adds up to a steady drift on sustained notes.
+
+Here the increments are computed and summed in double, and the running phase
+is brought back into [0, 2pi) after every sample with a single compare and
+subtract (or add, for negative frequencies). One is enough as long as every
+frequency stays below the sample rate in magnitude, so that no increment
+reaches 2pi. Only the wrapped phase is rounded to float, so the phase handed
+to the oscillators is accurate to an ulp of 2pi however long the note has
+been held.
+*/
+
+#include "audio/PhaseAccumulator.h"
+
+namespace ddsp
+{
+
+using namespace juce;
+
+PhaseAccumulator::PhaseAccumulator (double sampleRate) : radiansPerHz (MathConstants<double>::twoPi / sampleRate) {}
+
+void PhaseAccumulator::process (const float* frequencies_Hz, float* phases, int numSamples)
+{
+    constexpr double twoPi = MathConstants<double>::twoPi;
+
+    double phase = state.phase;
+    for (int i = 0; i < numSamples; i++)
+    {
+        phase += frequencies_Hz[i] * radiansPerHz;
+        if (phase >= twoPi)
+        {
+            phase -= twoPi;
+        }
+        else if (phase < 0.0)
+        {
+            phase += twoPi;
+        }
+        phases[i] = static_cast<float> (phase);
+    }
+    state.phase = phase;
+}
+
+PhaseAccumulator::State PhaseAccumulator::snapshot() const { return state; }
+
+void PhaseAccumulator::restore (const State& s)
+{
+    state = s;
+    state.phase = std::fmod (state.phase, MathConstants<double>::twoPi);
+    if (state.phase < 0.0)
+    {
+        state.phase += MathConstants<double>::twoPi;
+    }
+}
+
+void PhaseAccumulator::reset() { state = {}; }
+
+} // namespace ddsp
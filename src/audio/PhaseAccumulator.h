@@ -0,0 +1,54 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// Integrates an instantaneous frequency into the phase of a fundamental, keeping the running phase
+// in double precision and wrapped to [0, 2pi) so that it neither loses precision nor drifts on
+// long notes.
+class PhaseAccumulator
+{
+public:
+    // Everything needed to continue the phase trajectory from where it was taken.
+    struct State
+    {
+        double phase = 0.0;
+    };
+
+    explicit PhaseAccumulator (double sampleRate);
+
+    // Writes the phase after each of the `numSamples` frequencies (in Hz) into `phases`, wrapped to
+    // [0, 2pi). Sample n gets the phase accumulated through frequencies[n]. The frequencies have to
+    // stay below the sample rate in magnitude.
+    void process (const float* frequencies_Hz, float* phases, int numSamples);
+
+    State snapshot() const;
+    void restore (const State& state);
+
+    // Restarts at phase 0.
+    void reset();
+
+private:
+    const double radiansPerHz;
+    State state;
+};
+
+} // namespace ddsp
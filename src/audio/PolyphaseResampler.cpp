@@ -0,0 +1,232 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*
+Output sample n sits at n * down on the upsampled time axis, where input
+sample i sits at i * up. Of the prototype taps only those that fall on an
+input sample contribute, and which ones they are depends only on the phase
+(n * down) mod up: that phase picks the branch, floor (n * down / up) the
+newest input sample under it. Moving to the next output adds `down` to the
+phase and carries whatever overflows `up` into the input position, so the
+walk through the stream stays exact in integers however long it runs.
+
+The branches are padded at the front with zeros to whole 64-byte lines and
+start on line boundaries, and the dot products keep their partial sums in
+independent lanes, so the inner loop maps onto whatever SIMD width the
+compiler targets. The input under a branch starts wherever the stream has
+got to, so those loads stay unaligned.
+
+Designing a table means a sinc and a Kaiser window per prototype tap, 14240
+of them for 44.1 kHz at the standard quality. Tables are therefore cached by
+ratio and quality and shared between resamplers. The cache only holds weak
+references, so a table lives as long as some resampler uses it.
+*/
+
+#include "audio/PolyphaseResampler.h"
+
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+namespace ddsp
+{
+
+namespace
+{
+    struct QualityPreset
+    {
+        // Zero crossings of the sinc on each side of its centre, at the lower of the two rates.
+        int numZeroCrossings;
+        // Cutoff as a fraction of the lower Nyquist frequency. The transition band is centred on it,
+        // so only its upper half aliases, into the top of the band.
+        double cutoff;
+        float kaiserBeta;
+    };
+
+    QualityPreset getPreset (ResamplerQuality quality)
+    {
+        switch (quality)
+        {
+            case ResamplerQuality::kDraft:
+                return { 8, 0.8, 6.0f };
+            case ResamplerQuality::kHigh:
+                return { 32, 0.95, 10.0f };
+            case ResamplerQuality::kStandard:
+            default:
+                return { 16, 0.9, 8.0f };
+        }
+    }
+
+    constexpr int kNumLanes = PolyphaseFilterTable::kFloatsPerAlignment;
+
+    // `size` is a whole number of lanes.
+    float dotProduct (const float* taps, const float* samples, int size)
+    {
+        float lanes[kNumLanes] = {};
+        for (int j = 0; j < size; j += kNumLanes)
+        {
+            for (int k = 0; k < kNumLanes; ++k)
+                lanes[k] += taps[j + k] * samples[j + k];
+        }
+        return std::accumulate (std::begin (lanes), std::end (lanes), 0.0f);
+    }
+} // namespace
+
+std::shared_ptr<const PolyphaseFilterTable> PolyphaseFilterTable::get (int up, int down, ResamplerQuality quality)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, ResamplerQuality>, std::weak_ptr<const PolyphaseFilterTable>> cache;
+
+    const std::lock_guard<std::mutex> lock (mutex);
+    auto& entry = cache[{ up, down, quality }];
+    auto table = entry.lock();
+    if (table == nullptr)
+    {
+        table = std::make_shared<const PolyphaseFilterTable> (up, down, quality);
+        entry = table;
+    }
+    return table;
+}
+
+PolyphaseFilterTable::PolyphaseFilterTable (int u, int d, ResamplerQuality quality) : up (u), down (d)
+{
+    jassert (up > 0 && down > 0);
+    const auto preset = getPreset (quality);
+
+    // The prototype runs at the upsampled rate, where the lower Nyquist frequency is 0.5 / max (up, down)
+    // and the zero crossings of its sinc are max (up, down) samples apart.
+    const int stride = std::max (up, down);
+    const int numTapsPerPhase = (2 * preset.numZeroCrossings * stride + up - 1) / up;
+    const int numTaps = numTapsPerPhase * up;
+    const double cutoff = preset.cutoff * 0.5 / stride;
+    const double centre = (numTaps - 1) / 2.0;
+    latency = centre / up;
+
+    std::vector<float> window (static_cast<size_t> (numTaps));
+    juce::dsp::WindowingFunction<float>::fillWindowingTables (
+        window.data(), window.size(), juce::dsp::WindowingFunction<float>::kaiser, false, preset.kaiserBeta);
+
+    std::vector<double> prototype (static_cast<size_t> (numTaps));
+    for (int j = 0; j < numTaps; ++j)
+    {
+        const double x = 2.0 * cutoff * (j - centre);
+        const double px = juce::MathConstants<double>::pi * x;
+        const double sinc = x == 0.0 ? 1.0 : std::sin (px) / px;
+        prototype[j] = sinc * window[j];
+    }
+
+    // Every branch sums to about 1 / up of the prototype, so a gain of `up` keeps DC at unity.
+    const double gain = up / std::accumulate (prototype.begin(), prototype.end(), 0.0);
+
+    branchSize = (numTapsPerPhase + kFloatsPerAlignment - 1) / kFloatsPerAlignment * kFloatsPerAlignment;
+    const int padding = branchSize - numTapsPerPhase;
+    storage.assign (static_cast<size_t> (up * branchSize + kFloatsPerAlignment), 0.0f);
+    coefficients = juce::snapPointerToAlignment (storage.data(), static_cast<size_t> (kAlignment_bytes));
+    for (int phase = 0; phase < up; ++phase)
+    {
+        float* branch = coefficients + phase * branchSize + padding;
+        for (int j = 0; j < numTapsPerPhase; ++j)
+            branch[j] = static_cast<float> (gain * prototype[phase + (numTapsPerPhase - 1 - j) * up]);
+    }
+}
+
+int PolyphaseFilterTable::getUpFactor() const { return up; }
+
+int PolyphaseFilterTable::getDownFactor() const { return down; }
+
+int PolyphaseFilterTable::getBranchSize() const { return branchSize; }
+
+const float* PolyphaseFilterTable::getBranch (int phase) const { return coefficients + phase * branchSize; }
+
+double PolyphaseFilterTable::getLatencyInInputSamples() const { return latency; }
+
+PolyphaseResampler::PolyphaseResampler (double inputRate, double outputRate, ResamplerQuality quality)
+{
+    jassert (inputRate > 0.0 && outputRate > 0.0);
+
+    const int inputRate_Hz = juce::roundToInt (inputRate);
+    const int outputRate_Hz = juce::roundToInt (outputRate);
+    const int divisor = std::gcd (inputRate_Hz, outputRate_Hz);
+    up = outputRate_Hz / divisor;
+    down = inputRate_Hz / divisor;
+    if (up > kMaxUpFactor)
+    {
+        up = kMaxUpFactor;
+        down = juce::roundToInt (inputRate * up / outputRate);
+    }
+
+    table = PolyphaseFilterTable::get (up, down, quality);
+    branchSize = table->getBranchSize();
+
+    history.resize (static_cast<size_t> (branchSize - 1 + kChunkSize));
+    reset();
+}
+
+void PolyphaseResampler::reset()
+{
+    std::fill (history.begin(), history.end(), 0.0f);
+    nextInput = 0;
+    nextPhase = 0;
+}
+
+int PolyphaseResampler::getUpFactor() const { return up; }
+
+int PolyphaseResampler::getDownFactor() const { return down; }
+
+int PolyphaseResampler::getNumTapsPerPhase() const { return branchSize; }
+
+double PolyphaseResampler::getLatencyInInputSamples() const { return table->getLatencyInInputSamples(); }
+
+int PolyphaseResampler::getMaxNumOutputSamples (int numInputSamples) const
+{
+    return static_cast<int> ((static_cast<juce::int64> (numInputSamples) * up + down - 1) / down);
+}
+
+const PolyphaseFilterTable& PolyphaseResampler::getFilterTable() const { return *table; }
+
+int PolyphaseResampler::process (const float* input, int numInputSamples, float* output)
+{
+    int numOutputSamples = 0;
+    for (int start = 0; start < numInputSamples; start += kChunkSize)
+    {
+        numOutputSamples +=
+            processChunk (input + start, std::min (kChunkSize, numInputSamples - start), output + numOutputSamples);
+    }
+    return numOutputSamples;
+}
+
+int PolyphaseResampler::processChunk (const float* input, int numInputSamples, float* output)
+{
+    const int historySize = branchSize - 1;
+    std::copy (input, input + numInputSamples, history.begin() + historySize);
+
+    int numOutputSamples = 0;
+    while (nextInput < numInputSamples)
+    {
+        output[numOutputSamples++] = dotProduct (table->getBranch (nextPhase), history.data() + nextInput, branchSize);
+
+        nextPhase += down;
+        nextInput += nextPhase / up;
+        nextPhase %= up;
+    }
+
+    // Keep the tail of the chunk as the history of the next one.
+    std::copy (history.begin() + numInputSamples, history.begin() + numInputSamples + historySize, history.begin());
+    nextInput -= numInputSamples;
+    return numOutputSamples;
+}
+
+} // namespace ddsp
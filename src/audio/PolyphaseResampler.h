@@ -0,0 +1,124 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// Length and shape of the resampling lowpass.
+enum class ResamplerQuality
+{
+    // 8 zero crossings, flat to about 4 kHz of an 8 kHz band, about 60 dB of alias rejection.
+    kDraft,
+    // 16 zero crossings, flat to about 6 kHz, about 80 dB.
+    kStandard,
+    // 32 zero crossings, flat to about 6.5 kHz, about 100 dB.
+    kHigh,
+};
+
+// Coefficients of the polyphase lowpass for one ratio `up / down` and quality. Tables are immutable
+// once designed and shared by every resampler that converts between the same rates.
+class PolyphaseFilterTable
+{
+public:
+    // Alignment of each branch, and the multiple its length is rounded up to.
+    static constexpr int kAlignment_bytes = 64;
+    static constexpr int kFloatsPerAlignment = kAlignment_bytes / sizeof (float);
+
+    // Returns the table for `up / down` at `quality`, designing it unless one is still in use.
+    static std::shared_ptr<const PolyphaseFilterTable> get (int up, int down, ResamplerQuality quality);
+
+    PolyphaseFilterTable (int up, int down, ResamplerQuality quality);
+
+    int getUpFactor() const;
+    int getDownFactor() const;
+    // Taps in each branch, including the zeros that pad it to whole alignment lines.
+    int getBranchSize() const;
+    // Branch p holds the taps p, p + up, p + 2 up, ... of the prototype lowpass in reverse, after the
+    // padding, so its dot product runs forwards over the input. Aligned to kAlignment_bytes.
+    const float* getBranch (int phase) const;
+    // Group delay of the filter in input samples.
+    double getLatencyInInputSamples() const;
+
+private:
+    int up = 1;
+    int down = 1;
+    int branchSize = 0;
+    double latency = 0.0;
+
+    // One spare line so that the start of the coefficients can be aligned.
+    std::vector<float> storage;
+    float* coefficients = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (PolyphaseFilterTable)
+};
+
+// Streaming sample rate converter for a rational ratio `up / down`. The input is conceptually
+// upsampled by `up`, lowpassed below the lower of the two Nyquist frequencies and decimated by `down`,
+// but only the taps that land on input samples are ever evaluated: the windowed-sinc lowpass is split
+// into `up` polyphase branches and each output sample is one dot product with a branch.
+// The last taps of input are kept between calls, so the stream may be fed in chunks of any size and
+// every input sample goes through the filter exactly once.
+class PolyphaseResampler
+{
+public:
+    // Rates that do not reduce to an upsampling factor this small are approximated by one that does.
+    static constexpr int kMaxUpFactor = 1024;
+
+    PolyphaseResampler (double inputRate, double outputRate, ResamplerQuality quality = ResamplerQuality::kStandard);
+
+    // Clears the input history, as if the stream had been silent so far.
+    void reset();
+
+    int getUpFactor() const;
+    int getDownFactor() const;
+    int getNumTapsPerPhase() const;
+    // Group delay of the filter in input samples.
+    double getLatencyInInputSamples() const;
+    // Most output samples a call to process() with `numInputSamples` can produce.
+    int getMaxNumOutputSamples (int numInputSamples) const;
+    const PolyphaseFilterTable& getFilterTable() const;
+
+    // Appends `numInputSamples` to the stream and writes the output samples they complete into
+    // `output`, which must have room for getMaxNumOutputSamples (numInputSamples). Returns the number
+    // of output samples written.
+    int process (const float* input, int numInputSamples, float* output);
+
+private:
+    // Input samples appended to the history at a time.
+    static constexpr int kChunkSize = 1024;
+
+    int processChunk (const float* input, int numInputSamples, float* output);
+
+    std::shared_ptr<const PolyphaseFilterTable> table;
+    int up = 1;
+    int down = 1;
+    int branchSize = 0;
+
+    // The last branchSize - 1 input samples followed by the chunk being filtered.
+    std::vector<float> history;
+    // Position of the newest input sample of the next output, relative to the start of the chunk.
+    int nextInput = 0;
+    // Branch of the next output.
+    int nextPhase = 0;
+};
+
+} // namespace ddsp
@@ -25,6 +25,8 @@ FeatureExtractionModel::FeatureExtractionModel()
                  kNumFeatureExtractionThreads)
 {
     describe();
+    frameSize = inputItemSizes[0];
+    prepareBatches (kMaxBatchSize);
 }
 
 void FeatureExtractionModel::call (const juce::AudioBuffer<float>& audioInput, AudioFeatures& output)
@@ -35,25 +37,66 @@ void FeatureExtractionModel::call (const juce::AudioBuffer<float>& audioInput, A
         interpreter->typed_input_tensor<float> (0)[i] = audioInput.getSample (0, i);
     }
 
+    run (*interpreter, &output, 1);
+}
+
+void FeatureExtractionModel::call (const Frame& frame, AudioFeatures& output)
+{
+    fillFrame (*interpreter, 0, frame);
+    run (*interpreter, &output, 1);
+}
+
+void FeatureExtractionModel::callBatch (const Frame* frames, int numFrames, AudioFeatures* outputs)
+{
+    const int maxBatchSize = getMaxBatchSize();
+    for (int start = 0; start < numFrames;)
+    {
+        const int numInBatch = std::min (maxBatchSize, numFrames - start);
+        auto& batch = interpreterFor (numInBatch);
+
+        for (int i = 0; i < numInBatch; ++i)
+        {
+            fillFrame (batch, i, frames[start + i]);
+        }
+        run (batch, outputs + start, numInBatch);
+        start += numInBatch;
+    }
+}
+
+void FeatureExtractionModel::fillFrame (tflite::Interpreter& batch, int index, const Frame& frame)
+{
+    float* input = batch.typed_input_tensor<float> (0) + index * frameSize;
+    const int numSamples = static_cast<int> (frame.first.size() + frame.second.size());
+    jassert (numSamples <= frameSize);
+
+    // Fill tensor with the frame, padded with silence.
+    const int offset = (frameSize - numSamples) / 2;
+    std::fill (input, input + offset, 0.0f);
+    input = std::copy (frame.first.begin(), frame.first.end(), input + offset);
+    input = std::copy (frame.second.begin(), frame.second.end(), input);
+    std::fill (input, input + frameSize - offset - numSamples, 0.0f);
+}
+
+void FeatureExtractionModel::run (tflite::Interpreter& batch, AudioFeatures* outputs, int numFrames)
+{
     // Call model.
-    if (auto status = interpreter->Invoke(); status != kTfLiteOk)
+    if (auto status = invoke (numFrames); status != kTfLiteOk)
     {
         std::cerr << "Failed to compute, status code: " << status << std::endl;
     }
 
-    std::vector<int> tensorIndices (interpreter->outputs().size());
-
     // pw_db, f0_hz, pw_scaled, f0_scaled
-    for (size_t i = 0; i < interpreter->outputs().size(); ++i)
+    const auto& tensorIndices = batch.outputs();
+
+    for (int frame = 0; frame < numFrames; ++frame)
     {
-        tensorIndices[i] = interpreter->outputs()[i];
+        auto& output = outputs[frame];
+        output.loudness_db = batch.typed_tensor<float> (tensorIndices[3])[frame];
+        output.f0_hz = batch.typed_tensor<float> (tensorIndices[2])[frame];
+        // TODO: change loudness to power.
+        output.loudness_norm = batch.typed_tensor<float> (tensorIndices[1])[frame];
+        output.f0_norm = batch.typed_tensor<float> (tensorIndices[0])[frame];
     }
-
-    output.loudness_db = *interpreter->typed_tensor<float> (tensorIndices[3]);
-    output.f0_hz = *interpreter->typed_tensor<float> (tensorIndices[2]);
-    // TODO: change loudness to power.
-    output.loudness_norm = *interpreter->typed_tensor<float> (tensorIndices[1]);
-    output.f0_norm = *interpreter->typed_tensor<float> (tensorIndices[0]);
 }
 
 } // namespace ddsp
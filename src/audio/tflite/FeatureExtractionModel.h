@@ -16,6 +16,8 @@ limitations under the License.
 
 #pragma once
 
+#include <span>
+
 #include "JuceHeader.h"
 
 #include "audio/tflite/ModelBase.h"
@@ -27,8 +29,33 @@ namespace ddsp
 class FeatureExtractionModel : public ModelBase<juce::AudioBuffer<float>, AudioFeatures>
 {
 public:
+    // A frame given in two blocks, such as a view of a ring buffer that wraps.
+    struct Frame
+    {
+        std::span<const float> first;
+        std::span<const float> second;
+    };
+
+    // Most frames run through the model in one invocation. The model holds an interpreter for every
+    // power of two up to this many.
+    static constexpr int kMaxBatchSize = 32;
+
     FeatureExtractionModel();
     void call (const juce::AudioBuffer<float>& input, AudioFeatures& output) override;
+    // Runs the model on a frame centred in the input tensor, with silence on either side.
+    void call (const Frame& frame, AudioFeatures& output);
+    // Runs the model on `numFrames` frames, up to kMaxBatchSize of them per invocation if the model
+    // takes a batch dimension and one at a time if it does not. The model keeps no state between
+    // frames, so the results are those of calling it on each frame in turn.
+    void callBatch (const Frame* frames, int numFrames, AudioFeatures* outputs);
+
+private:
+    void fillFrame (tflite::Interpreter& batch, int index, const Frame& frame);
+    // Invokes the batch that holds `numFrames` frames on the ones filled in and reads their features.
+    void run (tflite::Interpreter& batch, AudioFeatures* outputs, int numFrames);
+
+    // Samples in one frame of the input tensor.
+    int frameSize = 0;
 };
 
 } // namespace ddsp
@@ -15,34 +15,73 @@ limitations under the License.
 */
 
 #include "audio/tflite/InferencePipeline.h"
+
+#include <thread>
+
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/InverseFFTSynthesizer.h"
 #include "util/InputUtils.h"
 
 namespace ddsp
 {
 
-InferencePipeline::InferencePipeline (juce::AudioProcessorValueTreeState& t)
+namespace
+{
+    std::atomic<juce::uint64> numPipelinesCreated = { 0 };
+
+    std::unique_ptr<HarmonicSynthesizerBase>
+        createHarmonicSynthesizer (HarmonicSynthesisEngine engine, int numOutputSamples, float sampleRate)
+    {
+        switch (engine)
+        {
+            case HarmonicSynthesisEngine::kInverseFFT:
+                return std::make_unique<InverseFFTSynthesizer> (kHarmonicsSize, numOutputSamples, sampleRate);
+            case HarmonicSynthesisEngine::kWavetable:
+            {
+                auto synthesizer =
+                    std::make_unique<HostRateHarmonicSynthesizer> (kHarmonicsSize, numOutputSamples, sampleRate);
+                synthesizer->setSynthesisMode (HarmonicSynthesisMode::kWavetable);
+                return synthesizer;
+            }
+            case HarmonicSynthesisEngine::kOscillatorBank:
+            default:
+                return std::make_unique<HostRateHarmonicSynthesizer> (kHarmonicsSize, numOutputSamples, sampleRate);
+        }
+    }
+} // namespace
+
+InferencePipeline::InferencePipeline (juce::AudioProcessorValueTreeState& t, HarmonicSynthesisEngine engine)
     : tree (t),
-      inputRingBuffer (/*size=*/61440),
-      outputRingBuffer (/*size=*/61440),
-      noiseSynthesizer (kNoiseAmpsSize, kModelHopSize),
-      harmonicSynthesizer (kHarmonicsSize, kModelHopSize, kModelSampleRate_Hz)
+      inputRingBuffer (/*numChannels=*/1, /*capacity=*/61440),
+      modelInputRingBuffer (/*numChannels=*/1, /*capacity=*/kModelFrameSize),
+      outputRingBuffer (/*numChannels=*/1, /*capacity=*/61440),
+      harmonicSynthesisEngine (engine),
+      noiseSeed (HostRateNoiseSynthesizer::kDefaultSeed + numPipelinesCreated++),
+      batchedFrames (kMaxOfflineBatchedHops),
+      batchedFeatures (kMaxOfflineBatchedHops),
+      batchedControls (kMaxOfflineBatchedHops)
 {
     featureExtractionModel = std::make_unique<FeatureExtractionModel>();
 }
 
-InferencePipeline::~InferencePipeline() {}
+InferencePipeline::~InferencePipeline() { stopWorker(); }
 
 void InferencePipeline::prepareToPlay (double sr, int samplesPerBlock)
 {
+    // Hosts may prepare again without releasing first. Everything below is rebuilt or reset from this
+    // thread, so no worker may be rendering meanwhile; startWorker() takes it up again afterwards.
+    stopWorker();
+
     sampleRate = sr;
+    analysisFrameSize = analysisFrameSizeFor (latencyMode);
+    // A frame shorter than a hop only covers the newest samples of it.
+    analysisFrameOffset = std::max (0, kModelHopSize - analysisFrameSize);
 
     // Calculate the hopsize and framesize of the model at the
     // user's sample rate in order to load the holding input buffer.
 
-    // The frame size is the amount that is copied for downsampling and is
-    // independent of the amount that is removed from the buffer after processing (hopsize).
-    // Use ceil to ensure there are enough samples to correctly perform downsampling later.
-    userFrameSize = static_cast<int> (ceil (sampleRate * kModelFrameSize / kModelSampleRate_Hz));
+    // The frame size is the latency of the analysis, as the input is padded by a frame of silence.
+    userFrameSize = static_cast<int> (ceil (sampleRate * analysisFrameSize / kModelSampleRate_Hz));
 
     // If the hopsize of the model does not convert evenly to the user's sample rate, logic
     // must be written to handle this when advancing the pointer in the holding input buffer.
@@ -54,10 +93,40 @@ void InferencePipeline::prepareToPlay (double sr, int samplesPerBlock)
     DBG ("User Frame Size: " << userFrameSize);
     DBG ("User Hop Size: " << userHopSize);
 
-    modelInputBuffer.setSize (1, userFrameSize);
-    resampledModelInputBuffer.setSize (1, kModelFrameSize);
-    synthesisBuffer.setSize (1, kModelHopSize);
-    resampledModelOutputBuffer.setSize (1, userHopSize);
+    calibrateLoudness();
+
+    // The audio thread reads a block right after it has written one, before the worker has had the
+    // chance to process it, so the worker has to stay a block and some headroom ahead.
+    workerLatency = samplesPerBlock + static_cast<int> (std::ceil (sampleRate * kInferenceWorkerHeadroom_ms / 1000.0));
+    outputLevelController.prepare (
+        workerLatency, static_cast<int> (std::ceil (sampleRate * kFillLevelWindow_s)), /*tolerance=*/userHopSize);
+
+    // Each FIFO holds a block being written, a block being read, and in between at most a frame
+    // waiting for the model, a batch of hops in flight, the output primed ahead of the audio thread
+    // and whatever piles up while the worker is stalled.
+    const int maxBatchedHops = offlineRendering ? kMaxOfflineBatchedHops : kMaxBatchedHops;
+    const int latency = userFrameSize + maxBatchedHops * userHopSize + workerLatency
+                        + static_cast<int> (std::ceil (sampleRate * kMaxWorkerStall_s));
+    inputRingBuffer.setSize (1, AudioRingBuffer::capacityFor (samplesPerBlock, latency));
+    outputRingBuffer.setSize (1, AudioRingBuffer::capacityFor (samplesPerBlock, latency));
+
+    // The renderer empties the input FIFO into the model input FIFO before it reads any frames from
+    // it, so the latter has to take a full input FIFO on top of the padding.
+    inputResampler = std::make_unique<PolyphaseResampler> (sampleRate, kModelSampleRate_Hz);
+    resamplerLatency = juce::roundToInt (inputResampler->getLatencyInInputSamples());
+    modelInputRingBuffer.setSize (1,
+                                  analysisFrameOffset + analysisFrameSize
+                                      + inputResampler->getMaxNumOutputSamples (inputRingBuffer.getCapacity()));
+    resampledHop.resize (static_cast<size_t> (inputResampler->getMaxNumOutputSamples (userHopSize)));
+
+    // The synthesizers run at the host rate, so each hop of controls renders userHopSize samples.
+    noiseSynthesizer = std::make_unique<HostRateNoiseSynthesizer> (kNoiseAmpsSize, userHopSize, noiseSeed);
+    harmonicSynthesizer =
+        createHarmonicSynthesizer (harmonicSynthesisEngine, userHopSize, static_cast<float> (sampleRate));
+
+    // The harmonics wait out the group delay of the noise filter at the start of their channel.
+    harmonicDelay = noiseSynthesizer->getGroupDelay();
+    synthesisBuffer.setSize (2, harmonicDelay + kMaxOfflineBatchedHops * userHopSize);
 
     midiInputProcessor.prepareToPlay (sampleRate, userHopSize);
 
@@ -66,33 +135,42 @@ void InferencePipeline::prepareToPlay (double sr, int samplesPerBlock)
 
 void InferencePipeline::reset()
 {
-    if (currentPredictControlsModel)
+    gruState.fill (0.0f);
+    crossfadeHopsLeft = 0;
+    predictControlsModels.releasePrevious();
+
+    if (noiseSynthesizer)
     {
-        currentPredictControlsModel->reset();
+        noiseSynthesizer->reset();
     }
 
-    noiseSynthesizer.reset();
-    harmonicSynthesizer.reset();
+    if (harmonicSynthesizer)
+    {
+        harmonicSynthesizer->reset();
+    }
 
-    modelInputBuffer.clear();
     synthesisBuffer.clear();
-    resampledModelInputBuffer.clear();
-    resampledModelOutputBuffer.clear();
 
-    inputRingBuffer.clear();
+    inputRingBuffer.reset();
+    modelInputRingBuffer.reset();
     // Zero pad.
-    if (userFrameSize > 0)
-    {
-        juce::AudioBuffer<float> zeroBuf (1, userFrameSize);
-        zeroBuf.clear();
-        // Do we need to reset input/outputRingBuffer here?
-        inputRingBuffer.push (zeroBuf);
-    }
+    modelInputRingBuffer.pushSilence (analysisFrameOffset + analysisFrameSize);
+    // The padding already makes up the first hop.
+    samplesUntilNextHop = userHopSize;
+
+    analyzedHops.reset();
 
-    outputRingBuffer.clear();
+    outputRingBuffer.reset();
+    outputLatency = 0;
+    outputLevelController.reset();
 
-    inputInterpolator.reset();
-    outputInterpolator.reset();
+    offlineRenderTicks = 0;
+    numOfflineSamplesRendered = 0;
+
+    if (inputResampler)
+    {
+        inputResampler->reset();
+    }
 }
 
 void InferencePipeline::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
@@ -108,95 +186,570 @@ void InferencePipeline::processBlock (juce::AudioBuffer<float>& buffer, juce::Mi
         midiInputProcessor.setRelease (*tree.getRawParameterValue ("Release"));
     }
 
-    inputRingBuffer.push (buffer);
+    samplesUntilNextHop -= inputRingBuffer.push (buffer);
+    if (samplesUntilNextHop <= 0)
+    {
+        samplesUntilNextHop = userHopSize - (-samplesUntilNextHop) % userHopSize;
+        if (jobId >= 0)
+        {
+            // The output FIFO runs dry once the samples beyond this block have been read.
+            const int numAhead = std::max (0, outputRingBuffer.getNumReady() - buffer.getNumSamples());
+            submitHop (juce::Time::getHighResolutionTicks()
+                       + juce::Time::secondsToHighResolutionTicks (numAhead / sampleRate));
+        }
+    }
 }
 
 void InferencePipeline::getNextBlock (juce::AudioBuffer<float>& bufferToFill)
 {
-    if (outputRingBuffer.getNumReady() >= bufferToFill.getNumSamples())
-    {
-        outputRingBuffer.copy (bufferToFill);
-        outputRingBuffer.pop (bufferToFill.getNumSamples());
-    }
-    else
+    const int numSamples = bufferToFill.getNumSamples();
+    const int numReady = outputRingBuffer.getNumReady();
+    const int numToDrop = isWorkerRunning() ? outputLevelController.update (numReady, numSamples) : 0;
+    outputRingBuffer.readSkipping (bufferToFill, numToDrop, kDropCrossfadeSize);
+
+    if (numReady < numSamples)
     {
         DBG ("Not enough samples (this rarely happens)");
     }
 }
 
-void InferencePipeline::render()
+int InferencePipeline::render()
 {
-    if (swappingModel)
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    changeModel();
+
+    if (offlineRendering)
+    {
+        // 2a: Downsample whatever input arrived since the last render.
+        resampleInput();
+
+        // Everything the block completed, in batches. Waiting for whole batches would take a batch of
+        // extra latency, which the host would then have to compensate for in the bounce alone.
+        int numHops = 0;
+        while (getNumHopsReady() > 0)
+        {
+            const int numBatched = analyzeHops (kMaxOfflineBatchedHops, true, batchedFeatures.data());
+            renderHops (numBatched);
+            numHops += numBatched;
+        }
+        offlineRenderTicks += juce::Time::getHighResolutionTicks() - start;
+        numOfflineSamplesRendered += static_cast<juce::int64> (numHops) * userHopSize;
+        return numHops;
+    }
+
+    int numHopsRendered = 0;
+    for (int numHops = takeNextHops(); numHops > 0; numHops = takeNextHops())
     {
-        currentPredictControlsModel = std::move (nextPredictControlsModel);
-        swappingModel = false;
+        renderHops (numHops);
+        numHopsRendered += numHops;
     }
+    return numHopsRendered;
+}
 
-    while (inputRingBuffer.getNumReady() >= userFrameSize)
+void InferencePipeline::changeModel()
+{
+    if (predictControlsModels.acquire())
     {
-        if (JucePlugin_IsSynth)
+        const auto* previous = predictControlsModels.getPrevious();
+        if (previous != nullptr && previous->shared == predictControlsModels.getCurrent()->shared)
         {
-            predictControlsInput = midiInputProcessor.getCurrentPredictControlsInput();
+            // Loaded again, as prepareToPlay() does; it plays on undisturbed.
+            crossfadeHopsLeft = 0;
+            predictControlsModels.releasePrevious();
         }
         else
         {
-            // 2a: Downsample user frame's worth of input buffer.
-            jassert (modelInputBuffer.getNumSamples() == userFrameSize);
-            inputRingBuffer.copy (modelInputBuffer);
-            inputInterpolator.process (sampleRate / kModelSampleRate_Hz,
-                                       modelInputBuffer.getReadPointer (0),
-                                       resampledModelInputBuffer.getWritePointer (0),
-                                       resampledModelInputBuffer.getNumSamples());
-            jassert (resampledModelInputBuffer.getNumSamples() == kModelFrameSize);
-
-            // 2b: Run through the model.
-            featureExtractionModel->call (resampledModelInputBuffer, predictControlsInput);
+            // The new model starts from a clear state while the old one carries on from where it was.
+            previousGruState = gruState;
+            gruState.fill (0.0f);
+            crossfadeHopsLeft = previous != nullptr ? kModelCrossfadeHops : 0;
         }
+    }
 
-        // Shift the pitch before the UI and model.
-        predictControlsInput.f0_hz =
-            offsetPitch (predictControlsInput.f0_hz, *tree.getRawParameterValue ("PitchShift"));
-        predictControlsInput.f0_norm = normalizedPitch (predictControlsInput.f0_hz);
+    // Instances playing the same model render together, sharing its invocations.
+    if (isWorkerRunning())
+    {
+        const auto* current = predictControlsModels.getCurrent();
+        scheduler->setBatchKey (jobId, current != nullptr ? current->shared.get() : nullptr);
+    }
+}
 
-        // Store and scale the normalized pitch and loudness.
-        currentPitch.store (predictControlsInput.f0_norm);
-        currentRMS.store (predictControlsInput.loudness_norm);
-        predictControlsInput.f0_norm -= *tree.getRawParameterValue ("InputPitch");
-        predictControlsInput.loudness_norm -= *tree.getRawParameterValue ("InputGain");
+int InferencePipeline::getNumHopsReady() const
+{
+    const int numBeyondFirstFrame = modelInputRingBuffer.getNumReady() - analysisFrameOffset - analysisFrameSize;
+    return numBeyondFirstFrame < 0 ? 0 : 1 + numBeyondFirstFrame / kModelHopSize;
+}
 
-        currentPredictControlsModel->call (predictControlsInput, synthesisInput);
+int InferencePipeline::analyzeHops (int maxHops, bool batched, AudioFeatures* features)
+{
+    const int numHops = std::min (maxHops, getNumHopsReady());
+    if (numHops > 0)
+    {
+        extractFeatures (numHops, batched, features);
+        // 2e: Dequeue the hops from the input buffer; the frames are not needed any more.
+        modelInputRingBuffer.finishedRead (numHops * kModelHopSize);
+    }
+    return numHops;
+}
 
-        synthesisInput.amplitude *= *tree.getRawParameterValue ("HarmonicGain");
-        juce::FloatVectorOperations::multiply (
-            synthesisInput.noiseAmps.data(), *tree.getRawParameterValue ("NoiseGain"), synthesisInput.noiseAmps.size());
+int InferencePipeline::takeNextHops()
+{
+    // Hops the analysis stage handed over come first, also right after it has been stopped.
+    if (const auto* analyzed = analyzedHops.prepareToRead())
+    {
+        const int numHops = analyzed->numHops;
+        std::copy_n (analyzed->features.begin(), numHops, batchedFeatures.begin());
+        analyzedHops.finishedRead();
+        // The next hops are analyzed while these are synthesized.
+        if (isStaged())
+        {
+            scheduler->submit (analysisJobId, hopDeadline.load());
+        }
+        return numHops;
+    }
 
-        const auto& harmonicOutput =
-            harmonicSynthesizer.render (synthesisInput.harmonics, synthesisInput.amplitude, synthesisInput.f0_hz);
+    if (isStaged())
+    {
+        return 0;
+    }
 
-        const auto& noiseOutput = noiseSynthesizer.render (synthesisInput.noiseAmps);
+    // 2a: Downsample whatever input arrived since the last render.
+    resampleInput();
+    return analyzeHops (kMaxBatchedHops, false, batchedFeatures.data());
+}
 
-        for (int i = 0; i < synthesisBuffer.getNumSamples(); ++i)
+void InferencePipeline::renderHops (int numHops)
+{
+    // Predict every hop, then synthesize them in one go. The models are stateful, so prediction itself
+    // stays one hop at a time.
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        predictControls (batchedFeatures[hop], batchedControls[hop]);
+    }
+    synthesizeBatchedHops (numHops);
+}
+
+void InferencePipeline::resampleInput()
+{
+    // Each input sample is filtered once, in hops, straight into the model input FIFO unless the room
+    // there wraps around its end.
+    const auto input = inputRingBuffer.prepareToRead (inputRingBuffer.getNumReady());
+    for (const auto block : { input.getFirstBlock (0), input.getSecondBlock (0) })
+    {
+        for (size_t start = 0; start < block.size(); start += static_cast<size_t> (userHopSize))
         {
-            synthesisBuffer.getWritePointer (0)[i] = harmonicOutput[i] + noiseOutput[i];
+            const int numInput = static_cast<int> (std::min (block.size() - start, static_cast<size_t> (userHopSize)));
+            const int maxNumOutput = inputResampler->getMaxNumOutputSamples (numInput);
+            const auto output = modelInputRingBuffer.prepareToWrite (maxNumOutput);
+            jassert (output.getNumSamples() == maxNumOutput);
+
+            float* destination = output.isContiguous() ? output.getFirstBlock (0).data() : resampledHop.data();
+            const int numOutput = inputResampler->process (block.data() + start, numInput, destination);
+            if (! output.isContiguous())
+            {
+                const auto first = output.getFirstBlock (0);
+                const auto second = output.getSecondBlock (0);
+                const int numFirst = std::min (numOutput, static_cast<int> (first.size()));
+                std::copy (resampledHop.begin(), resampledHop.begin() + numFirst, first.begin());
+                std::copy (resampledHop.begin() + numFirst, resampledHop.begin() + numOutput, second.begin());
+            }
+            modelInputRingBuffer.finishedWrite (numOutput);
         }
+    }
+    inputRingBuffer.finishedRead (input.getNumSamples());
+}
 
-        outputInterpolator.process (kModelSampleRate_Hz / sampleRate,
-                                    synthesisBuffer.getReadPointer (0),
-                                    resampledModelOutputBuffer.getWritePointer (0),
-                                    resampledModelOutputBuffer.getNumSamples());
-        // 2d: Enqueue to outputRingBuffer.
-        outputRingBuffer.push (resampledModelOutputBuffer);
-        // 2e: Dequeue hop size samples from input buffer.
-        inputRingBuffer.pop (userHopSize);
+void InferencePipeline::extractFeatures (int numHops, bool batched, AudioFeatures* features)
+{
+    if (JucePlugin_IsSynth)
+    {
+        std::fill_n (features, numHops, midiInputProcessor.getCurrentPredictControlsInput());
+        return;
+    }
+
+    // 2b: Run the analysis frames through the model, read in place from the model input FIFO. The
+    // feature extractor keeps no state, so offline it takes the frames of all the hops at once.
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        const auto frame =
+            modelInputRingBuffer.prepareToRead (analysisFrameSize, analysisFrameOffset + hop * kModelHopSize);
+        jassert (frame.getNumSamples() == analysisFrameSize);
+        batchedFrames[hop] = { frame.getFirstBlock (0), frame.getSecondBlock (0) };
+        if (! batched)
+        {
+            featureExtractionModel->call (batchedFrames[hop], features[hop]);
+        }
+    }
+
+    if (batched)
+    {
+        featureExtractionModel->callBatch (batchedFrames.data(), numHops, features);
+    }
+
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        features[hop].loudness_db += loudnessCompensation_dB;
+        features[hop].loudness_norm += loudnessCompensationNorm;
     }
 }
 
-void InferencePipeline::hiResTimerCallback() { render(); }
+void InferencePipeline::predictControls (AudioFeatures& features, SynthesisControls& controls)
+{
+    prepareControlsInput (features);
+    const PredictControlsModel::Request request { &features, &gruState, &controls };
+    predictControlsModels.getCurrent()->predict (request);
+    crossfadeFromPreviousModel (features, controls);
+    finishControls (controls);
+}
+
+void InferencePipeline::crossfadeFromPreviousModel (const AudioFeatures& features, SynthesisControls& controls)
+{
+    if (crossfadeHopsLeft == 0)
+    {
+        return;
+    }
+
+    const PredictControlsModel::Request request { &features, &previousGruState, &previousControls };
+    predictControlsModels.getPrevious()->predict (request);
+
+    // The share of the new model rises linearly, from 1 / (kModelCrossfadeHops + 1) on the first hop.
+    const float gain = static_cast<float> (kModelCrossfadeHops + 1 - crossfadeHopsLeft) / (kModelCrossfadeHops + 1);
+    controls.amplitude = gain * controls.amplitude + (1.0f - gain) * previousControls.amplitude;
+    for (auto [mixed, previous] : { std::make_pair (&controls.harmonics, &previousControls.harmonics),
+                                    std::make_pair (&controls.noiseAmps, &previousControls.noiseAmps) })
+    {
+        const int size = static_cast<int> (mixed->size());
+        juce::FloatVectorOperations::multiply (mixed->data(), gain, size);
+        juce::FloatVectorOperations::addWithMultiply (mixed->data(), previous->data(), 1.0f - gain, size);
+    }
+
+    if (--crossfadeHopsLeft == 0)
+    {
+        predictControlsModels.releasePrevious();
+    }
+}
+
+void InferencePipeline::prepareControlsInput (AudioFeatures& features)
+{
+    // Shift the pitch before the UI and model.
+    features.f0_hz = offsetPitch (features.f0_hz, *tree.getRawParameterValue ("PitchShift"));
+    features.f0_norm = normalizedPitch (features.f0_hz);
+
+    // Store and scale the normalized pitch and loudness.
+    currentPitch.store (features.f0_norm);
+    currentRMS.store (features.loudness_norm);
+    features.f0_norm -= *tree.getRawParameterValue ("InputPitch");
+    features.loudness_norm -= *tree.getRawParameterValue ("InputGain");
+}
+
+void InferencePipeline::finishControls (SynthesisControls& controls)
+{
+    controls.amplitude *= *tree.getRawParameterValue ("HarmonicGain");
+    juce::FloatVectorOperations::multiply (
+        controls.noiseAmps.data(), *tree.getRawParameterValue ("NoiseGain"), controls.noiseAmps.size());
+}
+
+void InferencePipeline::synthesizeBatchedHops (int numHops)
+{
+    jassert (numHops <= kMaxOfflineBatchedHops);
+    const int numSamples = numHops * userHopSize;
+    // The harmonics are rendered after the ones held back from the last batch and mixed from the start.
+    auto harmonicOutput = synthesisBuffer.getWritePointer (0);
+    auto noiseOutput = synthesisBuffer.getWritePointer (1);
+
+    // 2c: Synthesize, the noise on the noise stage if it runs.
+    const bool noiseForked = noiseJobId >= 0 && numHops > 0;
+    if (noiseForked)
+    {
+        numForkedNoiseHops = numHops;
+        forkedNoiseOutput = noiseOutput;
+        noiseState.store (kNoiseForked);
+        scheduler->submit (noiseJobId, hopDeadline.load());
+    }
+
+    harmonicSynthesizer->renderFrames (batchedControls.data(), numHops, harmonicOutput + harmonicDelay);
+
+    // Render the noise here unless the noise stage has taken it up meanwhile, in which case it is
+    // bound to be done soon.
+    if (int expected = kNoiseForked; ! noiseForked || noiseState.compare_exchange_strong (expected, kNoiseClaimed))
+    {
+        noiseSynthesizer->renderFrames (batchedControls.data(), numHops, noiseOutput);
+    }
+    else
+    {
+        while (noiseState.load() != kNoiseDone)
+        {
+            std::this_thread::yield();
+        }
+    }
+    noiseState.store (kNoiseIdle);
+
+    // 2d: Mix straight into outputRingBuffer.
+    const auto output = outputRingBuffer.prepareToWrite (numSamples);
+    const auto first = output.getFirstBlock (0);
+    const auto second = output.getSecondBlock (0);
+    juce::FloatVectorOperations::add (first.data(), harmonicOutput, noiseOutput, static_cast<int> (first.size()));
+    juce::FloatVectorOperations::add (second.data(),
+                                      harmonicOutput + first.size(),
+                                      noiseOutput + first.size(),
+                                      static_cast<int> (second.size()));
+    outputRingBuffer.finishedWrite (output.getNumSamples());
+    jassert (output.getNumSamples() == numSamples);
+
+    // Hold back the harmonics the noise has not caught up with yet.
+    if (numSamples > 0)
+    {
+        std::copy (harmonicOutput + numSamples, harmonicOutput + numSamples + harmonicDelay, harmonicOutput);
+    }
+}
+
+void InferencePipeline::setLatencyMode (LatencyMode mode) { latencyMode = mode; }
+
+LatencyMode InferencePipeline::getLatencyMode() const { return latencyMode; }
+
+void InferencePipeline::setOfflineRendering (bool shouldRenderOffline) { offlineRendering = shouldRenderOffline; }
+
+int InferencePipeline::analysisFrameSizeFor (LatencyMode mode)
+{
+    switch (mode)
+    {
+        case LatencyMode::kLow:
+            return kModelFrameSize / 2;
+        case LatencyMode::kLowest:
+            return kModelFrameSize / 4;
+        case LatencyMode::kStandard:
+        default:
+            return kModelFrameSize;
+    }
+}
+
+void InferencePipeline::calibrateLoudness()
+{
+    loudnessCompensation_dB = 0.0f;
+    loudnessCompensationNorm = 0.0f;
+    if (analysisFrameSize == kModelFrameSize)
+    {
+        return;
+    }
+
+    // Whatever window the model applies, a frame that is partly silent reads quieter than a full one.
+    // Compare the two on a steady tone well above the noise floor of the loudness measure.
+    constexpr float toneFrequency_Hz = 440.0f;
+    constexpr float toneGain = 0.1f;
+    juce::AudioBuffer<float> tone (1, kModelFrameSize);
+    for (int i = 0; i < kModelFrameSize; ++i)
+    {
+        tone.setSample (
+            0, i, toneGain * std::sin (juce::MathConstants<float>::twoPi * toneFrequency_Hz * i / kModelSampleRate_Hz));
+    }
+
+    AudioFeatures full, shortened;
+    featureExtractionModel->call (tone, full);
+    const int offset = (kModelFrameSize - analysisFrameSize) / 2;
+    tone.clear (0, offset);
+    tone.clear (offset + analysisFrameSize, kModelFrameSize - offset - analysisFrameSize);
+    featureExtractionModel->call (tone, shortened);
+
+    loudnessCompensation_dB = full.loudness_db - shortened.loudness_db;
+    loudnessCompensationNorm = full.loudness_norm - shortened.loudness_norm;
+    DBG ("Loudness compensation: " << loudnessCompensation_dB << " dB");
+}
+
+void InferencePipeline::startWorker()
+{
+    if (isWorkerRunning())
+    {
+        return;
+    }
+
+    jobId = scheduler->add (*this);
+    if (jobId < 0)
+    {
+        DBG ("No room for another inference job, rendering synchronously");
+        return;
+    }
+
+    // On a single worker the stages could only take turns.
+    if (scheduler->getNumWorkers() > 1)
+    {
+        analysisJobId = scheduler->add (analysisStage);
+        noiseJobId = scheduler->add (noiseStage);
+    }
+
+    outputRingBuffer.pushSilence (std::max (0, workerLatency - outputRingBuffer.getNumReady()));
+    outputLatency = workerLatency;
+    outputLevelController.reset();
+    // Catch up on whatever is ready before the first hop is submitted.
+    submitHop (juce::Time::getHighResolutionTicks());
+}
+
+void InferencePipeline::stopWorker()
+{
+    if (! isWorkerRunning())
+    {
+        return;
+    }
+
+    // The jobs read each other's ids, so those stay put until none of them can run any more.
+    for (const int id : { analysisJobId, jobId, noiseJobId })
+    {
+        if (id >= 0)
+        {
+            scheduler->remove (id);
+        }
+    }
+    analysisJobId = -1;
+    jobId = -1;
+    noiseJobId = -1;
+}
+
+bool InferencePipeline::isWorkerRunning() const { return jobId >= 0; }
+
+bool InferencePipeline::isStaged() const { return analysisJobId >= 0; }
+
+void InferencePipeline::submitHop (juce::int64 deadlineTicks)
+{
+    hopDeadline.store (deadlineTicks);
+    scheduler->submit (isStaged() ? analysisJobId : jobId, deadlineTicks);
+}
+
+int InferencePipeline::runJob() { return render(); }
+
+int InferencePipeline::runAnalysisStage()
+{
+    // 2a: Downsample whatever input arrived since the last run.
+    resampleInput();
+
+    // Once the pipeline job has taken the hops handed over last, it submits this stage again.
+    if (auto* analyzed = analyzedHops.prepareToWrite())
+    {
+        analyzed->numHops = analyzeHops (kMaxAnalyzedHops, false, analyzed->features.data());
+        if (analyzed->numHops > 0)
+        {
+            analyzedHops.finishedWrite();
+            scheduler->submit (jobId, hopDeadline.load());
+        }
+    }
+
+    // The hops count once they are rendered.
+    return 0;
+}
+
+int InferencePipeline::runNoiseStage()
+{
+    if (int expected = kNoiseForked; noiseState.compare_exchange_strong (expected, kNoiseClaimed))
+    {
+        noiseSynthesizer->renderFrames (batchedControls.data(), numForkedNoiseHops, forkedNoiseOutput);
+        noiseState.store (kNoiseDone);
+    }
+    return 0;
+}
+
+void InferencePipeline::runJobs (InferenceScheduler::Job* const* jobs, int numJobs, int* numHopsRendered)
+{
+    // Only pipelines share a batch key, the controls model they play.
+    std::array<InferencePipeline*, InferenceScheduler::kMaxBatchedJobs> pipelines;
+    int maxNumHops = 0;
+    for (int i = 0; i < numJobs; ++i)
+    {
+        auto& pipeline = *(pipelines[i] = static_cast<InferencePipeline*> (jobs[i]));
+        pipeline.changeModel();
+        numHopsRendered[i] = pipeline.takeNextHops();
+        for (int hop = 0; hop < numHopsRendered[i]; ++hop)
+        {
+            pipeline.prepareControlsInput (pipeline.batchedFeatures[hop]);
+        }
+        maxNumHops = std::max (maxNumHops, numHopsRendered[i]);
+    }
+
+    // Each GRU steps one hop at a time, but the same hop of every pipeline goes through the model at
+    // once. A pipeline that swapped its model just now gets a batch of its own.
+    std::array<PredictControlsModel::Request, InferenceScheduler::kMaxBatchedJobs> requests;
+    for (int hop = 0; hop < maxNumHops; ++hop)
+    {
+        std::array<bool, InferenceScheduler::kMaxBatchedJobs> predicted {};
+        for (int i = 0; i < numJobs; ++i)
+        {
+            if (predicted[i] || hop >= numHopsRendered[i])
+            {
+                continue;
+            }
+
+            auto* model = pipelines[i]->predictControlsModels.getCurrent()->shared.get();
+            int numRequests = 0;
+            for (int j = i; j < numJobs; ++j)
+            {
+                const bool sharesModel = pipelines[j]->predictControlsModels.getCurrent()->shared.get() == model;
+                if (! predicted[j] && hop < numHopsRendered[j] && sharesModel)
+                {
+                    requests[numRequests++] = pipelines[j]->getControlsRequest (hop);
+                    predicted[j] = true;
+                }
+            }
+            model->callBatch (requests.data(), numRequests);
+        }
+    }
+
+    for (int i = 0; i < numJobs; ++i)
+    {
+        auto& pipeline = *pipelines[i];
+        for (int hop = 0; hop < numHopsRendered[i]; ++hop)
+        {
+            pipeline.crossfadeFromPreviousModel (pipeline.batchedFeatures[hop], pipeline.batchedControls[hop]);
+            pipeline.finishControls (pipeline.batchedControls[hop]);
+        }
+        pipeline.synthesizeBatchedHops (numHopsRendered[i]);
+
+        // Whatever did not fit in the batch.
+        numHopsRendered[i] += pipeline.render();
+    }
+}
+
+PredictControlsModel::Request InferencePipeline::getControlsRequest (int hop)
+{
+    return { &batchedFeatures[hop], &gruState, &batchedControls[hop] };
+}
+
+int InferencePipeline::getLatencySamples() const
+{
+    return resamplerLatency + userFrameSize + harmonicDelay + outputLatency;
+}
+
+int InferencePipeline::getLatencySamples (LatencyMode mode) const
+{
+    // Only the analysis frame depends on the mode.
+    const int frameSize = static_cast<int> (std::ceil (sampleRate * analysisFrameSizeFor (mode) / kModelSampleRate_Hz));
+    return getLatencySamples() - userFrameSize + frameSize;
+}
+
+juce::int64 InferencePipeline::getNumUnderruns() const { return outputRingBuffer.getNumUnderflows(); }
+
+double InferencePipeline::getOfflineRealTimeFactor() const
+{
+    if (numOfflineSamplesRendered == 0)
+    {
+        return 0.0;
+    }
+
+    return juce::Time::highResolutionTicksToSeconds (offlineRenderTicks) / (numOfflineSamplesRendered / sampleRate);
+}
 
 void InferencePipeline::loadModel (const ModelInfo& mi)
 {
-    nextPredictControlsModel = std::make_unique<PredictControlsModel> (mi);
-    swappingModel = true;
+    // The renderer only swaps pointers; all the work of loading happens here.
+    auto model = std::make_shared<ControlsModel>();
+    model->shared = PredictControlsModel::getShared (mi);
+    model->own = std::make_unique<PredictControlsModel> (mi, 1);
+    predictControlsModels.publish (std::move (model));
+}
+
+void InferencePipeline::ControlsModel::predict (const PredictControlsModel::Request& request)
+{
+    if (! shared->tryCallBatch (&request, 1))
+    {
+        own->callBatch (&request, 1);
+    }
 }
 
 float InferencePipeline::getRMS() const { return currentRMS.load(); }
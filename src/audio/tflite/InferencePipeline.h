@@ -19,74 +19,288 @@ limitations under the License.
 #include "JuceHeader.h"
 
 #include "audio/AudioRingBuffer.h"
+#include "audio/FillLevelController.h"
 #include "audio/HarmonicSynthesizer.h"
 #include "audio/MidiInputProcessor.h"
 #include "audio/NoiseSynthesizer.h"
+#include "audio/PolyphaseResampler.h"
 #include "audio/tflite/FeatureExtractionModel.h"
+#include "audio/tflite/InferenceScheduler.h"
 #include "audio/tflite/ModelBase.h"
+#include "audio/tflite/ModelHandoff.h"
 #include "audio/tflite/ModelLibrary.h"
 #include "audio/tflite/PredictControlsModel.h"
+#include "util/SingleSlotQueue.h"
 
 namespace ddsp
 {
 
-class InferencePipeline : public juce::HighResolutionTimer
+// Latency of the analysis: the model always gets a full kModelFrameSize tensor, but the shorter modes
+// fill only the centre of it with the newest input and leave the rest silent. The model hop, and with
+// it the rate of the control stream, is the same in every mode.
+enum class LatencyMode
+{
+    // 1024 samples at the model rate, 64 ms.
+    kStandard,
+    // 512 samples, 32 ms.
+    kLow,
+    // 256 samples, 16 ms. Pitch tracking below roughly 125 Hz gets unreliable.
+    kLowest,
+};
+
+// Runs the models and the synthesizers either synchronously through render() or as a job of the
+// process-wide InferenceScheduler, which the audio thread submits whenever a new hop of input is ready.
+//
+// With more than one worker, rendering is split into stages that run as jobs of their own. The analysis
+// stage resamples the input and extracts the features of the ready hops, and hands them over through a
+// single-slot queue. The pipeline job predicts their controls and synthesizes them. So the features
+// of the next hops are extracted while the current ones are synthesized. While the pipeline job
+// renders the harmonics, the noise stage renders the noise on another worker.
+class InferencePipeline : private InferenceScheduler::Job
 {
 public:
-    InferencePipeline (juce::AudioProcessorValueTreeState& t);
+    InferencePipeline (juce::AudioProcessorValueTreeState& t,
+                       HarmonicSynthesisEngine engine = HarmonicSynthesisEngine::kOscillatorBank);
     ~InferencePipeline() override;
 
+    // Stops the worker, if it runs, before rebuilding the pipeline for the new rate and block size.
     void prepareToPlay (double sampleRate, int samplesPerBlock);
+    // Takes effect from the next prepareToPlay().
+    void setLatencyMode (LatencyMode mode);
+    LatencyMode getLatencyMode() const;
+    // Renders the hops each block completes as one batch of up to kMaxOfflineBatchedHops hops, for
+    // bouncing, at the same latency as synchronous playback. Takes effect from the next prepareToPlay().
+    void setOfflineRendering (bool shouldRenderOffline);
     void reset();
 
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
     void getNextBlock (juce::AudioBuffer<float>& bufferToFill);
-    void render();
-    void hiResTimerCallback() override;
+    // Renders the hops that are ready. Returns the number rendered.
+    int render();
+
+    // Registers with and unregisters from the shared inference workers. Starting primes the output
+    // FIFO with the worker latency, so it must happen while the audio thread is stopped. Starting fails,
+    // leaving the pipeline to be rendered synchronously, when the scheduler has no room for another job;
+    // without room for the stages as well, each run renders from the input to the output by itself.
+    void startWorker();
+    void stopWorker();
+    bool isWorkerRunning() const;
+    // Delay from input to output at the host rate: the group delay of the input resampler, the analysis
+    // frame and the group delay of the noise filter, plus the output the worker keeps buffered ahead of
+    // the audio thread once it has been started.
+    int getLatencySamples() const;
+    // The latency getLatencySamples() would report if prepared in `mode` for the current rate and block size.
+    int getLatencySamples (LatencyMode mode) const;
+    // Blocks that getNextBlock() could not fill completely since the last reset().
+    juce::int64 getNumUnderruns() const;
+    // Time spent rendering offline divided by the duration of the audio rendered, since the last
+    // reset(). Zero until a batch has been rendered.
+    double getOfflineRealTimeFactor() const;
 
+    // Loads the controls model on the calling thread, which must not be the audio thread, and hands
+    // it to the renderer. The model it replaces fades out over kModelCrossfadeHops hops and is freed
+    // on a background thread.
     void loadModel (const ModelInfo& mi);
 
     float getRMS() const;
     float getPitch() const;
 
 private:
+    // Most hops whose controls are predicted before they are synthesized in one batch.
+    static constexpr int kMaxBatchedHops = 8;
+    // Hops rendered together offline; their analysis frames go through the feature extractor at once.
+    static constexpr int kMaxOfflineBatchedHops = FeatureExtractionModel::kMaxBatchSize;
+    // Most hops the analysis stage hands over at a time.
+    static constexpr int kMaxAnalyzedHops = kMaxBatchedHops;
+    // Longest stall of the worker the FIFOs absorb without dropping audio.
+    static constexpr double kMaxWorkerStall_s = 0.25;
+    // Reads over which the lowest output FIFO depth is taken before any excess is dropped.
+    static constexpr double kFillLevelWindow_s = 1.0;
+    // Samples over which dropping excess output is crossfaded.
+    static constexpr int kDropCrossfadeSize = 128;
+    // Hops over which the controls of a newly loaded model are faded in, 80 ms.
+    static constexpr int kModelCrossfadeHops = 4;
+
+    // Model-rate samples of input the analysis frame holds in each mode.
+    static int analysisFrameSizeFor (LatencyMode mode);
+
+    // Runs one stage of the pipeline as a scheduler job of its own.
+    class Stage : public InferenceScheduler::Job
+    {
+    public:
+        Stage (InferencePipeline& p, int (InferencePipeline::*r)()) : pipeline (p), run (r) {}
+        int runJob() override { return (pipeline.*run)(); }
+
+    private:
+        InferencePipeline& pipeline;
+        int (InferencePipeline::*run)();
+    };
+
+    // Features of hops analyzed ahead of their synthesis.
+    struct AnalyzedHops
+    {
+        std::array<AudioFeatures, kMaxAnalyzedHops> features;
+        int numHops = 0;
+    };
+
+    // Progress of noise synthesis forked off to the noise stage.
+    enum NoiseStageState
+    {
+        kNoiseIdle,
+        kNoiseForked,
+        // Taken up, by the noise stage or by the pipeline job itself.
+        kNoiseClaimed,
+        kNoiseDone,
+    };
+
+    int runJob() override;
+    // Renders pipelines that share a controls model together, with the hops of all of them predicted in
+    // one invocation of the model.
+    void runJobs (InferenceScheduler::Job* const* jobs, int numJobs, int* numHopsRendered) override;
+    // Measures how much quieter the feature extractor hears a tone through the shortened frame.
+    void calibrateLoudness();
+
+    // The analysis stage: analyzes the ready hops into analyzedHops once it is free and submits the
+    // pipeline job to render them.
+    int runAnalysisStage();
+    // The noise stage: renders the noise of the hops being synthesized unless that has been taken up.
+    int runNoiseStage();
+    bool isStaged() const;
+    // Marks the next hop as due by `deadlineTicks` and submits the job that starts on it.
+    void submitHop (juce::int64 deadlineTicks);
+
+    // Converts the input that arrived since the last call to the model rate.
+    void resampleInput();
+    // Hops whose analysis frames are complete in the model input ring buffer.
+    int getNumHopsReady() const;
+    // Extracts the features of up to `maxHops` ready hops into `features`, in a single model call if
+    // `batched`, and dequeues their input. Returns the number of hops analyzed.
+    int analyzeHops (int maxHops, bool batched, AudioFeatures* features);
+    // Extracts the features of the first `numHops` ready hops into `features`.
+    void extractFeatures (int numHops, bool batched, AudioFeatures* features);
+    // Fills batchedFeatures with the next hops to render: those the analysis stage handed over, or when
+    // the pipeline is not staged, whatever is ready. Returns the number of hops.
+    int takeNextHops();
+    // Predicts the controls of the first `numHops` batched features and synthesizes them.
+    void renderHops (int numHops);
+    // Runs the controls model for one hop of features.
+    void predictControls (AudioFeatures& features, SynthesisControls& controls);
+    // While a model swap fades, runs the previous model on the same features and mixes its controls
+    // into those of the current one.
+    void crossfadeFromPreviousModel (const AudioFeatures& features, SynthesisControls& controls);
+    // Applies the pitch shift and input offsets ahead of the controls model, and the gains after it.
+    void prepareControlsInput (AudioFeatures& features);
+    void finishControls (SynthesisControls& controls);
+    // The request predicting controls for `hop` of the batch with this pipeline's state.
+    PredictControlsModel::Request getControlsRequest (int hop);
+    // Synthesizes the first `numHops` batched controls and enqueues them to the output ring buffer. The
+    // noise is forked off to the noise stage when it runs.
+    void synthesizeBatchedHops (int numHops);
+
     int userFrameSize = 0;
     int userHopSize = 0;
+    // The harmonics are delayed by the group delay of the noise filter to stay in line with the noise.
+    int harmonicDelay = 0;
+    // Group delay of the input resampler, rounded to host-rate samples.
+    int resamplerLatency = 0;
+    int workerLatency = 0;
+    // Output primed ahead of the audio thread: the worker latency once startWorker() has run.
+    int outputLatency = 0;
+    bool offlineRendering = false;
+    juce::int64 offlineRenderTicks = 0;
+    juce::int64 numOfflineSamplesRendered = 0;
+
+    std::atomic<LatencyMode> latencyMode = { LatencyMode::kStandard };
+    // Model-rate samples of input in the analysis frame, centred in the model input tensor.
+    int analysisFrameSize = kModelFrameSize;
+    // Silence ahead of a frame that is shorter than a hop, so that it still ends on the hop.
+    int analysisFrameOffset = 0;
+    // Added to the extracted loudness to undo the silence around a shortened frame.
+    float loudnessCompensation_dB = 0.0f;
+    float loudnessCompensationNorm = 0.0f;
     double sampleRate = 0.0;
 
     std::atomic<float> currentPitch = { 0.0f };
     std::atomic<float> currentRMS = { 0.0f };
-    std::atomic<bool> swappingModel = false;
 
+    // Takes a newly loaded controls model, if any, and starts fading it in.
     void changeModel();
 
     // Param state.
     juce::AudioProcessorValueTreeState& tree;
 
     // DSP components.
-    juce::WindowedSincInterpolator inputInterpolator;
-    juce::WindowedSincInterpolator outputInterpolator;
+    // Converts the host input to the model rate once, as it arrives; created in prepareToPlay().
+    std::unique_ptr<PolyphaseResampler> inputResampler;
 
     // Scratch buffers.
-    juce::AudioBuffer<float> modelInputBuffer;
+    // Harmonic output in channel 0 and noise output in channel 1, kMaxOfflineBatchedHops hops long. The
+    // harmonic channel starts with the harmonicDelay samples held back from the previous batch.
     juce::AudioBuffer<float> synthesisBuffer;
-    juce::AudioBuffer<float> resampledModelInputBuffer;
-    juce::AudioBuffer<float> resampledModelOutputBuffer;
+    // Resampler output for a hop of input, used when the room in the model input FIFO wraps.
+    std::vector<float> resampledHop;
 
     // FIFOs.
+    // Input at the host rate, written by the audio thread.
     AudioRingBuffer inputRingBuffer;
+    // Input at the model rate, written and read by whichever thread renders. Analysis frames are
+    // read from it in place and advance by a model hop.
+    AudioRingBuffer modelInputRingBuffer;
     AudioRingBuffer outputRingBuffer;
 
+    // Worker.
+    juce::SharedResourcePointer<InferenceScheduler> scheduler;
+    // Registration with the scheduler while the worker runs, -1 otherwise. The audio thread submits it,
+    // or the analysis stage when there is one, once for every block that completes a hop of input.
+    int jobId = -1;
+    // Registrations of the stages while the pipeline is staged, -1 otherwise.
+    int analysisJobId = -1;
+    int noiseJobId = -1;
+    Stage analysisStage { *this, &InferencePipeline::runAnalysisStage };
+    Stage noiseStage { *this, &InferencePipeline::runNoiseStage };
+    // Deadline of the latest hop submitted, which the stages pass on.
+    std::atomic<juce::int64> hopDeadline = { 0 };
+    // From the analysis stage to the pipeline job.
+    SingleSlotQueue<AnalyzedHops> analyzedHops;
+    // Noise synthesis forked off to the noise stage: its state, the hops and where they go.
+    std::atomic<int> noiseState = { kNoiseIdle };
+    int numForkedNoiseHops = 0;
+    float* forkedNoiseOutput = nullptr;
+    // Input samples the audio thread still has to push before the next hop is ready.
+    int samplesUntilNextHop = 0;
+    // Trims output that piled up after an underrun back to the worker latency.
+    FillLevelController outputLevelController;
+
     // TF models.
     std::unique_ptr<FeatureExtractionModel> featureExtractionModel;
-    std::unique_ptr<PredictControlsModel> currentPredictControlsModel;
-    std::unique_ptr<PredictControlsModel> nextPredictControlsModel;
+    // The model shared with every other instance that plays it, which keeps the GRU state per instance,
+    // and a copy of this pipeline's own for whenever another thread is running the shared one, so
+    // that a hop rendered on the audio thread never waits on a worker.
+    struct ControlsModel
+    {
+        std::shared_ptr<PredictControlsModel> shared;
+        std::unique_ptr<PredictControlsModel> own;
+
+        void predict (const PredictControlsModel::Request& request);
+    };
+    ModelHandoff<ControlsModel> predictControlsModels;
+    PredictControlsModel::State gruState {};
+    // The model swapped out plays on with its own state until the fade ends.
+    PredictControlsModel::State previousGruState {};
+    SynthesisControls previousControls;
+    int crossfadeHopsLeft = 0;
 
     // Synthesis.
-    NoiseSynthesizer noiseSynthesizer;
-    HarmonicSynthesizer harmonicSynthesizer;
-    AudioFeatures predictControlsInput;
-    SynthesisControls synthesisInput;
+    // Synthesis at the host rate; created in prepareToPlay() once the rate is known.
+    HarmonicSynthesisEngine harmonicSynthesisEngine;
+    // Every pipeline plays its own noise, or instances playing together would add up coherently.
+    const juce::uint64 noiseSeed;
+    std::unique_ptr<HostRateNoiseSynthesizer> noiseSynthesizer;
+    std::unique_ptr<HarmonicSynthesizerBase> harmonicSynthesizer;
+    // Analysis frames, features and controls of the hops rendered together.
+    std::vector<FeatureExtractionModel::Frame> batchedFrames;
+    std::vector<AudioFeatures> batchedFeatures;
+    std::vector<SynthesisControls> batchedControls;
 
     // MIDI input.
     MidiInputProcessor midiInputProcessor;
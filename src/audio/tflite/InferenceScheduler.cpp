@@ -0,0 +1,376 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "audio/tflite/InferenceScheduler.h"
+
+#include <thread>
+
+#include "tensorflow/lite/external_cpu_backend_context.h"
+
+namespace ddsp
+{
+
+namespace
+{
+    constexpr int kWorkerStopTimeout_ms = 1000;
+
+    thread_local tflite::ExternalCpuBackendContext* currentBackendContext = nullptr;
+} // namespace
+
+void InferenceScheduler::Job::runJobs (Job* const* jobs, int numJobs, int* numHopsRendered)
+{
+    for (int i = 0; i < numJobs; ++i)
+    {
+        numHopsRendered[i] = jobs[i]->runJob();
+    }
+}
+
+class InferenceScheduler::Worker : public juce::Thread
+{
+public:
+    Worker (InferenceScheduler& s, int i)
+        : juce::Thread ("DDSP inference " + juce::String (i)),
+          scheduler (s),
+          index (i),
+          backendContext (std::make_unique<tflite::ExternalCpuBackendContext>())
+    {
+    }
+
+    void run() override
+    {
+        currentBackendContext = backendContext.get();
+        scheduler.work (*this);
+        currentBackendContext = nullptr;
+    }
+
+    InferenceScheduler& scheduler;
+    const int index;
+    std::unique_ptr<tflite::ExternalCpuBackendContext> backendContext;
+
+    LightweightSemaphore wakeUp;
+    // Set from just before the last look for work until the worker wakes up again.
+    std::atomic<bool> sleeping = { false };
+};
+
+InferenceScheduler::InferenceScheduler()
+{
+    const int numWorkers = std::max (1, juce::SystemStats::getNumPhysicalCpus() - 1);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back (std::make_unique<Worker> (*this, i));
+    }
+
+    for (auto& worker : workers)
+    {
+        worker->startThread();
+    }
+}
+
+InferenceScheduler::~InferenceScheduler()
+{
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+
+    for (auto& worker : workers)
+    {
+        worker->stopThread (kWorkerStopTimeout_ms);
+    }
+}
+
+int InferenceScheduler::getNumWorkers() const { return static_cast<int> (workers.size()); }
+
+int InferenceScheduler::add (Job& job)
+{
+    const std::scoped_lock lock (registrationMutex);
+    for (int jobId = 0; jobId < kMaxNumJobs; ++jobId)
+    {
+        auto& slot = slots[jobId];
+        if (slot.state.load() != kFree)
+        {
+            continue;
+        }
+
+        slot.job.store (&job);
+        slot.homeWorker.store (nextHomeWorker);
+        slot.batchKey.store (nullptr);
+        nextHomeWorker = (nextHomeWorker + 1) % getNumWorkers();
+        slot.counters.numRuns.store (0);
+        slot.counters.numHopsRendered.store (0);
+        slot.counters.numDeadlineMisses.store (0);
+        slot.counters.numBatchedRuns.store (0);
+        slot.state.store (kIdle);
+
+        numSlotsInUse.store (std::max (numSlotsInUse.load(), jobId + 1));
+        return jobId;
+    }
+
+    return -1;
+}
+
+void InferenceScheduler::remove (int jobId)
+{
+    const std::scoped_lock lock (registrationMutex);
+    auto& slot = slots[jobId];
+    for (int state = slot.state.load();; state = slot.state.load())
+    {
+        jassert (state != kFree);
+        if (state == kRunning || state == kRunningAndPending)
+        {
+            std::this_thread::yield();
+        }
+        else if (slot.state.compare_exchange_weak (state, kFree))
+        {
+            return;
+        }
+    }
+}
+
+void InferenceScheduler::setBatchKey (int jobId, const void* key) { slots[jobId].batchKey.store (key); }
+
+void InferenceScheduler::submit (int jobId, juce::int64 deadlineTicks)
+{
+    auto& slot = slots[jobId];
+    for (int state = slot.state.load();;)
+    {
+        if (state != kIdle && state != kRunning)
+        {
+            // Pending already: the earlier deadline stands.
+            return;
+        }
+
+        slot.deadline.store (deadlineTicks);
+        if (state == kIdle)
+        {
+            slot.submitted.store (juce::Time::getHighResolutionTicks());
+        }
+        if (slot.state.compare_exchange_weak (state, state == kIdle ? kPending : kRunningAndPending))
+        {
+            // A running job is picked up again by its worker when the run ends.
+            if (state == kIdle)
+            {
+                wake (slot.homeWorker.load());
+            }
+            return;
+        }
+    }
+}
+
+InferenceScheduler::Statistics InferenceScheduler::getStatistics() const { return read (totals); }
+
+InferenceScheduler::Statistics InferenceScheduler::getStatistics (int jobId) const
+{
+    return read (slots[jobId].counters);
+}
+
+tflite::ExternalCpuBackendContext* InferenceScheduler::getCurrentBackendContext() { return currentBackendContext; }
+
+InferenceScheduler::Statistics InferenceScheduler::read (const Counters& counters)
+{
+    return { counters.numRuns.load(),
+             counters.numHopsRendered.load(),
+             counters.numDeadlineMisses.load(),
+             counters.numBatchedRuns.load() };
+}
+
+void InferenceScheduler::work (Worker& worker)
+{
+    std::array<int, kMaxBatchedJobs> jobIds;
+    bool holding = false;
+    while (! worker.threadShouldExit())
+    {
+        if (const int numJobs = claimNextJobs (worker.index, jobIds.data(), holding); numJobs > 0)
+        {
+            runClaimedJobs (jobIds.data(), numJobs);
+            continue;
+        }
+
+        if (holding)
+        {
+            // Jobs are waiting for their siblings, which takes no longer than the gather window.
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Announce the sleep before looking once more: a job submitted in between is either found
+        // here, or its submit() sees the flag and wakes the worker.
+        worker.sleeping.store (true);
+        if (const int numJobs = claimNextJobs (worker.index, jobIds.data(), holding); numJobs > 0)
+        {
+            worker.sleeping.store (false);
+            runClaimedJobs (jobIds.data(), numJobs);
+            continue;
+        }
+
+        if (holding)
+        {
+            worker.sleeping.store (false);
+            continue;
+        }
+
+        worker.wakeUp.wait();
+        worker.sleeping.store (false);
+    }
+}
+
+int InferenceScheduler::claimNextJobs (int worker, int* jobIds, bool& holding)
+{
+    const auto now = juce::Time::getHighResolutionTicks();
+    const int numSlots = numSlotsInUse.load();
+    holding = false;
+    for (;;)
+    {
+        int best = -1;
+        bool bestIsOwn = false;
+        juce::int64 bestDeadline = 0;
+
+        for (int jobId = 0; jobId < numSlots; ++jobId)
+        {
+            const auto& slot = slots[jobId];
+            if (slot.state.load() != kPending)
+            {
+                continue;
+            }
+
+            const bool isOwn = slot.homeWorker.load() == worker;
+            const auto deadline = slot.deadline.load();
+            if (best < 0 || (isOwn && ! bestIsOwn) || (isOwn == bestIsOwn && deadline < bestDeadline))
+            {
+                if (isGathering (jobId, now))
+                {
+                    holding = true;
+                    continue;
+                }
+
+                best = jobId;
+                bestIsOwn = isOwn;
+                bestDeadline = deadline;
+            }
+        }
+
+        if (best < 0)
+        {
+            return 0;
+        }
+
+        // Another worker may have claimed it since; look again if so.
+        if (int expected = kPending; ! slots[best].state.compare_exchange_strong (expected, kRunning))
+        {
+            continue;
+        }
+
+        jobIds[0] = best;
+        int numJobs = 1;
+        if (const void* key = slots[best].batchKey.load(); key != nullptr)
+        {
+            for (int jobId = 0; jobId < numSlots && numJobs < kMaxBatchedJobs; ++jobId)
+            {
+                auto& slot = slots[jobId];
+                if (int expected = kPending; jobId != best && slot.batchKey.load() == key
+                                             && slot.state.compare_exchange_strong (expected, kRunning))
+                {
+                    jobIds[numJobs++] = jobId;
+                }
+            }
+        }
+        return numJobs;
+    }
+}
+
+bool InferenceScheduler::isGathering (int jobId, juce::int64 now) const
+{
+    const auto& slot = slots[jobId];
+    const void* key = slot.batchKey.load();
+    const auto window = juce::Time::secondsToHighResolutionTicks (kBatchGatherWindow_ms / 1000.0);
+    if (key == nullptr || now - slot.submitted.load() >= window || slot.deadline.load() - now < window)
+    {
+        return false;
+    }
+
+    // A sibling that is running or pending already will not join this batch by waiting.
+    const int numSlots = numSlotsInUse.load();
+    for (int other = 0; other < numSlots; ++other)
+    {
+        if (other != jobId && slots[other].batchKey.load() == key && slots[other].state.load() == kIdle)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void InferenceScheduler::runClaimedJobs (const int* jobIds, int numJobs)
+{
+    std::array<juce::int64, kMaxBatchedJobs> deadlines;
+    std::array<Job*, kMaxBatchedJobs> jobs;
+    std::array<int, kMaxBatchedJobs> numHops;
+    for (int i = 0; i < numJobs; ++i)
+    {
+        deadlines[i] = slots[jobIds[i]].deadline.load();
+        jobs[i] = slots[jobIds[i]].job.load();
+    }
+
+    if (numJobs == 1)
+    {
+        numHops[0] = jobs[0]->runJob();
+    }
+    else
+    {
+        jobs[0]->runJobs (jobs.data(), numJobs, numHops.data());
+    }
+
+    const auto finished = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < numJobs; ++i)
+    {
+        auto& slot = slots[jobIds[i]];
+        const bool missedDeadline = numHops[i] > 0 && finished > deadlines[i];
+        for (auto* counters : { &slot.counters, &totals })
+        {
+            counters->numRuns.fetch_add (1, std::memory_order_relaxed);
+            counters->numHopsRendered.fetch_add (numHops[i], std::memory_order_relaxed);
+            counters->numDeadlineMisses.fetch_add (missedDeadline ? 1 : 0, std::memory_order_relaxed);
+            counters->numBatchedRuns.fetch_add (numJobs > 1 ? 1 : 0, std::memory_order_relaxed);
+        }
+
+        if (int expected = kRunning; ! slot.state.compare_exchange_strong (expected, kIdle))
+        {
+            jassert (expected == kRunningAndPending);
+            slot.state.store (kPending);
+        }
+    }
+}
+
+void InferenceScheduler::wake (int homeWorker)
+{
+    if (workers[homeWorker]->sleeping.load())
+    {
+        workers[homeWorker]->wakeUp.signal();
+        return;
+    }
+
+    for (auto& worker : workers)
+    {
+        if (worker->sleeping.load())
+        {
+            worker->wakeUp.signal();
+            return;
+        }
+    }
+}
+
+} // namespace ddsp
@@ -0,0 +1,166 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "util/LightweightSemaphore.h"
+
+namespace tflite
+{
+class ExternalCpuBackendContext;
+}
+
+namespace ddsp
+{
+
+// Pool of inference workers shared by every plugin instance in the process. Hold it through a
+// juce::SharedResourcePointer, which keeps a single pool alive while any instance uses it.
+//
+// Each instance registers a job that renders whatever hops it has ready; a job never runs on two
+// workers at once. The audio thread submits its job with a deadline, the time its output FIFO runs dry,
+// and wakes the job's home worker. A worker runs the pending job with the earliest deadline among its
+// own and steals the one with the earliest deadline from the others once it has none left.
+//
+// Jobs may carry a batch key, such as the model they run. A worker that claims a job with a key claims
+// the other pending jobs with the same key along with it and runs them all together, so that they can
+// share model invocations; the batch runs by the earliest of their deadlines. While a sibling of a
+// submitted job has yet to be submitted, for instance by an instance later in the host's processing
+// order, the job is held back for up to kBatchGatherWindow_ms so that the hops line up.
+//
+// Every worker also owns a TFLite CPU backend context, which the models bind while they run on it, so
+// the interpreters of all instances share one context per worker instead of bringing their own threads.
+class InferenceScheduler
+{
+public:
+    // Renders the hops of one instance that are ready.
+    class Job
+    {
+    public:
+        virtual ~Job() = default;
+        // Returns the number of hops rendered.
+        virtual int runJob() = 0;
+        // Runs `numJobs` jobs that share a batch key, this one first, and writes the number of hops each
+        // rendered to `numHopsRendered`. Runs them one after the other unless overridden.
+        virtual void runJobs (Job* const* jobs, int numJobs, int* numHopsRendered);
+    };
+
+    struct Statistics
+    {
+        juce::int64 numRuns = 0;
+        juce::int64 numHopsRendered = 0;
+        // Runs that rendered hops but finished after the deadline they were submitted with.
+        juce::int64 numDeadlineMisses = 0;
+        // Runs made together with other jobs of the same batch key.
+        juce::int64 numBatchedRuns = 0;
+    };
+
+    static constexpr int kMaxNumJobs = 256;
+    // Most jobs run together.
+    static constexpr int kMaxBatchedJobs = 16;
+    // Longest a submitted job waits for siblings that share its batch key.
+    static constexpr double kBatchGatherWindow_ms = 1.0;
+
+    // Starts a worker per physical core, less one left to the host's audio thread.
+    InferenceScheduler();
+    ~InferenceScheduler();
+
+    int getNumWorkers() const;
+
+    // Registers `job` with the next home worker in turn. Returns its id, or -1 if kMaxNumJobs are
+    // registered already.
+    int add (Job& job);
+    // Unregisters a job, waiting for a run in progress to finish first.
+    void remove (int jobId);
+    // Jobs with the same key are run together; nullptr, the default, runs the job on its own. Safe to call
+    // from the job itself.
+    void setBatchKey (int jobId, const void* key);
+    // Marks a job as ready to run by `deadlineTicks`, in juce::Time::getHighResolutionTicks(), and wakes
+    // a worker. Real-time safe. A job that is still pending keeps its earlier deadline.
+    void submit (int jobId, juce::int64 deadlineTicks);
+
+    // Totals since construction, and of one job since it was added.
+    Statistics getStatistics() const;
+    Statistics getStatistics (int jobId) const;
+
+    // Backend context of the worker running on the calling thread, nullptr on any other thread.
+    static tflite::ExternalCpuBackendContext* getCurrentBackendContext();
+
+private:
+    class Worker;
+
+    enum State
+    {
+        kFree,
+        kIdle,
+        kPending,
+        kRunning,
+        // Submitted again while running.
+        kRunningAndPending,
+    };
+
+    struct Counters
+    {
+        std::atomic<juce::int64> numRuns = { 0 };
+        std::atomic<juce::int64> numHopsRendered = { 0 };
+        std::atomic<juce::int64> numDeadlineMisses = { 0 };
+        std::atomic<juce::int64> numBatchedRuns = { 0 };
+    };
+
+    struct Slot
+    {
+        std::atomic<int> state = { kFree };
+        std::atomic<juce::int64> deadline = { 0 };
+        // When the job last went from idle to pending.
+        std::atomic<juce::int64> submitted = { 0 };
+        std::atomic<const void*> batchKey = { nullptr };
+        std::atomic<Job*> job = { nullptr };
+        std::atomic<int> homeWorker = { 0 };
+        Counters counters;
+    };
+
+    static Statistics read (const Counters& counters);
+
+    // Runs jobs until the worker is asked to exit, sleeping while there are none pending.
+    void work (Worker& worker);
+    // Claims the pending job with the earliest deadline, preferring the worker's own, and the pending
+    // jobs that share its batch key. Writes their ids to `jobIds` and returns how many were claimed.
+    // Sets `holding` if a job was left pending only to wait for its siblings.
+    int claimNextJobs (int worker, int* jobIds, bool& holding);
+    // Whether a pending job should wait for a sibling that has not been submitted yet.
+    bool isGathering (int jobId, juce::int64 now) const;
+    void runClaimedJobs (const int* jobIds, int numJobs);
+    // Wakes the home worker if it sleeps, or else any worker that does.
+    void wake (int homeWorker);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::array<Slot, kMaxNumJobs> slots;
+    // One past the highest slot ever registered, so that workers only scan the slots in use.
+    std::atomic<int> numSlotsInUse = { 0 };
+    int nextHomeWorker = 0;
+    std::mutex registrationMutex;
+
+    Counters totals;
+};
+
+} // namespace ddsp
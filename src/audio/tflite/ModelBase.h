@@ -16,8 +16,13 @@ limitations under the License.
 
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include "JuceHeader.h"
 
+#include "audio/tflite/InferenceScheduler.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
@@ -33,7 +38,8 @@ class ModelBase
 {
 public:
     ModelBase (const char* modelDataPtr, size_t dataSize, int numThreads) 
-        //: flex_delegate (TF_AcquireFlexDelegate())
+        : numThreads (numThreads)
+        //, flex_delegate (TF_AcquireFlexDelegate())
     {
         //if (!flex_delegate)
         //{
@@ -43,26 +49,46 @@ public:
         modelBuffer = tflite::FlatBufferModel::VerifyAndBuildFromBuffer (modelDataPtr, dataSize);
         jassert (modelBuffer != nullptr);
 
-        tflite::ops::builtin::BuiltinOpResolver resolver;
-        tflite::InterpreterBuilder builder (*modelBuffer, resolver);
-
-        builder.SetNumThreads (numThreads);
-        auto status = builder (&interpreter);
-        jassert (status == kTfLiteOk);
+        interpreter = buildInterpreter();
         jassert (interpreter != nullptr);
 
         //interpreter->ModifyGraphWithDelegate (flex_delegate.get());
         jassert (interpreter != nullptr);
 
-        status = interpreter->AllocateTensors();
+        // Used whenever the model runs outside the inference workers.
+        interpreter->SetExternalContext (kTfLiteCpuBackendContext, ownBackendContext.get());
+        boundBackendContext = ownBackendContext.get();
+
+        const auto status = interpreter->AllocateTensors();
         jassert (status == kTfLiteOk);
+
+        for (int i = 0; i < static_cast<int> (interpreter->inputs().size()); ++i)
+        {
+            inputItemSizes.push_back (static_cast<int> (interpreter->input_tensor (i)->bytes / sizeof (float)));
+        }
+        for (int i = 0; i < static_cast<int> (interpreter->outputs().size()); ++i)
+        {
+            outputItemSizes.push_back (static_cast<int> (interpreter->output_tensor (i)->bytes / sizeof (float)));
+        }
     }
 
     virtual ~ModelBase()
     { 
+        // The interpreter clears the caches of its context on destruction, which must not happen to
+        // that of a worker while it runs another model.
+        if (interpreter != nullptr)
+        {
+            interpreter->SetExternalContext (kTfLiteCpuBackendContext, ownBackendContext.get());
+        }
+        for (auto& batch : batches)
+        {
+            batch.interpreter->SetExternalContext (kTfLiteCpuBackendContext, ownBackendContext.get());
+        }
+
         modelBuffer.reset();
 
         // order is important here!
+        batches.clear();
         interpreter.reset();
         //flex_delegate.reset();
     }
@@ -108,10 +134,180 @@ public:
     // TODO: return error code.
     virtual void call (const Input& input, Output& output) = 0;
 
+    // Whether the model runs batches in one invocation.
+    bool supportsBatching() const { return batchingSupported; }
+
 protected:
+    // Runs the interpreter on the backend context of the calling inference worker, or on a context of
+    // its own anywhere else.
+    TfLiteStatus invoke() { return invoke (*interpreter, boundBackendContext); }
+
+    // Runs the interpreter that holds batches of `numItems` items, see interpreterFor().
+    TfLiteStatus invoke (int numItems)
+    {
+        if (numItems <= 1)
+        {
+            return invoke();
+        }
+
+        auto& batch = batchFor (numItems);
+        return invoke (*batch.interpreter, batch.boundBackendContext);
+    }
+
+    // Builds an interpreter for each power of two from 2 to `maxBatchSize` items, with the leading
+    // dimension of every input, which the model was built with as 1, resized to it. Every output has
+    // to come back with that many items too, or the graph is mixing them. Resizing allocates, so this
+    // runs once at construction and the batches keep their shapes from then on. Builds none, and
+    // leaves batching off for good, if the model cannot take a batch.
+    void prepareBatches (int maxBatchSize)
+    {
+        // Only inputs that lead with the batch can be resized along it.
+        for (size_t i = 0; batchingSupported && i < interpreter->inputs().size(); ++i)
+        {
+            const TfLiteIntArray* dims = interpreter->input_tensor (i)->dims;
+            batchingSupported = dims->size > 0 && dims->data[0] == 1;
+        }
+
+        if (! batchingSupported)
+        {
+            DBG ("Model inputs have no batch dimension");
+            return;
+        }
+
+        for (int numItems = 2; batchingSupported && numItems <= maxBatchSize; numItems *= 2)
+        {
+            batchingSupported = addBatch (numItems);
+        }
+
+        if (! batchingSupported)
+        {
+            batches.clear();
+        }
+    }
+
+    // Largest batch that runs in one invocation, 1 without batching.
+    int getMaxBatchSize() const { return batches.empty() ? 1 : batches.back().numItems; }
+
+    // The interpreter of the smallest batch that holds `numItems` items, at most getMaxBatchSize().
+    // Items past `numItems` are padding: their inputs are whatever an earlier invocation left there,
+    // or zeros, and their outputs are to be ignored.
+    tflite::Interpreter& interpreterFor (int numItems)
+    {
+        return numItems <= 1 ? *interpreter : *batchFor (numItems).interpreter;
+    }
+
+    // Floats of each input and output per item of a batch.
+    std::vector<int> inputItemSizes;
+    std::vector<int> outputItemSizes;
+    bool batchingSupported = true;
+
+    std::unique_ptr<tflite::ExternalCpuBackendContext> ownBackendContext =
+        std::make_unique<tflite::ExternalCpuBackendContext>();
+    TfLiteExternalContext* boundBackendContext = nullptr;
     std::unique_ptr<tflite::FlatBufferModel> modelBuffer;
     std::unique_ptr<tflite::Interpreter> interpreter;
     //tflite::TfLiteDelegateUniquePtr flex_delegate; // to allow SELECT_TF_OPS (subset of tf operations)
+
+private:
+    // An interpreter of the model whose inputs hold `numItems` items each.
+    struct Batch
+    {
+        int numItems = 1;
+        std::unique_ptr<tflite::Interpreter> interpreter;
+        TfLiteExternalContext* boundBackendContext = nullptr;
+    };
+
+    std::unique_ptr<tflite::Interpreter> buildInterpreter() const
+    {
+        tflite::ops::builtin::BuiltinOpResolver resolver;
+        tflite::InterpreterBuilder builder (*modelBuffer, resolver);
+
+        builder.SetNumThreads (numThreads);
+        std::unique_ptr<tflite::Interpreter> built;
+        const auto status = builder (&built);
+        jassert (status == kTfLiteOk);
+        return built;
+    }
+
+    bool addBatch (int numItems)
+    {
+        Batch batch { numItems, buildInterpreter() };
+        if (batch.interpreter == nullptr)
+        {
+            return false;
+        }
+
+        bool resized = true;
+        for (size_t i = 0; resized && i < interpreter->inputs().size(); ++i)
+        {
+            const TfLiteIntArray* dims = interpreter->input_tensor (i)->dims;
+            std::vector<int> shape (dims->data, dims->data + dims->size);
+            shape[0] = numItems;
+            resized = batch.interpreter->ResizeInputTensor (batch.interpreter->inputs()[i], shape) == kTfLiteOk;
+        }
+
+        resized = resized && batch.interpreter->AllocateTensors() == kTfLiteOk;
+        for (size_t i = 0; resized && i < interpreter->outputs().size(); ++i)
+        {
+            resized = batch.interpreter->output_tensor (i)->bytes == numItems * outputItemSizes[i] * sizeof (float);
+        }
+
+        if (! resized)
+        {
+            DBG ("Model does not take a batch of " << numItems);
+            return false;
+        }
+
+        // Padding reads zeros until the batch has run with real items, and whatever the interpreter sets
+        // up on its first invocation is allocated here rather than on the thread that runs the model.
+        for (size_t i = 0; i < batch.interpreter->inputs().size(); ++i)
+        {
+            const TfLiteTensor* input = batch.interpreter->input_tensor (i);
+            std::fill_n (input->data.raw, input->bytes, 0);
+        }
+        batch.interpreter->SetExternalContext (kTfLiteCpuBackendContext, ownBackendContext.get());
+        batch.boundBackendContext = ownBackendContext.get();
+        if (batch.interpreter->Invoke() != kTfLiteOk)
+        {
+            DBG ("Model fails on a batch of " << numItems);
+            return false;
+        }
+
+        batches.push_back (std::move (batch));
+        return true;
+    }
+
+    Batch& batchFor (int numItems)
+    {
+        jassert (numItems <= getMaxBatchSize());
+        auto batch = std::find_if (batches.begin(), batches.end(), [numItems] (const Batch& b) {
+            return b.numItems >= numItems;
+        });
+        return batch != batches.end() ? *batch : batches.back();
+    }
+
+    // Runs `target` on the backend context of the calling inference worker, or on a context of its own
+    // anywhere else. `bound` is the context `target` last ran on.
+    TfLiteStatus invoke (tflite::Interpreter& target, TfLiteExternalContext*& bound)
+    {
+        TfLiteExternalContext* backendContext = InferenceScheduler::getCurrentBackendContext();
+        if (backendContext == nullptr)
+        {
+            backendContext = ownBackendContext.get();
+        }
+
+        if (backendContext != bound)
+        {
+            target.SetExternalContext (kTfLiteCpuBackendContext, backendContext);
+            bound = backendContext;
+        }
+
+        return target.Invoke();
+    }
+
+    const int numThreads;
+    // Interpreters for batches of 2, 4, 8, ... items, in that order.
+    std::vector<Batch> batches;
 };
 
 } // namespace ddsp
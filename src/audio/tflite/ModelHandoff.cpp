@@ -0,0 +1,68 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "audio/tflite/ModelHandoff.h"
+
+namespace ddsp
+{
+
+namespace
+{
+    constexpr int kReclaimerStopTimeout_ms = 1000;
+} // namespace
+
+ModelReclaimer::ModelReclaimer() : juce::Thread ("DDSP model reclaimer") { startThread(); }
+
+ModelReclaimer::~ModelReclaimer()
+{
+    signalThreadShouldExit();
+    wakeUp.signal();
+    stopThread (kReclaimerStopTimeout_ms);
+    reclaim();
+}
+
+void ModelReclaimer::retire (Retired* retired)
+{
+    retired->nextRetired = retiredHead.load();
+    while (! retiredHead.compare_exchange_weak (retired->nextRetired, retired))
+    {
+    }
+    wakeUp.signal();
+}
+
+void ModelReclaimer::reclaim()
+{
+    for (auto* retired = retiredHead.exchange (nullptr); retired != nullptr;)
+    {
+        auto* next = retired->nextRetired;
+        delete retired;
+        numReclaimed.fetch_add (1);
+        retired = next;
+    }
+}
+
+juce::int64 ModelReclaimer::getNumReclaimed() const { return numReclaimed.load(); }
+
+void ModelReclaimer::run()
+{
+    while (! threadShouldExit())
+    {
+        wakeUp.wait();
+        reclaim();
+    }
+}
+
+} // namespace ddsp
@@ -0,0 +1,132 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "JuceHeader.h"
+
+#include "util/LightweightSemaphore.h"
+
+namespace ddsp
+{
+
+// Deletes what the render threads are done with on a background thread of its own, so that they never
+// free memory or tear down an interpreter themselves. Hold it through a juce::SharedResourcePointer,
+// which keeps a single reclaimer alive while anything uses it.
+class ModelReclaimer : private juce::Thread
+{
+public:
+    // Anything retired is deleted through this base.
+    struct Retired
+    {
+        virtual ~Retired() = default;
+        Retired* nextRetired = nullptr;
+    };
+
+    ModelReclaimer();
+    ~ModelReclaimer() override;
+
+    // Hands `retired` over to be deleted on the reclaimer thread. Real-time safe: it neither locks,
+    // allocates nor frees, and may be called from any number of threads at once.
+    void retire (Retired* retired);
+    // Deletes everything retired so far on the calling thread.
+    void reclaim();
+    // Deleted since construction.
+    juce::int64 getNumReclaimed() const;
+
+private:
+    void run() override;
+
+    // Pushed onto by retire() and taken whole by reclaim(), which is what keeps the stack free of ABA.
+    std::atomic<Retired*> retiredHead = { nullptr };
+    LightweightSemaphore wakeUp;
+    std::atomic<juce::int64> numReclaimed = { 0 };
+};
+
+// Hands models from the thread that prepares them to the one that renders with them, and on to the
+// ModelReclaimer once rendering is done with them.
+//
+// A model is published whole, after it has been loaded and run once, by swapping a pointer. The render
+// thread takes the latest one at the start of a render; the model it replaces stays available as the
+// previous one, for fading out, until the render thread releases it to the reclaimer. Neither side
+// waits for the other, and the render thread never allocates or frees.
+template <typename Model>
+class ModelHandoff
+{
+public:
+    ModelHandoff() = default;
+
+    ~ModelHandoff()
+    {
+        delete published.exchange (nullptr);
+        delete current;
+        delete previous;
+    }
+
+    // Publishes a model ready to run, replacing any published earlier that the render thread has not
+    // taken yet. Call from any thread but the render thread.
+    void publish (std::shared_ptr<Model> model) { delete published.exchange (new Holder (std::move (model))); }
+
+    // Takes the model published last, if any, as the current one. Any previous model still held is
+    // released. Returns whether the current model changed. Render thread only.
+    bool acquire()
+    {
+        auto* next = published.exchange (nullptr);
+        if (next == nullptr)
+        {
+            return false;
+        }
+
+        releasePrevious();
+        previous = current;
+        current = next;
+        return true;
+    }
+
+    // Hands the previous model to the reclaimer. Render thread only.
+    void releasePrevious()
+    {
+        if (previous != nullptr)
+        {
+            reclaimer->retire (previous);
+            previous = nullptr;
+        }
+    }
+
+    // The model acquired last and the one it replaced, or nullptr. Render thread only.
+    Model* getCurrent() const { return current != nullptr ? current->model.get() : nullptr; }
+    Model* getPrevious() const { return previous != nullptr ? previous->model.get() : nullptr; }
+
+private:
+    struct Holder : ModelReclaimer::Retired
+    {
+        explicit Holder (std::shared_ptr<Model> m) : model (std::move (m)) {}
+        std::shared_ptr<Model> model;
+    };
+
+    std::atomic<Holder*> published = { nullptr };
+    Holder* current = nullptr;
+    Holder* previous = nullptr;
+
+    juce::SharedResourcePointer<ModelReclaimer> reclaimer;
+
+    JUCE_DECLARE_NON_COPYABLE (ModelHandoff)
+};
+
+} // namespace ddsp
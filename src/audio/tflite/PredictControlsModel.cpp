@@ -17,14 +17,17 @@ limitations under the License.
 #include "audio/tflite/PredictControlsModel.h"
 #include "util/Constants.h"
 
+#include <algorithm>
+#include <map>
 #include <random>
 
 namespace ddsp
 {
 
-PredictControlsModel::PredictControlsModel (const ModelInfo& mi)
+PredictControlsModel::PredictControlsModel (const ModelInfo& mi, int maxBatchSize)
     : ModelBase (mi.data.begin(), mi.data.getSize(), kNumPredictControlsThreads), modelInfo(mi)
 {
+    prepareBatches (maxBatchSize);
     reset();
     describe();
 
@@ -33,128 +36,144 @@ PredictControlsModel::PredictControlsModel (const ModelInfo& mi)
     gen = std::mt19937(rd());
     dis = std::uniform_real_distribution<float>(0.0, 1.0); // Adjust the range of random float values as needed
 
+    // Run once, so that whatever the interpreter sets up on its first invocation is allocated here
+    // rather than on the render thread that the model is handed to.
+    SynthesisControls controls;
+    call (AudioFeatures {}, controls);
+    reset();
 }
 
-template<typename T>
-void initTensorWithRandomValues(TfLiteTensor* tensor, std::uniform_real_distribution<float>& dis, std::mt19937& gen)
+std::shared_ptr<PredictControlsModel> PredictControlsModel::getShared (const ModelInfo& mi)
 {
-    int input_size = 1;
-    for (int i = 0; i < tensor->dims->size; ++i) {
-        input_size *= tensor->dims->data[i];
-    }
-
-    // Cast the input tensor data to float and fill it with random float values
-    float* input_data = reinterpret_cast<T*>(tensor->data.raw);
-    for (int i = 0; i < input_size; ++i) {
-        input_data[i] = dis(gen);
+    static std::mutex mutex;
+    static std::map<juce::String, std::weak_ptr<PredictControlsModel>> cache;
+
+    // Names and timestamps tell the models apart; the contents are compared in case they do not.
+    const std::lock_guard<std::mutex> lock (mutex);
+    auto& entry = cache[mi.name + "@" + mi.timestamp + "#" + juce::String (mi.data.getSize())];
+    auto model = entry.lock();
+    if (model == nullptr || model->modelInfo.data != mi.data)
+    {
+        model = std::make_shared<PredictControlsModel> (mi);
+        entry = model;
     }
+    return model;
 }
 
 void PredictControlsModel::call (const AudioFeatures& input, SynthesisControls& output)
 {
-    if (modelInfo.modelType == ModelType::MIDI_DDSP)
+    const Request request { &input, &gruState, &output };
+    callBatch (&request, 1);
+}
+
+void PredictControlsModel::callBatch (const Request* requests, int numRequests)
+{
+    const std::lock_guard<std::mutex> lock (invokeMutex);
+    invokeBatches (requests, numRequests);
+}
+
+bool PredictControlsModel::tryCallBatch (const Request* requests, int numRequests)
+{
+    const std::unique_lock<std::mutex> lock (invokeMutex, std::try_to_lock);
+    if (! lock.owns_lock())
     {
-        DBG ("gathering outputs of MIDI_DDSP model");
+        return false;
     }
-    
-    for (size_t i = 0; i < interpreter->inputs().size(); ++i)
+
+    invokeBatches (requests, numRequests);
+    return true;
+}
+
+void PredictControlsModel::invokeBatches (const Request* requests, int numRequests)
+{
+    // Each invocation runs on the smallest batch that fits it, built at construction, with padding.
+    const int maxBatchSize = getMaxBatchSize();
+    for (int start = 0; start < numRequests;)
     {
-        const std::string_view inputName (interpreter->GetInputName (i));
+        const int numInBatch = std::min (maxBatchSize, numRequests - start);
+        auto& batch = interpreterFor (numInBatch);
 
-        if (inputName == getF0InputName(modelInfo))
+        for (int i = 0; i < numInBatch; ++i)
         {
-            *interpreter->typed_input_tensor<float> (i) = input.f0_norm;
+            fillInputs (batch, i, requests[start + i]);
         }
-        else if (inputName == getLoudnessInputName(modelInfo))
+
+        // Run tflite graph computation on input.
+
+        if (const auto status = invoke (numInBatch); status != kTfLiteOk)
         {
-            *interpreter->typed_input_tensor<float> (i) = input.loudness_norm;
+            std::cerr << "Failed to compute, status code: " << status << std::endl;
         }
-        else if (inputName == getStateInputName(modelInfo))
+
+        for (int i = 0; i < numInBatch; ++i)
         {
-            for (size_t j = 0; j < gruState.size(); j++)
-            {
-                interpreter->typed_input_tensor<float> (i)[j] = gruState[j];
-            }
+            readOutputs (batch, i, requests[start + i]);
         }
-        else if (inputName == getMidiInputName (modelInfo))
+        start += numInBatch;
+    }
+}
+
+void PredictControlsModel::fillInputs (tflite::Interpreter& batch, int index, const Request& request)
+{
+    const AudioFeatures& input = *request.input;
+    for (size_t i = 0; i < batch.inputs().size(); ++i)
+    {
+        const std::string_view inputName (batch.GetInputName (i));
+        float* tensor = batch.typed_input_tensor<float> (i) + index * inputItemSizes[i];
+
+        if (inputName == getF0InputName(modelInfo))
         {
-            initTensorWithRandomValues<float>(interpreter->input_tensor(i), dis, gen);
+            *tensor = input.f0_norm;
         }
-        else if (inputName == getOnsetsInputName (modelInfo))
+        else if (inputName == getLoudnessInputName(modelInfo))
         {
-            initTensorWithRandomValues<float>(interpreter->input_tensor(i), dis, gen);
+            *tensor = input.loudness_norm;
         }
-        else if (inputName == getOffsetsInputName (modelInfo))
+        else if (inputName == getStateInputName(modelInfo))
         {
-            initTensorWithRandomValues<float>(interpreter->input_tensor(i), dis, gen);
+            std::copy (request.state->begin(), request.state->end(), tensor);
         }
-        else if (inputName == getInstrumentIdInputName (modelInfo))
+        else if (inputName == getMidiInputName (modelInfo)
+                 || inputName == getOnsetsInputName (modelInfo)
+                 || inputName == getOffsetsInputName (modelInfo)
+                 || inputName == getInstrumentIdInputName (modelInfo))
         {
-            initTensorWithRandomValues<float>(interpreter->input_tensor(i), dis, gen);
+            // Random values in place of the note inputs the MIDI model is not given yet.
+            std::generate (tensor, tensor + inputItemSizes[i], [this] { return dis (gen); });
         }
         else
         {
             std::cerr << "Invalid tensor name: " + juce::StringRef (inputName.data()) << std::endl;
         }
     }
+}
 
-    // Run tflite graph computation on input.
-
-    if (const auto status = interpreter->Invoke(); status != kTfLiteOk)
-    {
-        std::cerr << "Failed to compute, status code: " << status << std::endl;
-    }
-
-    size_t n_outputs = interpreter->outputs().size();
+void PredictControlsModel::readOutputs (tflite::Interpreter& batch, int index, const Request& request)
+{
+    SynthesisControls& output = *request.output;
+    size_t n_outputs = batch.outputs().size();
 
     for (size_t output_idx = 0; output_idx < n_outputs; ++output_idx)
     {
-        const std::string_view outputName (interpreter->GetOutputName (output_idx));
-        
-        //if (modelInfo.modelType == ModelType::MIDI_DDSP)
-        for (size_t q = 0; q < n_outputs; ++q)
-        {
-            DBG (juce::String("gathering outputs of MIDI_DDSP model. Output: ") + juce::String(std::string(outputName)));
-            TfLiteTensor* output_tensor0 = interpreter->output_tensor (q);
-            float* output_tensor0_2 = interpreter->typed_output_tensor<float> (q);
-            int* output_tensor0_3 = interpreter->typed_output_tensor<int> (q);
-            double* output_tensor0_4 = interpreter->typed_output_tensor<double> (q);
-            
-            char* data_raw = output_tensor0->data.raw;
-            float* output_tensor0_rc = reinterpret_cast<float*> (data_raw);
-
-            DBG (int (data_raw));
-            DBG (int (output_tensor0));
-            DBG ((output_tensor0_2 ? *output_tensor0_2 : 0.f));
-            DBG ((output_tensor0_3 ? *output_tensor0_3 : 0));
-            DBG ((output_tensor0_4 ? *output_tensor0_4 : 0.0));
-            DBG ((output_tensor0_rc ? *output_tensor0_rc : 0.0));
-        }
+        const std::string_view outputName (batch.GetOutputName (output_idx));
+        const float* tensor =
+            batch.typed_output_tensor<float> (output_idx) + index * outputItemSizes[output_idx];
 
         if (outputName == getAmplitudeOutputName (modelInfo))
         {
-            output.amplitude = *interpreter->typed_output_tensor<float> (output_idx);
+            output.amplitude = *tensor;
         }
         else if (outputName == getHarmonicsOutputName (modelInfo))
         {
-            for (int j = 0; j < kHarmonicsSize; j++)
-            {
-                output.harmonics[j] = interpreter->typed_output_tensor<float> (output_idx)[j];
-            }
+            std::copy (tensor, tensor + kHarmonicsSize, output.harmonics.begin());
         }
         else if (outputName == getNoiseAmpsOutputName (modelInfo))
         {
-            for (size_t j = 0; j < kNoiseAmpsSize; j++)
-            {
-                output.noiseAmps[j] = interpreter->typed_output_tensor<float> (output_idx)[j];
-            }
+            std::copy (tensor, tensor + kNoiseAmpsSize, output.noiseAmps.begin());
         }
         else if (outputName == getStateOutputName (modelInfo))
         {
-            for (size_t j = 0; j < gruState.size(); j++)
-            {
-                gruState[j] = interpreter->typed_output_tensor<float> (output_idx)[j];
-            }
+            std::copy (tensor, tensor + kGruModelStateSize, request.state->begin());
         }
         else
         {
@@ -172,7 +191,7 @@ void PredictControlsModel::call (const AudioFeatures& input, SynthesisControls&
         }
     }
 
-    output.f0_hz = input.f0_hz;
+    output.f0_hz = request.input->f0_hz;
 }
 
 void PredictControlsModel::reset()
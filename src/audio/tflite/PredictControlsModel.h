@@ -17,6 +17,8 @@ limitations under the License.
 #pragma once
 
 #include <array>
+#include <memory>
+#include <mutex>
 
 #include "audio/tflite/ModelBase.h"
 #include "audio/tflite/ModelLibrary.h"
@@ -30,9 +32,37 @@ namespace ddsp
 class PredictControlsModel : public ModelBase<AudioFeatures, SynthesisControls>
 {
 public:
-    PredictControlsModel (const ModelInfo& mi);
+    // GRU state of one stream of hops through the model.
+    using State = std::array<float, kGruModelStateSize>;
 
+    // A hop of one stream: its features, the state it updates and the controls it predicts.
+    struct Request
+    {
+        const AudioFeatures* input = nullptr;
+        State* state = nullptr;
+        SynthesisControls* output = nullptr;
+    };
+
+    // Most requests run through the model in one invocation. The model holds an interpreter for every
+    // power of two up to this many.
+    static constexpr int kMaxBatchSize = 16;
+
+    // Batches hold up to `maxBatchSize` requests, rounded down to a power of two.
+    PredictControlsModel (const ModelInfo& mi, int maxBatchSize = kMaxBatchSize);
+
+    // Returns the model for `mi` that every instance playing it shares, loading it unless one still is.
+    static std::shared_ptr<PredictControlsModel> getShared (const ModelInfo& mi);
+
+    // Predicts with the model's own state.
     void call (const AudioFeatures& input, SynthesisControls& output) override;
+    // Predicts a hop of each of `numRequests` streams, in a single invocation if the model takes a batch
+    // dimension and one at a time if it does not. Never reshapes or allocates tensors. Safe to call
+    // from several threads, but waits while another one runs the model.
+    void callBatch (const Request* requests, int numRequests);
+    // Predicts like callBatch() unless another thread is running the model, in which case it returns
+    // false without waiting and without predicting anything.
+    bool tryCallBatch (const Request* requests, int numRequests);
+    // Clears the model's own state.
     void reset();
 
     // Metadata for UI rendering.
@@ -63,13 +93,21 @@ public:
     static std::string_view getStateOutputName                      (const ModelInfo& modelInfo);
 
     // GRU model state.
-    std::array<float, kGruModelStateSize> gruState;
+    State gruState;
 
     ModelInfo modelInfo;
 
 
     std::mt19937 gen;
     std::uniform_real_distribution<float> dis;
+
+private:
+    void invokeBatches (const Request* requests, int numRequests);
+    void fillInputs (tflite::Interpreter& batch, int index, const Request& request);
+    void readOutputs (tflite::Interpreter& batch, int index, const Request& request);
+
+    // Held while the interpreter runs; instances sharing the model may predict from different workers.
+    std::mutex invokeMutex;
 };
 
 } // namespace ddsp
@@ -16,6 +16,18 @@ limitations under the License.
 
 #include "ui/ParamInfo.h"
 
+namespace
+{
+// Changing the latency mode rebuilds the pipeline, which cannot follow automation.
+class LatencyModeParameter : public juce::AudioParameterChoice
+{
+public:
+    using AudioParameterChoice::AudioParameterChoice;
+
+    bool isAutomatable() const override { return false; }
+};
+} // namespace
+
 std::map<juce::String, std::vector<ParamInfo>> getSliderParamsInfo()
 {
     static const std::map<juce::String, std::vector<ParamInfo>> ret = {
@@ -41,12 +53,20 @@ std::map<juce::String, std::vector<ParamInfo>> getSliderParamsInfo()
     return ret;
 }
 
-juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
+juce::AudioProcessorValueTreeState::ParameterLayout
+    createParameterLayout (std::function<juce::String (int mode, int maximumStringLength)> latencyModeLabel)
 {
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
     layout.add (std::make_unique<juce::AudioParameterFloat> ("InputGain", "Input Gain", -0.5f, 0.5f, 0.0f));
     layout.add (std::make_unique<juce::AudioParameterFloat> ("InputPitch", "Input Pitch", -0.5f, 0.5f, 0.0f));
+    // Indexes ddsp::LatencyMode.
+    layout.add (std::make_unique<LatencyModeParameter> ("LatencyMode",
+                                                        "Latency",
+                                                        juce::StringArray { "Standard", "Low", "Lowest" },
+                                                        0,
+                                                        juce::String(),
+                                                        std::move (latencyModeLabel)));
 
     // Scene-related params.
     const auto paramInfos = getSliderParamsInfo();
@@ -34,5 +34,7 @@ struct ParamInfo
 
 std::map<juce::String, std::vector<ParamInfo>> getSliderParamsInfo();
 
-// Creates and adds AudioProcessor params to the value tree state.
-juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+// Creates and adds AudioProcessor params to the value tree state. `latencyModeLabel` shows each latency
+// mode, as the latency it would give the plugin.
+juce::AudioProcessorValueTreeState::ParameterLayout
+    createParameterLayout (std::function<juce::String (int mode, int maximumStringLength)> latencyModeLabel);
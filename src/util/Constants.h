@@ -21,7 +21,7 @@ limitations under the License.
 namespace ddsp
 {
 
-// If true, model inference is carried out on the audio thread instead of the timer thread.
+// If true, model inference is carried out on the audio thread instead of the inference worker thread.
 constexpr bool kInferenceOnAudioThread = false;
 constexpr bool kEnableReverb = true;
 
@@ -54,7 +54,8 @@ constexpr int kNumPredictControlsInputTensors = 3;
 constexpr int kNumPredictControlsInputTensors_MIDI_DDSP = 8;
 constexpr int kNumPredictControlsOutputTensors = 4;
 constexpr int kNumPredictControlsOutputTensors_MIDI_DDSP = 4;
-constexpr int kNumFeatureExtractionThreads = 4;
+// The shared inference workers run the instances in parallel, so each interpreter keeps to its caller's thread.
+constexpr int kNumFeatureExtractionThreads = 1;
 constexpr int kNumPredictControlsThreads = 1;
 constexpr int kNoiseAmpsSize = 65;
 constexpr int kHarmonicsSize = 60;
@@ -66,10 +67,12 @@ constexpr int kGruModelStateSize = 512;
 
 // The models were trained at 16 kHz sample rate.
 constexpr float kModelSampleRate_Hz = 16000.0f;
-constexpr float kModelInferenceTimerCallbackInterval_ms = 20.0f;
-constexpr float kTotalInferenceLatency_ms = 64.0f;
+// Output the inference worker keeps buffered beyond a host block, to absorb its wake-up and compute time.
+constexpr float kInferenceWorkerHeadroom_ms = 10.0f;
 constexpr int kModelFrameSize = 1024;
 constexpr int kModelHopSize = 320;
+// Harmonics quieter than this for a whole hop are not synthesized.
+constexpr float kHarmonicCullingThreshold_dB = -96.0f;
 
 // URLs.
 inline constexpr std::string_view kModelTrainingColabUrl = "https://g.co/magenta/train-ddsp-vst";
@@ -0,0 +1,72 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <vector>
+
+#include "JuceHeader.h"
+
+namespace ddsp
+{
+
+// Marks a size that is only known at construction time, like std::dynamic_extent.
+constexpr int kDynamicExtent = -1;
+
+// A size that is either fixed at compile time or set at construction. The fixed version holds no
+// value and converts to a constant, so loops bounded by it get fixed trip counts.
+template <int StaticExtent>
+class Extent
+{
+public:
+    static_assert (StaticExtent > 0, "A static extent must be positive.");
+
+    explicit Extent (int size) { jassertquiet (size == StaticExtent); }
+    constexpr operator int() const { return StaticExtent; }
+};
+
+template <>
+class Extent<kDynamicExtent>
+{
+public:
+    constexpr explicit Extent (int s) : size (s) {}
+    constexpr operator int() const { return size; }
+
+private:
+    int size;
+};
+
+// std::array for a static extent and std::vector for a dynamic one.
+template <typename T, int StaticExtent>
+using ExtentBuffer = std::conditional_t<StaticExtent == kDynamicExtent, std::vector<T>, std::array<T, StaticExtent>>;
+
+// Sizes a dynamic buffer; a static buffer already has its size and is only cleared.
+template <typename T>
+void resizeBuffer (std::vector<T>& buffer, int size)
+{
+    buffer.assign (size, T {});
+}
+
+template <typename T, size_t N>
+void resizeBuffer (std::array<T, N>& buffer, int size)
+{
+    jassertquiet (size == static_cast<int> (N));
+    buffer.fill (T {});
+}
+
+} // namespace ddsp
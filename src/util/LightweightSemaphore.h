@@ -0,0 +1,116 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+
+#include "JuceHeader.h"
+
+#if JUCE_MAC || JUCE_IOS
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore>
+#endif
+
+namespace ddsp
+{
+
+// The OS semaphore LightweightSemaphore sleeps on. std::counting_semaphore needs macOS 11, so Apple
+// platforms use a dispatch semaphore, which the deployment target of 10.14 has.
+class OSSemaphore
+{
+public:
+#if JUCE_MAC || JUCE_IOS
+    OSSemaphore() : semaphore (dispatch_semaphore_create (0)) {}
+    ~OSSemaphore() { dispatch_release (semaphore); }
+
+    void release (int n)
+    {
+        for (int i = 0; i < n; ++i)
+            dispatch_semaphore_signal (semaphore);
+    }
+
+    void acquire() { dispatch_semaphore_wait (semaphore, DISPATCH_TIME_FOREVER); }
+
+private:
+    dispatch_semaphore_t semaphore;
+#else
+    OSSemaphore() = default;
+
+    void release (int n) { semaphore.release (n); }
+    void acquire() { semaphore.acquire(); }
+
+private:
+    std::counting_semaphore<> semaphore { 0 };
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE (OSSemaphore)
+};
+
+// Counting semaphore that only involves the OS when a waiter actually has to sleep. The count lives
+// in an atomic; signal() is a single fetch_add unless a thread is blocked in wait(), and wait() spins
+// briefly on the count before it blocks. Suitable for waking a worker from the audio thread.
+class LightweightSemaphore
+{
+public:
+    explicit LightweightSemaphore (int initialCount = 0) : count (initialCount) { jassert (initialCount >= 0); }
+
+    // Adds `n` to the count, waking up to `n` blocked waiters.
+    void signal (int n = 1)
+    {
+        const int previous = count.fetch_add (n, std::memory_order_release);
+        const int numToWake = std::min (-previous, n);
+        if (numToWake > 0)
+            semaphore.release (numToWake);
+    }
+
+    // Takes one from the count if it is positive. Never blocks.
+    bool tryWait()
+    {
+        int current = count.load (std::memory_order_relaxed);
+        while (current > 0)
+        {
+            if (count.compare_exchange_weak (current, current - 1, std::memory_order_acquire))
+                return true;
+        }
+        return false;
+    }
+
+    // Takes one from the count, blocking until a signal() when it is not positive.
+    void wait()
+    {
+        for (int i = 0; i < kNumSpins; ++i)
+        {
+            if (tryWait())
+                return;
+        }
+
+        if (count.fetch_sub (1, std::memory_order_acquire) <= 0)
+            semaphore.acquire();
+    }
+
+    // Negative while threads are blocked in wait().
+    int getCount() const { return count.load (std::memory_order_relaxed); }
+
+private:
+    static constexpr int kNumSpins = 1000;
+
+    std::atomic<int> count;
+    OSSemaphore semaphore;
+};
+
+} // namespace ddsp
@@ -0,0 +1,49 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+
+namespace ddsp
+{
+
+// Lock-free hand-over of one value at a time from a producer to a consumer. The value is written and
+// read in place, so nothing is copied on the way. The producer and the consumer may each move between
+// threads as long as their own calls never overlap.
+template <typename T>
+class SingleSlotQueue
+{
+public:
+    // The slot to write to, or nullptr while it holds a value that has not been read. Producer only.
+    T* prepareToWrite() { return full.load (std::memory_order_acquire) ? nullptr : &value; }
+    // Hands the value written over to the consumer. Producer only.
+    void finishedWrite() { full.store (true, std::memory_order_release); }
+
+    // The value to read, or nullptr while there is none. Consumer only.
+    const T* prepareToRead() const { return full.load (std::memory_order_acquire) ? &value : nullptr; }
+    // Frees the slot for the next value. Consumer only.
+    void finishedRead() { full.store (false, std::memory_order_release); }
+
+    // Drops a value that has not been read. Only while neither side runs.
+    void reset() { full.store (false); }
+
+private:
+    T value {};
+    std::atomic<bool> full = { false };
+};
+
+} // namespace ddsp
@@ -0,0 +1,175 @@
+#include <thread>
+
+#include "audio/AudioRingBuffer.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+juce::AudioBuffer<float> ramp (int numChannels, int numSamples, float start)
+{
+    juce::AudioBuffer<float> buffer (numChannels, numSamples);
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numSamples; ++i)
+            buffer.setSample (channel, i, start + i + 1000.f * channel);
+    return buffer;
+}
+
+} // namespace
+
+TEST (AudioRingBufferTest, ViewsWrapAroundTheEnd)
+{
+    ddsp::AudioRingBuffer ring (2, 10);
+    EXPECT_EQ (ring.push (ramp (2, 7, 0.f)), 7);
+    ring.finishedRead (6);
+
+    // Eight samples starting at index 7 of the storage: three to the end, five from the start.
+    EXPECT_EQ (ring.push (ramp (2, 8, 7.f)), 8);
+    const auto view = ring.prepareToRead (9);
+    ASSERT_EQ (view.getNumSamples(), 9);
+    EXPECT_FALSE (view.isContiguous());
+    EXPECT_EQ (view.getFirstBlock (1).size(), 4u);
+    EXPECT_EQ (view.getSecondBlock (1).size(), 5u);
+    EXPECT_EQ (view.getFirstBlock (1)[0], 1006.f);
+    EXPECT_EQ (view.getSecondBlock (1)[4], 1014.f);
+
+    juce::AudioBuffer<float> output (2, 9);
+    EXPECT_EQ (ring.read (output), 9);
+    for (int i = 0; i < 9; ++i)
+        EXPECT_EQ (output.getSample (0, i), 6.f + i);
+    EXPECT_EQ (ring.getNumReady(), 0);
+}
+
+TEST (AudioRingBufferTest, ReadsAtAnOffset)
+{
+    ddsp::AudioRingBuffer ring (1, 10);
+    ring.push (ramp (1, 7, 0.f));
+    ring.finishedRead (6);
+    ring.push (ramp (1, 8, 7.f));
+
+    // Samples 8 to 11 sit at the end and the start of the storage.
+    const auto view = ring.prepareToRead (4, 2);
+    ASSERT_EQ (view.getNumSamples(), 4);
+    EXPECT_EQ (view.getFirstBlock (0).size(), 2u);
+    EXPECT_EQ (view.getFirstBlock (0)[0], 8.f);
+    EXPECT_EQ (view.getSecondBlock (0)[1], 11.f);
+
+    // Only what is ready beyond the offset.
+    EXPECT_EQ (ring.prepareToRead (10, 7).getNumSamples(), 2);
+    EXPECT_EQ (ring.prepareToRead (10, 12).getNumSamples(), 0);
+    EXPECT_EQ (ring.getNumReady(), 9);
+}
+
+TEST (AudioRingBufferTest, WritesInPlace)
+{
+    ddsp::AudioRingBuffer ring (1, 8);
+    auto view = ring.prepareToWrite (5);
+    ASSERT_EQ (view.getNumSamples(), 5);
+    std::ranges::fill (view.getFirstBlock (0), 0.5f);
+    EXPECT_EQ (ring.getNumReady(), 0);
+
+    ring.finishedWrite (5);
+    EXPECT_EQ (ring.getNumReady(), 5);
+    EXPECT_EQ (ring.getFreeSpace(), 3);
+    EXPECT_EQ (ring.prepareToRead (5).getFirstBlock (0)[4], 0.5f);
+}
+
+TEST (AudioRingBufferTest, CountsOverflowsAndUnderflows)
+{
+    ddsp::AudioRingBuffer ring (1, 8);
+    EXPECT_EQ (ring.push (ramp (1, 6, 0.f)), 6);
+    EXPECT_EQ (ring.push (ramp (1, 6, 6.f)), 2);
+    EXPECT_EQ (ring.getNumOverflows(), 1);
+    EXPECT_EQ (ring.getFreeSpace(), 0);
+
+    juce::AudioBuffer<float> output (1, 10);
+    output.applyGain (0.f);
+    EXPECT_EQ (ring.read (output), 8);
+    EXPECT_EQ (ring.getNumUnderflows(), 1);
+    EXPECT_EQ (output.getSample (0, 7), 7.f);
+    EXPECT_EQ (output.getSample (0, 9), 0.f);
+
+    ring.reset();
+    EXPECT_EQ (ring.getNumOverflows(), 0);
+    EXPECT_EQ (ring.getNumUnderflows(), 0);
+}
+
+TEST (AudioRingBufferTest, ReadSkippingCrossfadesOverDroppedSamples)
+{
+    ddsp::AudioRingBuffer ring (1, 16);
+    ring.push (ramp (1, 5, 0.f));
+    ring.finishedRead (5);
+    // Twelve samples 100, 101, ... that wrap around the end of the storage.
+    ring.push (ramp (1, 12, 100.f));
+
+    juce::AudioBuffer<float> output (1, 4);
+    EXPECT_EQ (ring.readSkipping (output, 6, 3), 6);
+    // Fades from 100, 101, 102 towards 106, 107, 108 in steps of a quarter, then continues after the skip.
+    EXPECT_FLOAT_EQ (output.getSample (0, 0), 101.5f);
+    EXPECT_FLOAT_EQ (output.getSample (0, 1), 104.f);
+    EXPECT_FLOAT_EQ (output.getSample (0, 2), 106.5f);
+    EXPECT_FLOAT_EQ (output.getSample (0, 3), 109.f);
+    EXPECT_EQ (ring.getNumReady(), 2);
+
+    // Never drops into the samples the read itself needs.
+    EXPECT_EQ (ring.readSkipping (output, 6, 3), 0);
+    EXPECT_EQ (ring.getNumUnderflows(), 1);
+    EXPECT_EQ (output.getSample (0, 0), 110.f);
+}
+
+TEST (AudioRingBufferTest, CapacityCoversBlocksAndLatency)
+{
+    EXPECT_EQ (ddsp::AudioRingBuffer::capacityFor (512, 2000), 3024);
+}
+
+// A producer and a consumer thread pass a counting sequence through a small ring in uneven blocks.
+TEST (AudioRingBufferTest, PassesAudioBetweenThreads)
+{
+    constexpr int numSamples = 1 << 18;
+    ddsp::AudioRingBuffer ring (2, 257);
+
+    std::thread producer (
+        [&]
+        {
+            int next = 0;
+            juce::Random random (1);
+            while (next < numSamples)
+            {
+                const auto view = ring.prepareToWrite (std::min (1 + random.nextInt (100), numSamples - next));
+                if (view.getNumSamples() == 0)
+                    std::this_thread::yield();
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    int value = next;
+                    for (auto& sample : view.getFirstBlock (channel))
+                        sample = static_cast<float> (value++ % 65536);
+                    for (auto& sample : view.getSecondBlock (channel))
+                        sample = static_cast<float> (value++ % 65536);
+                }
+                ring.finishedWrite (view.getNumSamples());
+                next += view.getNumSamples();
+            }
+        });
+
+    int expected = 0;
+    bool inOrder = true;
+    juce::Random random (2);
+    while (expected < numSamples)
+    {
+        const auto view = ring.prepareToRead (1 + random.nextInt (100));
+        if (view.getNumSamples() == 0)
+            std::this_thread::yield();
+        int value = expected;
+        for (auto sample : view.getFirstBlock (1))
+            inOrder = inOrder && sample == static_cast<float> (value++ % 65536);
+        for (auto sample : view.getSecondBlock (1))
+            inOrder = inOrder && sample == static_cast<float> (value++ % 65536);
+        ring.finishedRead (view.getNumSamples());
+        expected += view.getNumSamples();
+    }
+
+    producer.join();
+    EXPECT_TRUE (inOrder);
+    EXPECT_EQ (ring.getNumReady(), 0);
+}
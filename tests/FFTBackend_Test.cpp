@@ -0,0 +1,123 @@
+#include "audio/FFTBackend.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+const ddsp::FFTBackend kBackends[] = { ddsp::FFTBackend::kJuce, ddsp::FFTBackend::kRadix2 };
+
+const char* backendName (ddsp::FFTBackend backend)
+{
+    return backend == ddsp::FFTBackend::kJuce ? "JUCE" : "radix-2";
+}
+
+} // namespace
+
+TEST (FFTBackendTest, ForwardTransformMatchesDFT)
+{
+    for (const auto backend : kBackends)
+    {
+        for (int order = 2; order <= 11; ++order)
+        {
+            auto fft = ddsp::createFFT (order, backend);
+            const int size = fft->getSize();
+            ASSERT_EQ (size, 1 << order);
+
+            juce::Random random (order);
+            std::vector<float> input (size), buffer (2 * size, 0.f);
+            for (auto& sample : input)
+                sample = random.nextFloat() * 2.f - 1.f;
+            std::copy (input.begin(), input.end(), buffer.begin());
+            fft->performRealOnlyForwardTransform (buffer.data());
+
+            double largestError = 0.0;
+            for (int k = 0; k <= size / 2; ++k)
+            {
+                std::complex<double> expected;
+                for (int n = 0; n < size; ++n)
+                    expected += static_cast<double> (input[n])
+                                * std::polar (1.0, -juce::MathConstants<double>::twoPi * k * n / size);
+                const std::complex<double> bin (buffer[2 * k], buffer[2 * k + 1]);
+                largestError = std::max (largestError, std::abs (bin - expected));
+            }
+
+            // Rounding grows with log2 (size) on bins of magnitude around sqrt (size).
+            EXPECT_LT (largestError, 1e-5 * size) << backendName (backend) << ", order " << order;
+        }
+    }
+}
+
+TEST (FFTBackendTest, InverseTransformRestoresInput)
+{
+    for (const auto backend : kBackends)
+    {
+        for (int order = 2; order <= 11; ++order)
+        {
+            auto fft = ddsp::createFFT (order, backend);
+            const int size = fft->getSize();
+
+            juce::Random random (order);
+            std::vector<float> input (size), buffer (2 * size, 0.f);
+            for (auto& sample : input)
+                sample = random.nextFloat() * 2.f - 1.f;
+            std::copy (input.begin(), input.end(), buffer.begin());
+
+            fft->performRealOnlyForwardTransform (buffer.data());
+            fft->performRealOnlyInverseTransform (buffer.data());
+
+            for (int n = 0; n < size; ++n)
+                ASSERT_NEAR (buffer[n], input[n], 1e-5f) << backendName (backend) << ", order " << order;
+        }
+    }
+}
+
+TEST (FFTBackendTest, BackendsAgree)
+{
+    constexpr int order = 9;
+    auto juceFFT = ddsp::createFFT (order, ddsp::FFTBackend::kJuce);
+    auto radix2FFT = ddsp::createFFT (order, ddsp::FFTBackend::kRadix2);
+
+    juce::Random random (3);
+    std::vector<float> a (2 << order, 0.f);
+    for (int n = 0; n < (1 << order); ++n)
+        a[n] = random.nextFloat() - 0.5f;
+    auto b = a;
+
+    juceFFT->performRealOnlyForwardTransform (a.data());
+    radix2FFT->performRealOnlyForwardTransform (b.data());
+    for (int i = 0; i < (1 << order) + 2; ++i)
+        EXPECT_NEAR (a[i], b[i], 1e-4f) << i;
+}
+
+TEST (FFTBackendTest, SpectrumKernelsMatchComplexArithmetic)
+{
+    constexpr int numBins = 257;
+    juce::Random random (5);
+    std::vector<std::complex<float>> a (numBins), b (numBins), product (numBins), accumulated (numBins);
+    for (int i = 0; i < numBins; ++i)
+    {
+        a[i] = { random.nextFloat() - 0.5f, random.nextFloat() - 0.5f };
+        b[i] = { random.nextFloat() - 0.5f, random.nextFloat() - 0.5f };
+        accumulated[i] = { random.nextFloat() - 0.5f, random.nextFloat() - 0.5f };
+    }
+    const auto initial = accumulated;
+
+    ddsp::multiplySpectra (product.data(), a.data(), b.data(), numBins);
+    ddsp::multiplyAccumulateSpectra (accumulated.data(), a.data(), b.data(), numBins);
+    for (int i = 0; i < numBins; ++i)
+    {
+        EXPECT_NEAR (std::abs (product[i] - a[i] * b[i]), 0.f, 1e-6f);
+        EXPECT_NEAR (std::abs (accumulated[i] - (initial[i] + a[i] * b[i])), 0.f, 1e-6f);
+    }
+
+    // In place, as NoiseSynthesizer filters its noise.
+    ddsp::multiplySpectra (a.data(), a.data(), b.data(), numBins);
+    EXPECT_EQ (a, product);
+}
+
+TEST (FFTBackendTest, PicksFastestBackendOnce)
+{
+    const auto fastest = ddsp::getFastestFFTBackend();
+    EXPECT_EQ (ddsp::getFastestFFTBackend(), fastest);
+}
@@ -0,0 +1,57 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "audio/FillLevelController.h"
+
+#include <gtest/gtest.h>
+
+TEST (FillLevelControllerTest, LeavesLevelAtTargetAlone)
+{
+    ddsp::FillLevelController controller;
+    controller.prepare (/*targetLevel=*/600, /*windowSize=*/4096, /*tolerance=*/100);
+
+    // A sawtooth whose troughs sit on the target, within the tolerance above it.
+    for (int block = 0; block < 100; ++block)
+        EXPECT_EQ (controller.update (650 + (block % 4) * 256, 512), 0);
+    EXPECT_EQ (controller.getNumSamplesDropped(), 0);
+}
+
+TEST (FillLevelControllerTest, DropsExcessOncePerWindow)
+{
+    ddsp::FillLevelController controller;
+    controller.prepare (/*targetLevel=*/600, /*windowSize=*/2048, /*tolerance=*/100);
+
+    // Three reads into the window nothing happens; the fourth ends it with the trough 400 too deep.
+    EXPECT_EQ (controller.update (1500, 512), 0);
+    EXPECT_EQ (controller.update (1000, 512), 0);
+    EXPECT_EQ (controller.update (1200, 512), 0);
+    EXPECT_EQ (controller.update (1100, 512), 400);
+
+    // Back at the target after the drop.
+    for (int block = 0; block < 4; ++block)
+        EXPECT_EQ (controller.update (600 + block * 50, 512), 0);
+    EXPECT_EQ (controller.getNumSamplesDropped(), 400);
+}
+
+TEST (FillLevelControllerTest, NeverDropsWhenShort)
+{
+    ddsp::FillLevelController controller;
+    controller.prepare (/*targetLevel=*/600, /*windowSize=*/1024, /*tolerance=*/0);
+
+    // A single shallow read in the window holds off the drop, however deep the others are.
+    EXPECT_EQ (controller.update (5000, 512), 0);
+    EXPECT_EQ (controller.update (300, 512), 0);
+    EXPECT_EQ (controller.getNumSamplesDropped(), 0);
+}
@@ -0,0 +1,315 @@
+#include <memory>
+
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/OscillatorBank.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+// Ratio of reference energy to error energy in dB.
+double signalToNoiseRatio_dB (const std::vector<double>& reference, const std::vector<float>& signal)
+{
+    double signalEnergy = 0.0, noiseEnergy = 0.0;
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        signalEnergy += reference[i] * reference[i];
+        noiseEnergy += (signal[i] - reference[i]) * (signal[i] - reference[i]);
+    }
+    return 10.0 * std::log10 (signalEnergy / std::max (noiseEnergy, 1e-30));
+}
+
+struct OscillatorBankFixture
+{
+    OscillatorBankFixture (int nh, int nos) : numHarmonics (nh), numSamples (nos)
+    {
+        juce::Random random (1234);
+        phases.resize (numSamples);
+        amplitudes.resize (numHarmonics * numSamples);
+        output.resize (numSamples);
+        activeHarmonics.resize (numHarmonics);
+        std::iota (activeHarmonics.begin(), activeHarmonics.end(), 0);
+
+        // A 440 Hz glide at 16 kHz that has already accumulated a few seconds of phase.
+        float phase = 1000.f;
+        for (auto& p : phases)
+        {
+            phase += juce::MathConstants<float>::twoPi * 440.f / ddsp::kModelSampleRate_Hz;
+            p = phase;
+        }
+        for (int j = 0; j < numHarmonics; ++j)
+        {
+            const float level = random.nextFloat() / static_cast<float> (numHarmonics);
+            std::fill (amplitudes.begin() + j * numSamples, amplitudes.begin() + (j + 1) * numSamples, level);
+        }
+    }
+
+    void process (ddsp::OscillatorBank& bank)
+    {
+        bank.process (phases.data(),
+                      amplitudes.data(),
+                      numSamples,
+                      activeHarmonics.data(),
+                      static_cast<int> (activeHarmonics.size()),
+                      output.data(),
+                      numSamples);
+    }
+
+    float amplitude (int harmonic, int sample) const { return amplitudes[harmonic * numSamples + sample]; }
+
+    int numHarmonics, numSamples;
+    std::vector<float> phases, amplitudes, output;
+    std::vector<int> activeHarmonics;
+};
+
+} // namespace
+
+TEST (OscillatorBankTest, MatchesDoublePrecisionReference)
+{
+    OscillatorBankFixture fixture (ddsp::kHarmonicsSize, ddsp::kModelHopSize);
+    ddsp::OscillatorBank bank;
+    fixture.process (bank);
+
+    std::vector<double> reference (fixture.numSamples, 0.0);
+    for (int i = 0; i < fixture.numSamples; ++i)
+        for (int j = 0; j < fixture.numHarmonics; ++j)
+            reference[i] += std::sin (static_cast<double> (fixture.phases[i]) * (j + 1)) * fixture.amplitude (j, i);
+
+    EXPECT_GT (signalToNoiseRatio_dB (reference, fixture.output), 100.0);
+}
+
+TEST (OscillatorBankTest, SkipsInactiveHarmonics)
+{
+    OscillatorBankFixture fixture (ddsp::kHarmonicsSize, ddsp::kModelHopSize);
+    fixture.activeHarmonics = { 0, 1, 4, 17, 18, 50, 59 };
+    ddsp::OscillatorBank bank;
+    fixture.process (bank);
+
+    std::vector<double> reference (fixture.numSamples, 0.0);
+    for (int i = 0; i < fixture.numSamples; ++i)
+        for (int j : fixture.activeHarmonics)
+            reference[i] += std::sin (static_cast<double> (fixture.phases[i]) * (j + 1)) * fixture.amplitude (j, i);
+
+    EXPECT_GT (signalToNoiseRatio_dB (reference, fixture.output), 100.0);
+}
+
+TEST (HarmonicSynthesizerTest, RendersBoundedSteadyTone)
+{
+    ddsp::HarmonicSynthesizer synthesizer (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    std::vector<float> distribution (ddsp::kHarmonicsSize, 1.f);
+
+    float peak = 0.f;
+    for (int hop = 0; hop < 100; ++hop)
+    {
+        auto harmonics = distribution;
+        const auto& output = synthesizer.render (harmonics, 0.5f, 220.f);
+        for (auto sample : output)
+            peak = std::max (peak, std::abs (sample));
+    }
+
+    EXPECT_GT (peak, 0.f);
+    EXPECT_LE (peak, 0.5f + 1e-4f);
+}
+
+TEST (HarmonicSynthesizerTest, CullsHarmonicsAboveNyquistAndBelowThreshold)
+{
+    ddsp::HarmonicSynthesizer synthesizer (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+
+    // At 1 kHz only harmonics 1-7 are below the 8 kHz Nyquist frequency of the model.
+    std::vector<float> harmonics (ddsp::kHarmonicsSize, 1.f);
+    synthesizer.render (harmonics, 0.5f, 1000.f);
+    EXPECT_EQ (synthesizer.getNumActiveHarmonics(), 7);
+    EXPECT_EQ (synthesizer.getNumCulledHarmonics(), ddsp::kHarmonicsSize - 7);
+
+    // A low note with energy in only three harmonics; everything else is far below -96 dB.
+    synthesizer.reset();
+    for (int hop = 0; hop < 2; ++hop)
+    {
+        harmonics.assign (ddsp::kHarmonicsSize, 1e-9f);
+        harmonics[0] = harmonics[2] = harmonics[9] = 1.f;
+        synthesizer.render (harmonics, 0.5f, 55.f);
+    }
+    EXPECT_EQ (synthesizer.getNumActiveHarmonics(), 3);
+    EXPECT_EQ (synthesizer.getTotalCulledHarmonics(), 2 * (ddsp::kHarmonicsSize - 3));
+}
+
+TEST (HarmonicSynthesizerTest, WavetableModeMatchesOscillatorBank)
+{
+    ddsp::HarmonicSynthesizer oscillatorBank (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    ddsp::HarmonicSynthesizer wavetable (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    wavetable.setSynthesisMode (ddsp::HarmonicSynthesizer::SynthesisMode::kWavetable);
+    juce::Random random (5);
+
+    double signalEnergy = 0.0, noiseEnergy = 0.0;
+    for (int hop = 0; hop < 200; ++hop)
+    {
+        // Fresh random controls every hop, so the crossfade between tables is exercised as well.
+        std::vector<float> distribution (ddsp::kHarmonicsSize);
+        for (auto& value : distribution)
+            value = random.nextFloat();
+        const float f0 = 100.f + 200.f * random.nextFloat();
+
+        auto harmonics = distribution;
+        const auto& reference = oscillatorBank.render (harmonics, 0.5f, f0);
+        const auto& output = wavetable.render (distribution, 0.5f, f0);
+        for (int i = 0; i < ddsp::kModelHopSize; ++i)
+        {
+            signalEnergy += reference[i] * reference[i];
+            noiseEnergy += (output[i] - reference[i]) * (output[i] - reference[i]);
+        }
+    }
+
+    EXPECT_GT (10.0 * std::log10 (signalEnergy / noiseEnergy), 50.0);
+}
+
+TEST (HarmonicSynthesizerTest, SwitchingModesIsContinuous)
+{
+    ddsp::HarmonicSynthesizer synthesizer (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    std::vector<float> harmonics;
+
+    float lastSample = 0.f, largestStep = 0.f;
+    for (int hop = 0; hop < 40; ++hop)
+    {
+        synthesizer.setSynthesisMode ((hop / 5) % 2 == 0 ? ddsp::HarmonicSynthesizer::SynthesisMode::kOscillatorBank
+                                                         : ddsp::HarmonicSynthesizer::SynthesisMode::kWavetable);
+        harmonics.assign (ddsp::kHarmonicsSize, 0.f);
+        harmonics[0] = 1.f;
+        for (auto sample : synthesizer.render (harmonics, 0.5f, 100.f))
+        {
+            largestStep = std::max (largestStep, std::abs (sample - lastSample));
+            lastSample = sample;
+        }
+    }
+
+    // A 100 Hz sine of amplitude 0.5 at 16 kHz moves by at most 0.5 * 2 * pi * 100 / 16000 per sample.
+    EXPECT_LT (largestStep, 0.5f * juce::MathConstants<float>::twoPi * 100.f / ddsp::kModelSampleRate_Hz + 1e-3f);
+}
+
+TEST (HarmonicSynthesizerTest, StaticExtentsMatchDynamicExtents)
+{
+    ddsp::HarmonicSynthesizer dynamicSynthesizer (
+        ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    ddsp::StaticHarmonicSynthesizer staticSynthesizer (
+        ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    juce::Random random (9);
+
+    for (int hop = 0; hop < 50; ++hop)
+    {
+        std::vector<float> distribution (ddsp::kHarmonicsSize);
+        for (auto& value : distribution)
+            value = random.nextFloat();
+        auto harmonics = distribution;
+        const float f0 = 100.f + 400.f * random.nextFloat();
+
+        const auto expected = dynamicSynthesizer.render (distribution, 0.5f, f0);
+        const auto output = staticSynthesizer.render (harmonics, 0.5f, f0);
+        ASSERT_EQ (output.size(), expected.size());
+        for (size_t i = 0; i < output.size(); ++i)
+            ASSERT_FLOAT_EQ (output[i], expected[i]);
+    }
+}
+
+TEST (HarmonicSynthesizerTest, RendersAtHostRateWithModelNyquistCut)
+{
+    constexpr float sampleRate = 48000.f;
+    constexpr int hopSize = 960;
+    ddsp::HostRateHarmonicSynthesizer synthesizer (ddsp::kHarmonicsSize, hopSize, sampleRate);
+
+    // Harmonics above the 8 kHz Nyquist frequency of the model stay out at the host rate.
+    std::vector<float> harmonics (ddsp::kHarmonicsSize, 1.f);
+    synthesizer.render (harmonics, 0.5f, 1000.f);
+    EXPECT_EQ (synthesizer.getNumActiveHarmonics(), 7);
+
+    // A 440 Hz fundamental has 440 rising zero crossings per second at any rate.
+    synthesizer.reset();
+    int risingZeroCrossings = 0;
+    float lastSample = 0.f;
+    for (int hop = 0; hop < 50; ++hop)
+    {
+        harmonics.assign (ddsp::kHarmonicsSize, 0.f);
+        harmonics[0] = 1.f;
+        for (auto sample : synthesizer.render (harmonics, 0.5f, 440.f))
+        {
+            if (hop > 0 && lastSample < 0.f && sample >= 0.f)
+                ++risingZeroCrossings;
+            lastSample = sample;
+        }
+    }
+    EXPECT_NEAR (risingZeroCrossings, 440 * 49 * hopSize / sampleRate, 1.0);
+}
+
+TEST (HarmonicSynthesizerTest, StaysInPhaseForTenMinutes)
+{
+    constexpr int frequency_Hz = 443;
+    constexpr int numHops = static_cast<int> (10 * 60 * ddsp::kModelSampleRate_Hz) / ddsp::kModelHopSize;
+    constexpr int sampleRate = static_cast<int> (ddsp::kModelSampleRate_Hz);
+    auto synthesizer = std::make_unique<ddsp::StaticHarmonicSynthesizer> (
+        ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+
+    std::vector<float> harmonics;
+    std::span<const float> output;
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        harmonics.assign (ddsp::kHarmonicsSize, 1.f);
+        output = synthesizer->render (harmonics, 0.5f, static_cast<float> (frequency_Hz));
+    }
+
+    // Harmonics 1-18 are below Nyquist and share the amplitude equally. The first hop glides up
+    // from 0 Hz over its first half, which delays the phase by 80.5 samples; in half samples,
+    // sample i of the last hop is at 2 * (hop * size + i + 1) - 161.
+    const int numAudible = (sampleRate / 2 - 1) / frequency_Hz;
+    std::vector<double> reference (ddsp::kModelHopSize, 0.0);
+    for (int i = 0; i < ddsp::kModelHopSize; ++i)
+    {
+        const juce::int64 sample = static_cast<juce::int64> (numHops - 1) * ddsp::kModelHopSize + i + 1;
+        const juce::int64 halfSamples = 2 * sample - 161;
+        const auto halfCycles = (frequency_Hz * halfSamples) % (2 * sampleRate);
+        const double phase = juce::MathConstants<double>::twoPi * static_cast<double> (halfCycles) / (2 * sampleRate);
+        for (int k = 1; k <= numAudible; ++k)
+            reference[i] += 0.5 / numAudible * std::sin (k * phase);
+    }
+
+    EXPECT_GT (signalToNoiseRatio_dB (reference, std::vector<float> (output.begin(), output.end())), 80.0);
+}
+
+TEST (HarmonicSynthesizerTest, RenderFramesMatchesSequentialRenders)
+{
+    constexpr int numFrames = 9, hopSize = 882;
+    constexpr float sampleRate = 44100.f;
+
+    std::vector<ddsp::SynthesisControls> frames (numFrames);
+    juce::Random random (11);
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        frames[frame].amplitude = 0.1f + 0.5f * random.nextFloat();
+        frames[frame].f0_hz = 100.f + 20.f * frame;
+        for (auto& value : frames[frame].harmonics)
+            value = random.nextFloat();
+    }
+    const auto originalHarmonics = frames[0].harmonics;
+
+    for (const auto mode : { ddsp::HarmonicSynthesisMode::kOscillatorBank, ddsp::HarmonicSynthesisMode::kWavetable })
+    {
+        ddsp::HostRateHarmonicSynthesizer sequential (ddsp::kHarmonicsSize, hopSize, sampleRate);
+        ddsp::HostRateHarmonicSynthesizer batched (ddsp::kHarmonicsSize, hopSize, sampleRate);
+        sequential.setSynthesisMode (mode);
+        batched.setSynthesisMode (mode);
+
+        std::vector<float> expected;
+        for (const auto& frame : frames)
+        {
+            auto harmonics = frame.harmonics;
+            const auto hop = sequential.render (harmonics, frame.amplitude, frame.f0_hz);
+            expected.insert (expected.end(), hop.begin(), hop.end());
+        }
+
+        std::vector<float> output (numFrames * hopSize);
+        batched.renderFrames (frames.data(), numFrames, output.data());
+        EXPECT_EQ (output, expected);
+    }
+
+    // render() normalizes its input in place; renderFrames() leaves the frames as they were.
+    EXPECT_EQ (frames[0].harmonics, originalHarmonics);
+}
@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "PluginProcessor.h"
+#include "audio/tflite/InferenceScheduler.h"
+#include "audio/tflite/ModelLibrary.h"
+#include "audio/tflite/PredictControlsModel.h"
+#include "util/InputUtils.h"
 
 #include <gtest/gtest.h>
 
@@ -83,3 +93,332 @@ TEST (EndToEndTest, Render)
 
     transportSource.releaseResources();
 }
+
+TEST (EndToEndTest, ReportsLatencyOfEachMode)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    DDSPAudioProcessor processor (/*singleThreaded=*/true);
+    auto* latencyMode =
+        dynamic_cast<juce::AudioParameterChoice*> (processor.getValueTree().getParameter ("LatencyMode"));
+    ASSERT_NE (latencyMode, nullptr);
+
+    // The group delay of the input resampler, the analysis frame at the host rate, 1024, 512 and 256
+    // samples at 16 kHz, and the group delay of the noise filter, half of its 512-tap impulse response
+    // at 48 kHz.
+    const ddsp::PolyphaseResampler resampler (sampleRate, ddsp::kModelSampleRate_Hz);
+    const int resamplerLatency = juce::roundToInt (resampler.getLatencyInInputSamples());
+    EXPECT_GT (resamplerLatency, 0);
+    const int expectedLatencies[] = { 3072 + 256, 1536 + 256, 768 + 256 };
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        *latencyMode = mode;
+        processor.prepareToPlay (sampleRate, blockSize);
+        EXPECT_EQ (processor.getLatencySamples(), resamplerLatency + expectedLatencies[mode]);
+        processor.releaseResources();
+    }
+}
+
+TEST (EndToEndTest, PreparesAgainWhenTheLatencyModeChanges)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    DDSPAudioProcessor processor (/*singleThreaded=*/true);
+    auto* latencyMode =
+        dynamic_cast<juce::AudioParameterChoice*> (processor.getValueTree().getParameter ("LatencyMode"));
+    ASSERT_NE (latencyMode, nullptr);
+    EXPECT_FALSE (latencyMode->isAutomatable());
+    EXPECT_EQ (latencyMode->getCurrentValueAsText(), "Standard");
+
+    processor.prepareToPlay (sampleRate, blockSize);
+    const int standardLatency = processor.getLatencySamples();
+    const auto labelFor = [] (int latency) { return juce::String (juce::roundToInt (latency / 48.0)) + " ms"; };
+    EXPECT_EQ (latencyMode->getCurrentValueAsText(), labelFor (standardLatency));
+
+    // The lowest mode analyses a quarter of the standard frame, 768 samples at 48 kHz instead of 3072.
+    *latencyMode = 2;
+    EXPECT_EQ (processor.getLatencySamples(), standardLatency - 3072 + 768);
+    EXPECT_EQ (latencyMode->getCurrentValueAsText(), labelFor (processor.getLatencySamples()));
+    EXPECT_EQ (latencyMode->getText (0.f, 16), labelFor (standardLatency));
+    processor.releaseResources();
+}
+
+TEST (EndToEndTest, BouncesLikeStreaming)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int numBlocks = 400;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    DDSPAudioProcessor streaming (/*singleThreaded=*/true);
+    streaming.prepareToPlay (sampleRate, blockSize);
+
+    // Bouncing reuses the model that was loaded for playback.
+    DDSPAudioProcessor bouncing (/*singleThreaded=*/true);
+    bouncing.prepareToPlay (sampleRate, blockSize);
+    bouncing.setNonRealtime (true);
+    bouncing.prepareToPlay (sampleRate, blockSize);
+
+    // Bouncing takes no more latency than playback, so the host compensates both alike.
+    ASSERT_EQ (bouncing.getLatencySamples(), streaming.getLatencySamples());
+    const int numSamples = numBlocks * blockSize;
+
+    juce::AudioBuffer<float> streamed (1, numSamples);
+    juce::AudioBuffer<float> bounced (1, numSamples);
+    juce::AudioBuffer<float> block (1, blockSize);
+    juce::MidiBuffer midiBuffer;
+    const auto renderBlock = [&] (DDSPAudioProcessor& processor, juce::AudioBuffer<float>& output, int b) {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            const int n = b * blockSize + i;
+            const float tone =
+                0.3f * std::sin (juce::MathConstants<float>::twoPi * 220.0f * static_cast<float> (n / sampleRate));
+            block.setSample (0, i, tone);
+        }
+        processor.processBlock (block, midiBuffer);
+        output.copyFrom (0, b * blockSize, block, 0, 0, blockSize);
+    };
+
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        renderBlock (streaming, streamed, b);
+    }
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        renderBlock (bouncing, bounced, b);
+    }
+
+    // The batched render is the streamed one up to rounding in the models.
+    float maxDifference = 0.0f;
+    for (int n = 0; n < numSamples; ++n)
+    {
+        maxDifference = std::max (maxDifference, std::abs (bounced.getSample (0, n) - streamed.getSample (0, n)));
+    }
+    EXPECT_LT (maxDifference, 1e-3f);
+    EXPECT_GT (streamed.getMagnitude (0, 0, numSamples), 0.0f);
+    EXPECT_GT (bouncing.getOfflineRealTimeFactor(), 0.0);
+}
+
+TEST (InferencePipelineTest, RendersInStages)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 128;
+    constexpr double duration_s = 2.0;
+    constexpr int numBlocks = static_cast<int> (duration_s * sampleRate / blockSize);
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+    juce::SharedResourcePointer<ddsp::InferenceScheduler> scheduler;
+    if (scheduler->getNumWorkers() < 2)
+        GTEST_SKIP() << "Needs a second worker to run the stages on";
+
+    // For its parameters and models.
+    DDSPAudioProcessor processor (/*singleThreaded=*/true);
+    ddsp::InferencePipeline pipeline (processor.getValueTree());
+    // The tightest mode, which the stages are there to make room for.
+    pipeline.setLatencyMode (ddsp::LatencyMode::kLowest);
+    pipeline.prepareToPlay (sampleRate, blockSize);
+    pipeline.loadModel (processor.getModelLibrary().getModelList()[0]);
+    pipeline.startWorker();
+    ASSERT_TRUE (pipeline.isWorkerRunning());
+
+    // Played in real time, the audio thread only ever pushes input and pulls output.
+    const auto before = scheduler->getStatistics();
+    const auto start = std::chrono::steady_clock::now();
+    juce::AudioBuffer<float> block (1, blockSize);
+    juce::MidiBuffer midiBuffer;
+    float peak = 0.0f;
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            const auto phase = juce::MathConstants<double>::twoPi * 220.0 * (b * blockSize + i) / sampleRate;
+            block.setSample (0, i, 0.3f * static_cast<float> (std::sin (phase)));
+        }
+        pipeline.processBlock (block, midiBuffer);
+        pipeline.getNextBlock (block);
+        peak = std::max (peak, block.getMagnitude (0, 0, blockSize));
+        std::this_thread::sleep_until (start + std::chrono::duration<double> ((b + 1) * blockSize / sampleRate));
+    }
+    const auto after = scheduler->getStatistics();
+    pipeline.stopWorker();
+
+    EXPECT_GT (peak, 0.0f);
+    EXPECT_GT (after.numHopsRendered - before.numHopsRendered, 0);
+}
+
+// Hosts may prepare again, at another rate, without releasing first. The worker has to be off the
+// pipeline while it is rebuilt.
+TEST (InferencePipelineTest, PreparesAgainWhileWorkerRuns)
+{
+    constexpr int blockSize = 256;
+    constexpr int numBlocks = 200;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    DDSPAudioProcessor processor (/*singleThreaded=*/true);
+    ddsp::InferencePipeline pipeline (processor.getValueTree());
+    pipeline.prepareToPlay (48000.0, blockSize);
+    pipeline.loadModel (processor.getModelLibrary().getModelList()[0]);
+
+    juce::AudioBuffer<float> block (1, blockSize);
+    juce::MidiBuffer midiBuffer;
+    for (double sampleRate : { 48000.0, 96000.0, 44100.0 })
+    {
+        pipeline.prepareToPlay (sampleRate, blockSize);
+        EXPECT_FALSE (pipeline.isWorkerRunning());
+        pipeline.startWorker();
+
+        float peak = 0.0f;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const auto phase = juce::MathConstants<double>::twoPi * 220.0 * (b * blockSize + i) / sampleRate;
+                block.setSample (0, i, 0.3f * static_cast<float> (std::sin (phase)));
+            }
+            pipeline.processBlock (block, midiBuffer);
+            pipeline.getNextBlock (block);
+            peak = std::max (peak, block.getMagnitude (0, 0, blockSize));
+            std::this_thread::sleep_for (std::chrono::duration<double> (blockSize / sampleRate));
+        }
+        EXPECT_GT (peak, 0.0f) << sampleRate;
+    }
+    pipeline.stopWorker();
+}
+
+TEST (PredictControlsModelTest, BatchesStreamsLikeSingleCalls)
+{
+    constexpr int numStreams = 4;
+    constexpr int numHops = 200;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    ddsp::ModelLibrary modelLibrary;
+    const auto& modelInfo = modelLibrary.getModelList()[0];
+    const auto shared = ddsp::PredictControlsModel::getShared (modelInfo);
+    EXPECT_EQ (ddsp::PredictControlsModel::getShared (modelInfo), shared);
+
+    // Each stream on a model of its own, and all of them through the shared one.
+    std::vector<std::unique_ptr<ddsp::PredictControlsModel>> singles;
+    std::array<ddsp::PredictControlsModel::State, numStreams> states {};
+    std::array<ddsp::AudioFeatures, numStreams> features;
+    std::array<ddsp::SynthesisControls, numStreams> singleControls, batchedControls;
+    std::array<ddsp::PredictControlsModel::Request, numStreams> requests;
+    for (int i = 0; i < numStreams; ++i)
+    {
+        singles.push_back (std::make_unique<ddsp::PredictControlsModel> (modelInfo));
+        requests[i] = { &features[i], &states[i], &batchedControls[i] };
+    }
+
+    float maxDifference = 0.0f;
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        for (int i = 0; i < numStreams; ++i)
+        {
+            features[i].f0_hz = 110.0f * std::pow (2.0f, i + 2.0f * hop / numHops);
+            features[i].f0_norm = ddsp::normalizedPitch (features[i].f0_hz);
+            features[i].loudness_norm = ddsp::normalizedLoudness (-20.0f - 5.0f * i);
+        }
+
+        for (int i = 0; i < numStreams; ++i)
+        {
+            singles[i]->call (features[i], singleControls[i]);
+        }
+        shared->callBatch (requests.data(), numStreams);
+
+        for (int i = 0; i < numStreams; ++i)
+        {
+            const auto& single = singleControls[i];
+            const auto& batched = batchedControls[i];
+            maxDifference = std::max (maxDifference, std::abs (single.amplitude - batched.amplitude));
+            for (int h = 0; h < ddsp::kHarmonicsSize; ++h)
+            {
+                maxDifference = std::max (maxDifference, std::abs (single.harmonics[h] - batched.harmonics[h]));
+            }
+        }
+    }
+
+    EXPECT_LT (maxDifference, 1e-4f);
+}
+
+// Every number of requests, up to and past the largest batch, runs on a batch built at construction.
+// Those that do not fill it are padded, which must not change what the real ones predict.
+TEST (PredictControlsModelTest, PadsBatchesOfAnySize)
+{
+    constexpr int maxNumStreams = ddsp::PredictControlsModel::kMaxBatchSize + 3;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    ddsp::ModelLibrary modelLibrary;
+    const auto& modelInfo = modelLibrary.getModelList()[0];
+    ddsp::PredictControlsModel single (modelInfo), batched (modelInfo);
+
+    std::array<ddsp::PredictControlsModel::State, maxNumStreams> states {};
+    std::array<ddsp::AudioFeatures, maxNumStreams> features;
+    std::array<ddsp::SynthesisControls, maxNumStreams> controls;
+    std::array<ddsp::PredictControlsModel::Request, maxNumStreams> requests;
+    for (int numStreams = 1; numStreams <= maxNumStreams; ++numStreams)
+    {
+        for (int i = 0; i < numStreams; ++i)
+        {
+            features[i].f0_hz = 110.0f * std::pow (2.0f, i / 6.0f);
+            features[i].f0_norm = ddsp::normalizedPitch (features[i].f0_hz);
+            features[i].loudness_norm = ddsp::normalizedLoudness (-20.0f - i);
+            states[i] = {};
+            requests[i] = { &features[i], &states[i], &controls[i] };
+        }
+        batched.callBatch (requests.data(), numStreams);
+
+        for (int i = 0; i < numStreams; ++i)
+        {
+            ddsp::SynthesisControls expected;
+            single.reset();
+            single.call (features[i], expected);
+            EXPECT_NEAR (controls[i].amplitude, expected.amplitude, 1e-4f) << numStreams << " streams";
+            for (int h = 0; h < ddsp::kHarmonicsSize; ++h)
+            {
+                EXPECT_NEAR (controls[i].harmonics[h], expected.harmonics[h], 1e-4f) << numStreams << " streams";
+            }
+        }
+    }
+}
+
+// The audio thread only tries the shared model and falls back to a copy of its own, built without
+// batches, which has to predict what the shared one would.
+TEST (PredictControlsModelTest, TriesTheSharedModelWithoutWaiting)
+{
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    ddsp::ModelLibrary modelLibrary;
+    const auto& modelInfo = modelLibrary.getModelList()[0];
+    ddsp::PredictControlsModel shared (modelInfo), own (modelInfo, 1);
+
+    ddsp::PredictControlsModel::State sharedState {}, ownState {};
+    ddsp::AudioFeatures features;
+    ddsp::SynthesisControls sharedControls, ownControls;
+    for (int hop = 0; hop < 50; ++hop)
+    {
+        features.f0_hz = 220.0f * std::pow (2.0f, hop / 50.0f);
+        features.f0_norm = ddsp::normalizedPitch (features.f0_hz);
+        features.loudness_norm = ddsp::normalizedLoudness (-20.0f);
+
+        // Nothing else runs the shared model, so trying never fails.
+        const ddsp::PredictControlsModel::Request sharedRequest { &features, &sharedState, &sharedControls };
+        ASSERT_TRUE (shared.tryCallBatch (&sharedRequest, 1));
+        const ddsp::PredictControlsModel::Request ownRequest { &features, &ownState, &ownControls };
+        own.callBatch (&ownRequest, 1);
+
+        EXPECT_NEAR (sharedControls.amplitude, ownControls.amplitude, 1e-4f);
+        for (int h = 0; h < ddsp::kHarmonicsSize; ++h)
+        {
+            EXPECT_NEAR (sharedControls.harmonics[h], ownControls.harmonics[h], 1e-4f);
+        }
+    }
+}
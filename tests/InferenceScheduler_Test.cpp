@@ -0,0 +1,256 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "audio/tflite/InferenceScheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+class CountingJob : public ddsp::InferenceScheduler::Job
+{
+public:
+    explicit CountingJob (std::function<void()> work = {}) : work (std::move (work)) {}
+
+    int runJob() override
+    {
+        numConcurrentRuns += running.exchange (true) ? 1 : 0;
+        if (work)
+            work();
+        running = false;
+        ++numRuns;
+        return 1;
+    }
+
+    std::atomic<int> numRuns = 0;
+    std::atomic<int> numConcurrentRuns = 0;
+
+private:
+    std::function<void()> work;
+    std::atomic<bool> running = false;
+};
+
+juce::int64 ticksFromNow (double seconds)
+{
+    return juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks (seconds);
+}
+
+// Spins until `condition` holds or a second has passed. Returns whether it holds.
+bool waitFor (const std::function<bool()>& condition)
+{
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds (1);
+    while (! condition())
+    {
+        if (std::chrono::steady_clock::now() > timeout)
+            return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+} // namespace
+
+TEST (InferenceSchedulerTest, RunsEverySubmittedJob)
+{
+    ddsp::InferenceScheduler scheduler;
+    std::vector<std::unique_ptr<CountingJob>> jobs;
+    std::vector<int> jobIds;
+    for (int i = 0; i < 3 * scheduler.getNumWorkers(); ++i)
+    {
+        jobs.push_back (std::make_unique<CountingJob>());
+        jobIds.push_back (scheduler.add (*jobs.back()));
+        ASSERT_GE (jobIds.back(), 0);
+    }
+
+    for (int jobId : jobIds)
+        scheduler.submit (jobId, ticksFromNow (1.0));
+
+    for (auto& job : jobs)
+        EXPECT_TRUE (waitFor ([&] { return job->numRuns == 1; }));
+    EXPECT_EQ (scheduler.getStatistics().numHopsRendered, static_cast<juce::int64> (jobs.size()));
+
+    for (int jobId : jobIds)
+        scheduler.remove (jobId);
+}
+
+TEST (InferenceSchedulerTest, NeverRunsAJobTwiceAtOnce)
+{
+    ddsp::InferenceScheduler scheduler;
+    CountingJob job ([] { std::this_thread::sleep_for (std::chrono::microseconds (100)); });
+    const int jobId = scheduler.add (job);
+
+    for (int i = 0; i < 2000; ++i)
+        scheduler.submit (jobId, ticksFromNow (1.0));
+
+    // Submissions during a run are folded into a single run after it.
+    EXPECT_TRUE (waitFor ([&] { return job.numRuns > 0 && scheduler.getStatistics (jobId).numRuns == job.numRuns; }));
+    scheduler.remove (jobId);
+    EXPECT_GE (job.numRuns, 1);
+    EXPECT_LE (job.numRuns, 2000);
+    EXPECT_EQ (job.numConcurrentRuns, 0);
+}
+
+TEST (InferenceSchedulerTest, StealsFromABusyWorker)
+{
+    ddsp::InferenceScheduler scheduler;
+    if (scheduler.getNumWorkers() < 2)
+        GTEST_SKIP() << "Needs a second worker to steal";
+
+    std::atomic<bool> started = false, release = false;
+    CountingJob blocking (
+        [&]
+        {
+            started = true;
+            waitFor ([&] { return release.load(); });
+        });
+    std::vector<std::unique_ptr<CountingJob>> others;
+    std::vector<int> otherIds;
+    const int blockingId = scheduler.add (blocking);
+    // Homes are handed out in turn, so the last of these shares its home with the blocking job.
+    for (int i = 0; i < scheduler.getNumWorkers(); ++i)
+    {
+        others.push_back (std::make_unique<CountingJob>());
+        otherIds.push_back (scheduler.add (*others.back()));
+    }
+
+    scheduler.submit (blockingId, ticksFromNow (1.0));
+    ASSERT_TRUE (waitFor ([&] { return started.load(); }));
+    scheduler.submit (otherIds.back(), ticksFromNow (1.0));
+    EXPECT_TRUE (waitFor ([&] { return others.back()->numRuns == 1; }));
+    EXPECT_EQ (blocking.numRuns, 0);
+
+    release = true;
+    EXPECT_TRUE (waitFor ([&] { return blocking.numRuns == 1; }));
+    scheduler.remove (blockingId);
+    for (int jobId : otherIds)
+        scheduler.remove (jobId);
+}
+
+TEST (InferenceSchedulerTest, CountsDeadlineMisses)
+{
+    ddsp::InferenceScheduler scheduler;
+    CountingJob job;
+    const int jobId = scheduler.add (job);
+
+    scheduler.submit (jobId, ticksFromNow (10.0));
+    ASSERT_TRUE (waitFor ([&] { return scheduler.getStatistics (jobId).numRuns == 1; }));
+    EXPECT_EQ (scheduler.getStatistics (jobId).numDeadlineMisses, 0);
+
+    scheduler.submit (jobId, ticksFromNow (-1.0));
+    ASSERT_TRUE (waitFor ([&] { return scheduler.getStatistics (jobId).numRuns == 2; }));
+    EXPECT_EQ (scheduler.getStatistics (jobId).numDeadlineMisses, 1);
+    EXPECT_EQ (scheduler.getStatistics().numDeadlineMisses, 1);
+
+    scheduler.remove (jobId);
+}
+
+TEST (InferenceSchedulerTest, ReusesRemovedSlots)
+{
+    ddsp::InferenceScheduler scheduler;
+    CountingJob job;
+    for (int i = 0; i < 2 * ddsp::InferenceScheduler::kMaxNumJobs; ++i)
+    {
+        const int jobId = scheduler.add (job);
+        ASSERT_GE (jobId, 0);
+        scheduler.remove (jobId);
+    }
+}
+
+namespace
+{
+
+class BatchingJob : public CountingJob
+{
+public:
+    void runJobs (ddsp::InferenceScheduler::Job* const* jobs, int numJobs, int* numHopsRendered) override
+    {
+        batchSizes.push_back (numJobs);
+        CountingJob::runJobs (jobs, numJobs, numHopsRendered);
+    }
+
+    // Only touched by the worker running the batch, and read once it is done.
+    std::vector<int> batchSizes;
+};
+
+} // namespace
+
+TEST (InferenceSchedulerTest, RunsJobsThatShareAKeyTogether)
+{
+    constexpr int numJobs = 4;
+    ddsp::InferenceScheduler scheduler;
+    const int key = 0;
+    std::array<BatchingJob, numJobs> jobs;
+    std::array<int, numJobs> jobIds;
+    for (int i = 0; i < numJobs; ++i)
+    {
+        jobIds[i] = scheduler.add (jobs[i]);
+        scheduler.setBatchKey (jobIds[i], &key);
+    }
+
+    // Submitted one after the other, like instances in the host's processing order.
+    for (int jobId : jobIds)
+        scheduler.submit (jobId, ticksFromNow (1.0));
+    for (auto& job : jobs)
+        ASSERT_TRUE (waitFor ([&] { return job.numRuns == 1; }));
+
+    int numBatches = 0;
+    for (auto& job : jobs)
+    {
+        for (int batchSize : job.batchSizes)
+        {
+            EXPECT_EQ (batchSize, numJobs);
+            ++numBatches;
+        }
+    }
+    EXPECT_EQ (numBatches, 1);
+    EXPECT_EQ (scheduler.getStatistics().numBatchedRuns, numJobs);
+
+    for (int jobId : jobIds)
+        scheduler.remove (jobId);
+}
+
+TEST (InferenceSchedulerTest, StopsWaitingForASiblingThatIsNotSubmitted)
+{
+    ddsp::InferenceScheduler scheduler;
+    const int key = 0;
+    BatchingJob submitted, silent;
+    const int submittedId = scheduler.add (submitted);
+    const int silentId = scheduler.add (silent);
+    scheduler.setBatchKey (submittedId, &key);
+    scheduler.setBatchKey (silentId, &key);
+
+    const auto start = std::chrono::steady_clock::now();
+    scheduler.submit (submittedId, ticksFromNow (1.0));
+    ASSERT_TRUE (waitFor ([&] { return submitted.numRuns == 1; }));
+    const std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - start;
+    EXPECT_GE (waited.count(), ddsp::InferenceScheduler::kBatchGatherWindow_ms);
+    EXPECT_EQ (silent.numRuns, 0);
+    EXPECT_EQ (scheduler.getStatistics().numBatchedRuns, 0);
+
+    // Without the slack for it, the job does not wait at all.
+    scheduler.submit (submittedId, ticksFromNow (0.0));
+    ASSERT_TRUE (waitFor ([&] { return submitted.numRuns == 2; }));
+
+    scheduler.remove (submittedId);
+    scheduler.remove (silentId);
+}
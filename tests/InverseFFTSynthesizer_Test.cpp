@@ -0,0 +1,118 @@
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/InverseFFTSynthesizer.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+double signalToNoiseRatio_dB (double signalEnergy, double noiseEnergy)
+{
+    return 10.0 * std::log10 (signalEnergy / std::max (noiseEnergy, 1e-30));
+}
+
+} // namespace
+
+TEST (InverseFFTSynthesizerTest, MatchesDoublePrecisionReference)
+{
+    constexpr float f0 = 220.f, amplitude = 0.5f;
+    constexpr int numHops = 50;
+    ddsp::InverseFFTSynthesizer synthesizer (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+
+    std::vector<float> distribution (ddsp::kHarmonicsSize);
+    juce::Random random (7);
+    for (auto& value : distribution)
+        value = random.nextFloat();
+
+    // The same normalization render() applies: harmonics at or above Nyquist are dropped, the rest sum to 1.
+    std::vector<double> levels (ddsp::kHarmonicsSize, 0.0);
+    double total = 0.0;
+    for (int k = 0; k < ddsp::kHarmonicsSize && (k + 1) * f0 < ddsp::kModelSampleRate_Hz / 2.f; ++k)
+        total += levels[k] = distribution[k];
+
+    // Like HarmonicSynthesizer, the first hop glides up from 0 Hz over its first half, which delays
+    // the phase by (hop / 2 + 1) / 2 samples of the fundamental.
+    const double omega = juce::MathConstants<double>::twoPi * f0 / ddsp::kModelSampleRate_Hz;
+    const double delay = (ddsp::kModelHopSize / 2 + 1) / 2.0;
+
+    double signalEnergy = 0.0, noiseEnergy = 0.0;
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        auto harmonics = distribution;
+        const auto& output = synthesizer.render (harmonics, amplitude, f0);
+
+        // The first hop fades in from silence.
+        if (hop == 0)
+            continue;
+
+        for (int i = 0; i < ddsp::kModelHopSize; ++i)
+        {
+            const double phase = omega * (hop * ddsp::kModelHopSize + i + 1 - delay);
+            double reference = 0.0;
+            for (int k = 0; k < ddsp::kHarmonicsSize; ++k)
+                reference += amplitude * levels[k] / total * std::sin ((k + 1) * phase);
+
+            signalEnergy += reference * reference;
+            noiseEnergy += (output[i] - reference) * (output[i] - reference);
+        }
+    }
+
+    EXPECT_GT (signalToNoiseRatio_dB (signalEnergy, noiseEnergy), 60.0);
+}
+
+TEST (InverseFFTSynthesizerTest, ResetRestartsFromSilence)
+{
+    ddsp::InverseFFTSynthesizer synthesizer (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    std::vector<float> harmonics (ddsp::kHarmonicsSize, 1.f);
+    synthesizer.render (harmonics, 0.5f, 440.f);
+
+    synthesizer.reset();
+    harmonics.assign (ddsp::kHarmonicsSize, 1.f);
+    const auto& output = synthesizer.render (harmonics, 0.5f, 440.f);
+
+    // Nothing is left over from before the reset, so the hop starts from silence.
+    EXPECT_NEAR (output.front(), 0.f, 1e-4f);
+}
+
+// While f0 glides, both engines have to play the same notes. Each frame of the inverse FFT holds f0
+// steady where the oscillator bank glides within the hop, which costs about 6 dB every time the glide
+// doubles in speed; an octave in two seconds stays above 30 dB, and a 1% detune falls below 0 dB.
+TEST (InverseFFTSynthesizerTest, GlidesLikeHarmonicSynthesizer)
+{
+    constexpr float amplitude = 0.5f;
+    constexpr int numHops = 200;
+    ddsp::HarmonicSynthesizer oscillatorBank (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+    ddsp::InverseFFTSynthesizer inverseFFT (ddsp::kHarmonicsSize, ddsp::kModelHopSize, ddsp::kModelSampleRate_Hz);
+
+    // Harmonics that roll off like those the models predict.
+    std::vector<float> distribution (ddsp::kHarmonicsSize);
+    juce::Random random (11);
+    for (int k = 0; k < ddsp::kHarmonicsSize; ++k)
+        distribution[k] = (0.5f + random.nextFloat()) / ((k + 1) * (k + 1));
+
+    double signalEnergy = 0.0, noiseEnergy = 0.0;
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        // An octave up, then back down.
+        const float octaves = 1.f - std::abs (1.f - 2.f * hop / numHops);
+        const float f0 = 110.f * std::pow (2.f, octaves);
+
+        auto referenceHarmonics = distribution;
+        const auto& reference = oscillatorBank.render (referenceHarmonics, amplitude, f0);
+        auto harmonics = distribution;
+        const auto& output = inverseFFT.render (harmonics, amplitude, f0);
+
+        // Both fade in from silence over the first hop.
+        if (hop == 0)
+            continue;
+
+        for (int i = 0; i < ddsp::kModelHopSize; ++i)
+        {
+            signalEnergy += reference[i] * reference[i];
+            noiseEnergy += (output[i] - reference[i]) * (output[i] - reference[i]);
+        }
+    }
+
+    EXPECT_GT (signalToNoiseRatio_dB (signalEnergy, noiseEnergy), 30.0);
+}
@@ -0,0 +1,85 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+
+#include "util/LightweightSemaphore.h"
+
+#include <gtest/gtest.h>
+
+TEST (LightweightSemaphoreTest, CountsSignals)
+{
+    ddsp::LightweightSemaphore semaphore (1);
+    semaphore.signal (2);
+    EXPECT_EQ (semaphore.getCount(), 3);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE (semaphore.tryWait());
+    EXPECT_FALSE (semaphore.tryWait());
+
+    // A signal that comes before the wait is not lost.
+    semaphore.signal();
+    semaphore.wait();
+    EXPECT_EQ (semaphore.getCount(), 0);
+}
+
+TEST (LightweightSemaphoreTest, WakesBlockedWaiter)
+{
+    ddsp::LightweightSemaphore semaphore;
+    std::atomic<bool> woken = false;
+    std::thread waiter (
+        [&]
+        {
+            semaphore.wait();
+            woken = true;
+        });
+
+    while (semaphore.getCount() == 0)
+        std::this_thread::yield();
+    EXPECT_EQ (semaphore.getCount(), -1);
+    EXPECT_FALSE (woken);
+
+    semaphore.signal();
+    waiter.join();
+    EXPECT_TRUE (woken);
+    EXPECT_EQ (semaphore.getCount(), 0);
+}
+
+TEST (LightweightSemaphoreTest, PassesTurnsBetweenThreads)
+{
+    constexpr int numTurns = 10000;
+    ddsp::LightweightSemaphore ping, pong;
+    int counter = 0;
+
+    std::thread other (
+        [&]
+        {
+            for (int i = 0; i < numTurns; ++i)
+            {
+                ping.wait();
+                ++counter;
+                pong.signal();
+            }
+        });
+
+    for (int i = 0; i < numTurns; ++i)
+    {
+        ping.signal();
+        pong.wait();
+        ++counter;
+    }
+
+    other.join();
+    EXPECT_EQ (counter, 2 * numTurns);
+}
@@ -0,0 +1,295 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+
+#include "PluginProcessor.h"
+#include "audio/tflite/ModelHandoff.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+// Set on a thread while it must not allocate or free; whatever it does anyway is counted. The
+// replacements below count every form of new and delete, which is why this file builds into a runner
+// of its own rather than into the unit tests.
+thread_local bool allocationsForbidden = false;
+std::atomic<int> numForbiddenAllocations = 0;
+std::atomic<int> numForbiddenFrees = 0;
+
+class ScopedNoAllocation
+{
+public:
+    ScopedNoAllocation() { allocationsForbidden = true; }
+    ~ScopedNoAllocation() { allocationsForbidden = false; }
+};
+
+void* allocate (std::size_t size) noexcept
+{
+    if (allocationsForbidden)
+        ++numForbiddenAllocations;
+    return std::malloc (size == 0 ? 1 : size);
+}
+
+// Over-allocates by the alignment and keeps the pointer malloc() returned just below the block, as
+// std::aligned_alloc() is not available everywhere.
+void* allocate (std::size_t size, std::align_val_t alignment) noexcept
+{
+    const auto align = static_cast<std::uintptr_t> (alignment);
+    void* raw = allocate (size + align + sizeof (void*));
+    if (raw == nullptr)
+        return nullptr;
+
+    const auto aligned = (reinterpret_cast<std::uintptr_t> (raw) + sizeof (void*) + align - 1) & ~(align - 1);
+    reinterpret_cast<void**> (aligned)[-1] = raw;
+    return reinterpret_cast<void*> (aligned);
+}
+
+void deallocate (void* p) noexcept
+{
+    if (p != nullptr && allocationsForbidden)
+        ++numForbiddenFrees;
+    std::free (p);
+}
+
+void deallocate (void* p, std::align_val_t) noexcept
+{
+    deallocate (p != nullptr ? static_cast<void**> (p)[-1] : nullptr);
+}
+
+template <typename... Alignment>
+void* allocateOrThrow (std::size_t size, Alignment... alignment)
+{
+    if (void* p = allocate (size, alignment...))
+        return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new (std::size_t size) { return allocateOrThrow (size); }
+void* operator new[] (std::size_t size) { return allocateOrThrow (size); }
+void* operator new (std::size_t size, std::align_val_t a) { return allocateOrThrow (size, a); }
+void* operator new[] (std::size_t size, std::align_val_t a) { return allocateOrThrow (size, a); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept { return allocate (size); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept { return allocate (size); }
+void* operator new (std::size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return allocate (size, a); }
+void* operator new[] (std::size_t size, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    return allocate (size, a);
+}
+
+void operator delete (void* p) noexcept { deallocate (p); }
+void operator delete[] (void* p) noexcept { deallocate (p); }
+void operator delete (void* p, std::size_t) noexcept { deallocate (p); }
+void operator delete[] (void* p, std::size_t) noexcept { deallocate (p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept { deallocate (p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept { deallocate (p); }
+void operator delete (void* p, std::align_val_t a) noexcept { deallocate (p, a); }
+void operator delete[] (void* p, std::align_val_t a) noexcept { deallocate (p, a); }
+void operator delete (void* p, std::size_t, std::align_val_t a) noexcept { deallocate (p, a); }
+void operator delete[] (void* p, std::size_t, std::align_val_t a) noexcept { deallocate (p, a); }
+void operator delete (void* p, std::align_val_t a, const std::nothrow_t&) noexcept { deallocate (p, a); }
+void operator delete[] (void* p, std::align_val_t a, const std::nothrow_t&) noexcept { deallocate (p, a); }
+
+namespace
+{
+
+struct TrackedModel
+{
+    TrackedModel() { ++numLive; }
+    ~TrackedModel()
+    {
+        lastDestroyedOn = std::this_thread::get_id();
+        --numLive;
+    }
+
+    static inline std::atomic<int> numLive = 0;
+    static inline std::atomic<std::thread::id> lastDestroyedOn;
+};
+
+// Spins until `condition` holds or a second has passed. Returns whether it holds.
+bool waitFor (const std::function<bool()>& condition)
+{
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds (1);
+    while (! condition())
+    {
+        if (std::chrono::steady_clock::now() > timeout)
+            return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+} // namespace
+
+TEST (ModelHandoffTest, HandsOverTheLatestModel)
+{
+    ddsp::ModelHandoff<TrackedModel> handoff;
+    EXPECT_FALSE (handoff.acquire());
+    EXPECT_EQ (handoff.getCurrent(), nullptr);
+
+    auto first = std::make_shared<TrackedModel>();
+    auto second = std::make_shared<TrackedModel>();
+    handoff.publish (first);
+    handoff.publish (second);
+    // The first one was never taken, so the publisher drops it right away.
+    EXPECT_EQ (first.use_count(), 1);
+
+    EXPECT_TRUE (handoff.acquire());
+    EXPECT_EQ (handoff.getCurrent(), second.get());
+    EXPECT_EQ (handoff.getPrevious(), nullptr);
+    EXPECT_FALSE (handoff.acquire());
+    EXPECT_EQ (handoff.getCurrent(), second.get());
+}
+
+TEST (ModelHandoffTest, FreesReplacedModelsOnTheReclaimer)
+{
+    ddsp::ModelHandoff<TrackedModel> handoff;
+    handoff.publish (std::make_shared<TrackedModel>());
+    ASSERT_TRUE (handoff.acquire());
+    auto* first = handoff.getCurrent();
+
+    handoff.publish (std::make_shared<TrackedModel>());
+    ASSERT_TRUE (handoff.acquire());
+    EXPECT_EQ (handoff.getPrevious(), first);
+    EXPECT_EQ (TrackedModel::numLive, 2);
+
+    handoff.releasePrevious();
+    EXPECT_EQ (handoff.getPrevious(), nullptr);
+    ASSERT_TRUE (waitFor ([] { return TrackedModel::numLive == 1; }));
+    EXPECT_NE (TrackedModel::lastDestroyedOn.load(), std::this_thread::get_id());
+}
+
+TEST (ModelHandoffTest, SwapsUnderLoadWithoutAllocating)
+{
+    constexpr int numModels = 2000;
+    numForbiddenAllocations = 0;
+    numForbiddenFrees = 0;
+
+    {
+        juce::SharedResourcePointer<ddsp::ModelReclaimer> reclaimer;
+        const auto numReclaimedBefore = reclaimer->getNumReclaimed();
+        ddsp::ModelHandoff<TrackedModel> handoff;
+
+        std::atomic<bool> published = false;
+        std::thread publisher (
+            [&]
+            {
+                for (int i = 0; i < numModels; ++i)
+                    handoff.publish (std::make_shared<TrackedModel>());
+                published = true;
+            });
+
+        // Like a render thread, fading from the previous model to the current one now and then.
+        int numSwaps = 0;
+        {
+            const ScopedNoAllocation noAllocation;
+            for (int i = 0;; ++i)
+            {
+                // Read ahead of acquiring, so that the last model published is not missed.
+                const bool done = published;
+                if (handoff.acquire())
+                    ++numSwaps;
+                else if (done)
+                    break;
+
+                if (i % 3 == 0)
+                    handoff.releasePrevious();
+            }
+        }
+        publisher.join();
+
+        EXPECT_GT (numSwaps, 0);
+        EXPECT_EQ (numForbiddenAllocations, 0);
+        EXPECT_EQ (numForbiddenFrees, 0);
+        // Every model swapped out has gone to the reclaimer, or does once the last one is released.
+        handoff.releasePrevious();
+        EXPECT_TRUE (waitFor ([&] { return reclaimer->getNumReclaimed() - numReclaimedBefore == numSwaps - 1; }));
+    }
+
+    EXPECT_EQ (TrackedModel::numLive, 0);
+}
+
+TEST (EndToEndTest, SwapsModelsWithoutAllocatingOnTheAudioThread)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int numLoads = 12;
+
+    juce::ScopedJuceInitialiser_GUI juce_framework;
+
+    DDSPAudioProcessor processor (/*singleThreaded=*/true);
+    processor.prepareToPlay (sampleRate, blockSize);
+    const int numModels = static_cast<int> (processor.getModelLibrary().getModelList().size());
+    ASSERT_GT (numModels, 1);
+
+    juce::AudioBuffer<float> block (1, blockSize);
+    juce::MidiBuffer midiBuffer;
+    int numSamplesPlayed = 0;
+    const auto renderBlock = [&]
+    {
+        for (int i = 0; i < blockSize; ++i, ++numSamplesPlayed)
+        {
+            const auto phase = juce::MathConstants<double>::twoPi * 220.0 * numSamplesPlayed / sampleRate;
+            block.setSample (0, i, 0.3f * static_cast<float> (std::sin (phase)));
+        }
+        processor.processBlock (block, midiBuffer);
+    };
+
+    // Settle for a second before anything is counted.
+    while (numSamplesPlayed < sampleRate)
+        renderBlock();
+
+    numForbiddenAllocations = 0;
+    numForbiddenFrees = 0;
+    std::atomic<bool> loaded = false;
+    std::thread loader (
+        [&]
+        {
+            for (int i = 1; i <= numLoads; ++i)
+                processor.loadModel (i % numModels);
+            loaded = true;
+        });
+
+    // The audio thread renders as fast as it can, picking up every model the loader gets ready.
+    int numBlocks = 0;
+    float peak = 0.0f;
+    while (! loaded)
+    {
+        {
+            const ScopedNoAllocation noAllocation;
+            renderBlock();
+        }
+        peak = std::max (peak, block.getMagnitude (0, 0, blockSize));
+        ++numBlocks;
+    }
+    loader.join();
+    processor.releaseResources();
+
+    EXPECT_EQ (numForbiddenAllocations, 0);
+    EXPECT_EQ (numForbiddenFrees, 0);
+    EXPECT_GT (numBlocks, 0);
+    EXPECT_TRUE (std::isfinite (peak));
+}
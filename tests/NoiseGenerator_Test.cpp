@@ -0,0 +1,104 @@
+#include "audio/NoiseGenerator.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<float> generate (ddsp::NoiseGenerator& generator, int numSamples)
+{
+    std::vector<float> samples (numSamples);
+    generator.fillUniform (samples.data(), numSamples);
+    return samples;
+}
+
+} // namespace
+
+// Known-answer test from the Random123 distribution: counter 0 and key 0.
+TEST (NoiseGeneratorTest, MatchesPhiloxTestVector)
+{
+    const ddsp::NoiseGenerator generator (0, 0);
+    const std::array<juce::uint32, 4> expected = { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 };
+    EXPECT_EQ (generator.generateBlock (0), expected);
+}
+
+TEST (NoiseGeneratorTest, IsReproducibleAndIndependentOfCallSizes)
+{
+    constexpr int numSamples = 10000;
+    ddsp::NoiseGenerator whole (1234, 5), pieces (1234, 5);
+    const auto expected = generate (whole, numSamples);
+
+    std::vector<float> output;
+    juce::Random random (1);
+    while (static_cast<int> (output.size()) < numSamples)
+    {
+        const int size = std::min (random.nextInt (70), numSamples - static_cast<int> (output.size()));
+        const auto piece = generate (pieces, size);
+        output.insert (output.end(), piece.begin(), piece.end());
+    }
+
+    EXPECT_EQ (output, expected);
+    EXPECT_EQ (pieces.getPosition(), static_cast<juce::uint64> (numSamples));
+
+    // Seeking back replays the stream from there.
+    pieces.seek (4321);
+    const auto replayed = generate (pieces, 100);
+    EXPECT_TRUE (std::equal (replayed.begin(), replayed.end(), expected.begin() + 4321));
+
+    pieces.setSeed (1234, 5);
+    EXPECT_EQ (generate (pieces, numSamples), expected);
+}
+
+TEST (NoiseGeneratorTest, IsUniformAndWhite)
+{
+    constexpr int numSamples = 1 << 20, numBins = 64;
+    ddsp::NoiseGenerator generator (42);
+    const auto samples = generate (generator, numSamples);
+
+    double sum = 0.0, sumOfSquares = 0.0, lagProduct = 0.0;
+    std::vector<int> histogram (numBins, 0);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        ASSERT_GE (samples[i], -1.f);
+        ASSERT_LT (samples[i], 1.f);
+        sum += samples[i];
+        sumOfSquares += samples[i] * samples[i];
+        if (i > 0)
+            lagProduct += samples[i] * samples[i - 1];
+        ++histogram[static_cast<int> ((samples[i] + 1.f) * 0.5f * numBins)];
+    }
+
+    // Uniform on [-1, 1) has mean 0 and variance 1/3; the tolerances are about five standard errors.
+    const double mean = sum / numSamples;
+    const double variance = sumOfSquares / numSamples - mean * mean;
+    EXPECT_NEAR (mean, 0.0, 5.0 * std::sqrt (1.0 / 3.0 / numSamples));
+    EXPECT_NEAR (variance, 1.0 / 3.0, 5.0 * std::sqrt (4.0 / 45.0 / numSamples));
+    EXPECT_NEAR (lagProduct / (numSamples - 1) / variance, 0.0, 5.0 / std::sqrt (numSamples));
+
+    // Chi-squared with 63 degrees of freedom; 110 is beyond its 99.99th percentile.
+    const double expectedCount = static_cast<double> (numSamples) / numBins;
+    double chiSquared = 0.0;
+    for (int count : histogram)
+        chiSquared += (count - expectedCount) * (count - expectedCount) / expectedCount;
+    EXPECT_LT (chiSquared, 110.0);
+}
+
+TEST (NoiseGeneratorTest, StreamsAreUncorrelated)
+{
+    constexpr int numSamples = 1 << 18;
+    ddsp::NoiseGenerator first (42, 0), second (42, 1), otherSeed (43, 0);
+    const auto a = generate (first, numSamples);
+    const auto b = generate (second, numSamples);
+    const auto c = generate (otherSeed, numSamples);
+
+    const auto correlation = [] (const std::vector<float>& x, const std::vector<float>& y)
+    {
+        double product = 0.0;
+        for (size_t i = 0; i < x.size(); ++i)
+            product += x[i] * y[i];
+        return product / x.size() * 3.0;
+    };
+
+    EXPECT_NEAR (correlation (a, b), 0.0, 5.0 / std::sqrt (numSamples));
+    EXPECT_NEAR (correlation (a, c), 0.0, 5.0 / std::sqrt (numSamples));
+}
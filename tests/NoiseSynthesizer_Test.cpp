@@ -0,0 +1,409 @@
+#include <numeric>
+
+#include "audio/HarmonicSynthesizer.h"
+#include "audio/NoiseSynthesizer.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<float> randomMagnitudes (juce::Random& random)
+{
+    std::vector<float> magnitudes (ddsp::kNoiseAmpsSize);
+    for (auto& value : magnitudes)
+        value = random.nextFloat();
+    return magnitudes;
+}
+
+} // namespace
+
+TEST (NoiseSynthesizerTest, StaticExtentsMatchDynamicExtents)
+{
+    ddsp::NoiseSynthesizer dynamicSynthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    ddsp::StaticNoiseSynthesizer staticSynthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    dynamicSynthesizer.reset();
+    staticSynthesizer.reset();
+    juce::Random random (3);
+
+    for (int hop = 0; hop < 50; ++hop)
+    {
+        const auto magnitudes = randomMagnitudes (random);
+        const auto expected = dynamicSynthesizer.render (magnitudes);
+        const auto output = staticSynthesizer.render (magnitudes);
+        ASSERT_EQ (output.size(), expected.size());
+        for (size_t i = 0; i < output.size(); ++i)
+            ASSERT_FLOAT_EQ (output[i], expected[i]);
+    }
+}
+
+TEST (NoiseSynthesizerTest, LevelIsIndependentOfSynthesisRate)
+{
+    constexpr int numHops = 200;
+    const std::vector<float> magnitudes (ddsp::kNoiseAmpsSize, 0.5f);
+
+    const auto renderRMS = [&] (int hopSize)
+    {
+        ddsp::HostRateNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, hopSize);
+        synthesizer.reset();
+        double energy = 0.0;
+        for (int hop = 0; hop < numHops; ++hop)
+            for (auto sample : synthesizer.render (magnitudes))
+                energy += sample * sample;
+        return std::sqrt (energy / (numHops * hopSize));
+    };
+
+    // Hop sizes at the model rate, 44.1, 48 and 96 kHz.
+    const double modelRateRMS = renderRMS (ddsp::kModelHopSize);
+    for (int hopSize : { 882, 960, 1920 })
+        EXPECT_NEAR (renderRMS (hopSize) / modelRateRMS, 1.0, 0.1) << "hop size " << hopSize;
+}
+
+TEST (NoiseSynthesizerTest, StaysBelowModelNyquistAtHostRate)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int hopSize = 960, numHops = 20;
+    ddsp::HostRateNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, hopSize);
+    synthesizer.reset();
+    const std::vector<float> magnitudes (ddsp::kNoiseAmpsSize, 0.5f);
+
+    // Energy per DFT bin of each Hann-windowed hop, summed below and above a margin over the 8 kHz
+    // model Nyquist frequency. Hops are analysed separately so the joins between them do not count.
+    double passbandEnergy = 0.0, stopbandEnergy = 0.0;
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        const auto output = synthesizer.render (magnitudes);
+        for (int k = 1; k < hopSize / 2; ++k)
+        {
+            std::complex<double> bin;
+            for (int n = 0; n < hopSize; ++n)
+            {
+                const double window = 0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * n / hopSize);
+                bin += window * output[n] * std::polar (1.0, -juce::MathConstants<double>::twoPi * k * n / hopSize);
+            }
+
+            const double frequency = k * sampleRate / hopSize;
+            if (frequency < ddsp::kModelSampleRate_Hz / 2.0)
+                passbandEnergy += std::norm (bin);
+            else if (frequency > ddsp::kModelSampleRate_Hz / 2.0 + 1000.0)
+                stopbandEnergy += std::norm (bin);
+        }
+    }
+
+    EXPECT_LT (10.0 * std::log10 (stopbandEnergy / passbandEnergy), -40.0);
+}
+
+TEST (NoiseSynthesizerTest, RenderFramesMatchesSequentialRenders)
+{
+    constexpr int numFrames = 7, hopSize = 960;
+    ddsp::HostRateNoiseSynthesizer sequential (ddsp::kNoiseAmpsSize, hopSize);
+    ddsp::HostRateNoiseSynthesizer batched (ddsp::kNoiseAmpsSize, hopSize);
+    sequential.reset();
+    batched.reset();
+    juce::Random random (5);
+
+    std::vector<ddsp::SynthesisControls> frames (numFrames);
+    std::vector<float> expected;
+    for (auto& frame : frames)
+    {
+        frame.noiseAmps = randomMagnitudes (random);
+        const auto hop = sequential.render (frame.noiseAmps);
+        expected.insert (expected.end(), hop.begin(), hop.end());
+    }
+
+    std::vector<float> output (numFrames * hopSize);
+    batched.renderFrames (frames.data(), numFrames, output.data());
+    EXPECT_EQ (output, expected);
+}
+
+TEST (NoiseSynthesizerTest, ReusesFilterWhileMagnitudesHoldSteady)
+{
+    ddsp::StaticNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    synthesizer.reset();
+    juce::Random random (13);
+    const auto steady = randomMagnitudes (random);
+
+    for (int hop = 0; hop < 100; ++hop)
+    {
+        auto magnitudes = steady;
+        for (auto& value : magnitudes)
+            value += 1e-4f * (random.nextFloat() - 0.5f);
+        synthesizer.render (magnitudes);
+    }
+
+    EXPECT_EQ (synthesizer.getNumImpulseResponseDesigns(), 1);
+    EXPECT_EQ (synthesizer.getNumImpulseResponseCacheHits(), 99);
+
+    // A large step designs a new filter.
+    synthesizer.render (randomMagnitudes (random));
+    EXPECT_EQ (synthesizer.getNumImpulseResponseDesigns(), 2);
+
+    synthesizer.reset();
+    EXPECT_EQ (synthesizer.getNumImpulseResponseCacheHits(), 0);
+}
+
+// Both synthesizers filter the same white noise, so their difference is that noise filtered by the
+// difference between the cached and the exact filters.
+TEST (NoiseSynthesizerTest, CachedFilterErrorIsBounded)
+{
+    constexpr int numHops = 1000;
+    ddsp::StaticNoiseSynthesizer exact (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    ddsp::StaticNoiseSynthesizer cached (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+    exact.setImpulseResponseCacheThreshold (0.f);
+    exact.reset();
+    cached.reset();
+    juce::Random random (17);
+
+    // A slow vibrato across the bands with a little jitter on top, like a sustained note.
+    const auto base = randomMagnitudes (random);
+    double signalEnergy = 0.0, errorEnergy = 0.0;
+    for (int hop = 0; hop < numHops; ++hop)
+    {
+        std::vector<float> magnitudes (ddsp::kNoiseAmpsSize);
+        for (int i = 0; i < ddsp::kNoiseAmpsSize; ++i)
+            magnitudes[i] = (0.5f + 0.5f * base[i]) * (1.f + 0.01f * std::sin (0.01f * hop + i))
+                            + 2e-4f * (random.nextFloat() - 0.5f);
+
+        const auto expected = exact.render (magnitudes);
+        const auto output = cached.render (magnitudes);
+        for (int i = 0; i < ddsp::kModelHopSize; ++i)
+        {
+            signalEnergy += expected[i] * expected[i];
+            errorEnergy += (output[i] - expected[i]) * (output[i] - expected[i]);
+        }
+    }
+
+    const double hitRate = static_cast<double> (cached.getNumImpulseResponseCacheHits()) / numHops;
+    const double error_dB = 10.0 * std::log10 (errorEnergy / signalEnergy);
+
+    EXPECT_EQ (exact.getNumImpulseResponseCacheHits(), 0);
+    EXPECT_GT (hitRate, 0.5);
+    EXPECT_LT (error_dB, -55.0);
+}
+
+// Low-passed noise changes slowly from one sample to the next. A hop that starts from a fresh,
+// unrelated fragment of filtered noise shows up as a jump at the join.
+TEST (NoiseSynthesizerTest, IsContinuousAcrossHops)
+{
+    constexpr int numHops = 500;
+    std::vector<float> magnitudes (ddsp::kNoiseAmpsSize, 0.f);
+    std::fill (magnitudes.begin(), magnitudes.begin() + 3, 1.f);
+
+    for (const auto mode : { ddsp::NoiseSynthesisMode::kTimeDomain, ddsp::NoiseSynthesisMode::kSpectral })
+    {
+        ddsp::StaticNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        synthesizer.setSynthesisMode (mode);
+        synthesizer.reset();
+
+        double joinStep = 0.0, innerStep = 0.0;
+        float previous = 0.f;
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            const auto output = synthesizer.render (magnitudes);
+            if (hop > 0)
+                joinStep += std::abs (output[0] - previous);
+            for (int i = 1; i < ddsp::kModelHopSize; ++i)
+                innerStep += std::abs (output[i] - output[i - 1]);
+            previous = output.back();
+        }
+
+        joinStep /= numHops - 1;
+        innerStep /= numHops * (ddsp::kModelHopSize - 1);
+        EXPECT_LT (joinStep / innerStep, 1.5) << "spectral " << (mode == ddsp::NoiseSynthesisMode::kSpectral);
+    }
+}
+
+// Notes that start on the same hop should start together once the harmonics have been delayed by the
+// group delay of the noise: the harmonics ramp up from their first sample and the noise power, averaged
+// over many onsets, is halfway up at the same point.
+TEST (NoiseSynthesizerTest, LinesUpWithHarmonicsDelayedByGroupDelay)
+{
+    constexpr float sampleRate = 48000.f;
+    constexpr int hopSize = 960, hopsPerCycle = 8, numCycles = 200, smoothing = 32;
+    const std::vector<float> sounding (ddsp::kNoiseAmpsSize, 1.f), silent (ddsp::kNoiseAmpsSize, 0.f);
+
+    for (const auto mode : { ddsp::NoiseSynthesisMode::kTimeDomain, ddsp::NoiseSynthesisMode::kSpectral })
+    {
+        ddsp::HostRateHarmonicSynthesizer harmonicSynthesizer (ddsp::kHarmonicsSize, hopSize, sampleRate);
+        ddsp::HostRateNoiseSynthesizer noiseSynthesizer (ddsp::kNoiseAmpsSize, hopSize);
+        noiseSynthesizer.setSynthesisMode (mode);
+        noiseSynthesizer.reset();
+
+        // Each cycle is silent for its first half and sounds for the second.
+        std::vector<float> harmonics (noiseSynthesizer.getGroupDelay(), 0.f), noise;
+        for (int hop = 0; hop < numCycles * hopsPerCycle; ++hop)
+        {
+            const bool isSounding = hop % hopsPerCycle >= hopsPerCycle / 2;
+            std::vector<float> distribution (ddsp::kHarmonicsSize, 0.f);
+            distribution[0] = 1.f;
+            const auto harmonicHop = harmonicSynthesizer.render (distribution, isSounding ? 0.5f : 0.f, 200.f);
+            harmonics.insert (harmonics.end(), harmonicHop.begin(), harmonicHop.end());
+            const auto noiseHop = noiseSynthesizer.render (isSounding ? sounding : silent);
+            noise.insert (noise.end(), noiseHop.begin(), noiseHop.end());
+        }
+
+        // Noise power over the first hop of each note, and once the note has settled.
+        std::vector<double> power (hopSize, 0.0);
+        double steadyPower = 0.0;
+        for (int cycle = 0; cycle < numCycles; ++cycle)
+        {
+            const int onset = (cycle * hopsPerCycle + hopsPerCycle / 2) * hopSize;
+            for (int i = 0; i < hopSize; ++i)
+                power[i] += noise[onset + i] * noise[onset + i];
+            for (int i = 2 * hopSize; i < 3 * hopSize; ++i)
+                steadyPower += noise[onset + i] * noise[onset + i] / hopSize;
+        }
+
+        int noiseOnset = -1;
+        for (int i = 0; i + smoothing <= hopSize && noiseOnset < 0; ++i)
+        {
+            if (std::accumulate (power.begin() + i, power.begin() + i + smoothing, 0.0) / smoothing >= steadyPower / 2)
+                noiseOnset = i + smoothing / 2;
+        }
+
+        const int firstOnset = hopsPerCycle / 2 * hopSize;
+        int harmonicOnset = 0;
+        while (harmonics[firstOnset + harmonicOnset] == 0.f)
+            ++harmonicOnset;
+
+        EXPECT_NEAR (noiseOnset, harmonicOnset, hopSize / 20)
+            << "spectral " << (mode == ddsp::NoiseSynthesisMode::kSpectral);
+    }
+}
+
+// The spectral mode should be indistinguishable from filtering white noise: the same level and the
+// same spectral shape, measured as the power in 16 bands averaged over many Hann-windowed hops.
+TEST (NoiseSynthesizerTest, SpectralModeMatchesTimeDomainStatistics)
+{
+    constexpr int numHops = 400, numBands = 16;
+    constexpr int numBins = ddsp::kModelHopSize / 2;
+    juce::Random random (19);
+    const auto magnitudes = randomMagnitudes (random);
+
+    const auto bandPowers = [&] (ddsp::NoiseSynthesisMode mode)
+    {
+        ddsp::StaticNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        synthesizer.setSynthesisMode (mode);
+        synthesizer.reset();
+
+        std::vector<double> powers (numBands, 0.0);
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            const auto output = synthesizer.render (magnitudes);
+            for (int k = 0; k < numBins; ++k)
+            {
+                std::complex<double> bin;
+                for (int n = 0; n < ddsp::kModelHopSize; ++n)
+                {
+                    const double window =
+                        0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * n / ddsp::kModelHopSize);
+                    bin += window * output[n]
+                           * std::polar (1.0, -juce::MathConstants<double>::twoPi * k * n / ddsp::kModelHopSize);
+                }
+                powers[k * numBands / numBins] += std::norm (bin);
+            }
+        }
+        return powers;
+    };
+
+    const auto timeDomain = bandPowers (ddsp::NoiseSynthesisMode::kTimeDomain);
+    const auto spectral = bandPowers (ddsp::NoiseSynthesisMode::kSpectral);
+    const double totalRatio = std::accumulate (spectral.begin(), spectral.end(), 0.0)
+                              / std::accumulate (timeDomain.begin(), timeDomain.end(), 0.0);
+    EXPECT_NEAR (10.0 * std::log10 (totalRatio), 0.0, 0.5);
+    for (int band = 0; band < numBands; ++band)
+        EXPECT_NEAR (10.0 * std::log10 (spectral[band] / timeDomain[band]), 0.0, 1.0) << "band " << band;
+}
+
+TEST (NoiseSynthesizerTest, SpectralModeSkipsForwardFFTs)
+{
+    constexpr int numHops = 50;
+    juce::Random random (23);
+    const auto steady = randomMagnitudes (random);
+
+    for (const auto mode : { ddsp::NoiseSynthesisMode::kTimeDomain, ddsp::NoiseSynthesisMode::kSpectral })
+    {
+        ddsp::StaticNoiseSynthesizer synthesizer (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        synthesizer.setSynthesisMode (mode);
+        synthesizer.reset();
+        for (int hop = 0; hop < numHops; ++hop)
+            synthesizer.render (steady);
+
+        // The filter is designed once (an inverse and a forward FFT); the rest is per hop.
+        const bool spectral = mode == ddsp::NoiseSynthesisMode::kSpectral;
+        EXPECT_EQ (synthesizer.getNumForwardFFTs(), spectral ? 1 : numHops + 1);
+        EXPECT_EQ (synthesizer.getNumInverseFFTs(), numHops + 1);
+    }
+}
+
+TEST (NoiseSynthesizerTest, MatrixDesignMatchesInverseFFTDesign)
+{
+    constexpr int numHops = 50;
+
+    // The model rate and 48 kHz.
+    for (int hopSize : { ddsp::kModelHopSize, 960 })
+    {
+        ddsp::HostRateNoiseSynthesizer inverseFFT (ddsp::kNoiseAmpsSize, hopSize);
+        ddsp::HostRateNoiseSynthesizer matrix (ddsp::kNoiseAmpsSize, hopSize);
+        matrix.setImpulseResponseDesign (ddsp::ImpulseResponseDesign::kMatrix);
+        inverseFFT.reset();
+        matrix.reset();
+        juce::Random random (29);
+
+        double signalEnergy = 0.0, errorEnergy = 0.0;
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            const auto magnitudes = randomMagnitudes (random);
+            const auto expected = inverseFFT.render (magnitudes);
+            const auto output = matrix.render (magnitudes);
+            for (int i = 0; i < hopSize; ++i)
+            {
+                signalEnergy += expected[i] * expected[i];
+                errorEnergy += (output[i] - expected[i]) * (output[i] - expected[i]);
+            }
+        }
+
+        // Only rounding differs between the two designs.
+        EXPECT_LT (10.0 * std::log10 (errorEnergy / signalEnergy), -100.0) << "hop size " << hopSize;
+    }
+}
+
+TEST (NoiseSynthesizerTest, SeedsPlayUnrelatedNoise)
+{
+    constexpr int numHops = 200;
+    const std::vector<float> magnitudes (ddsp::kNoiseAmpsSize, 1.f);
+
+    for (const auto mode : { ddsp::NoiseSynthesisMode::kTimeDomain, ddsp::NoiseSynthesisMode::kSpectral })
+    {
+        ddsp::StaticNoiseSynthesizer first (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        ddsp::StaticNoiseSynthesizer same (ddsp::kNoiseAmpsSize, ddsp::kModelHopSize);
+        ddsp::StaticNoiseSynthesizer second (
+            ddsp::kNoiseAmpsSize, ddsp::kModelHopSize, ddsp::StaticNoiseSynthesizer::kDefaultSeed + 1);
+        for (auto* synthesizer : { &first, &same, &second })
+        {
+            synthesizer->setSynthesisMode (mode);
+            synthesizer->reset();
+        }
+
+        double product = 0.0, firstEnergy = 0.0, secondEnergy = 0.0;
+        for (int hop = 0; hop < numHops; ++hop)
+        {
+            const auto a = first.render (magnitudes);
+            const auto b = same.render (magnitudes);
+            const auto c = second.render (magnitudes);
+            for (int i = 0; i < ddsp::kModelHopSize; ++i)
+            {
+                ASSERT_EQ (a[i], b[i]);
+                product += a[i] * c[i];
+                firstEnergy += a[i] * a[i];
+                secondEnergy += c[i] * c[i];
+            }
+        }
+
+        // Flat magnitudes leave the noise close to white, so independent streams correlate by about
+        // 1 / sqrt (N) of N samples.
+        const double correlation = product / std::sqrt (firstEnergy * secondEnergy);
+        EXPECT_NEAR (correlation, 0.0, 5.0 / std::sqrt (numHops * ddsp::kModelHopSize));
+    }
+}
@@ -0,0 +1,170 @@
+#include "audio/PolyphaseResampler.h"
+#include "util/Constants.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<float> sine (double frequency_Hz, double sampleRate, int numSamples)
+{
+    std::vector<float> samples (numSamples);
+    for (int n = 0; n < numSamples; ++n)
+        samples[n] = static_cast<float> (std::sin (juce::MathConstants<double>::twoPi * frequency_Hz * n / sampleRate));
+    return samples;
+}
+
+// Level of a sine in the resampler output after the filter has settled, in dB relative to full scale.
+float resampledLevel_dB (double inputRate,
+                         double frequency_Hz,
+                         ddsp::ResamplerQuality quality = ddsp::ResamplerQuality::kStandard,
+                         double outputRate = ddsp::kModelSampleRate_Hz)
+{
+    ddsp::PolyphaseResampler resampler (inputRate, outputRate, quality);
+    const int numInput = static_cast<int> (inputRate);
+    const auto input = sine (frequency_Hz, inputRate, numInput);
+    std::vector<float> output (resampler.getMaxNumOutputSamples (numInput));
+    const int numOutput = resampler.process (input.data(), numInput, output.data());
+
+    double sumOfSquares = 0.0;
+    const int settled = resampler.getMaxNumOutputSamples (2 * resampler.getNumTapsPerPhase());
+    for (int n = settled; n < numOutput; ++n)
+        sumOfSquares += output[n] * output[n];
+    return juce::Decibels::gainToDecibels (static_cast<float> (std::sqrt (2.0 * sumOfSquares / (numOutput - settled))),
+                                           -200.0f);
+}
+
+} // namespace
+
+TEST (PolyphaseResamplerTest, ReducesStandardRatesToSmallRatios)
+{
+    ddsp::PolyphaseResampler from48k (48000.0, ddsp::kModelSampleRate_Hz);
+    EXPECT_EQ (from48k.getUpFactor(), 1);
+    EXPECT_EQ (from48k.getDownFactor(), 3);
+
+    ddsp::PolyphaseResampler from44k (44100.0, ddsp::kModelSampleRate_Hz);
+    EXPECT_EQ (from44k.getUpFactor(), 160);
+    EXPECT_EQ (from44k.getDownFactor(), 441);
+}
+
+TEST (PolyphaseResamplerTest, ProducesAModelHopPerHostHop)
+{
+    for (const double sampleRate : { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 })
+    {
+        ddsp::PolyphaseResampler resampler (sampleRate, ddsp::kModelSampleRate_Hz);
+        const int hopSize = static_cast<int> (sampleRate * ddsp::kModelHopSize / ddsp::kModelSampleRate_Hz);
+        const auto input = sine (440.0, sampleRate, hopSize);
+        std::vector<float> output (resampler.getMaxNumOutputSamples (hopSize));
+
+        for (int hop = 0; hop < 20; ++hop)
+            ASSERT_EQ (resampler.process (input.data(), hopSize, output.data()), ddsp::kModelHopSize) << sampleRate;
+    }
+}
+
+TEST (PolyphaseResamplerTest, OutputDoesNotDependOnChunking)
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int numInput = 10000;
+    juce::Random random (7);
+    std::vector<float> input (numInput);
+    for (auto& sample : input)
+        sample = random.nextFloat() * 2.f - 1.f;
+
+    ddsp::PolyphaseResampler whole (sampleRate, ddsp::kModelSampleRate_Hz);
+    std::vector<float> expected (whole.getMaxNumOutputSamples (numInput));
+    expected.resize (whole.process (input.data(), numInput, expected.data()));
+
+    ddsp::PolyphaseResampler chunked (sampleRate, ddsp::kModelSampleRate_Hz);
+    std::vector<float> output;
+    for (int start = 0, chunk = 1; start < numInput; start += chunk, chunk = chunk * 3 % 1031)
+    {
+        const int numSamples = std::min (chunk, numInput - start);
+        std::vector<float> block (chunked.getMaxNumOutputSamples (numSamples));
+        block.resize (chunked.process (input.data() + start, numSamples, block.data()));
+        output.insert (output.end(), block.begin(), block.end());
+    }
+
+    ASSERT_EQ (output.size(), expected.size());
+    for (size_t i = 0; i < output.size(); ++i)
+        ASSERT_FLOAT_EQ (output[i], expected[i]) << i;
+}
+
+TEST (PolyphaseResamplerTest, PassesBandAndRejectsAliases)
+{
+    struct Expectation
+    {
+        ddsp::ResamplerQuality quality;
+        // Highest frequency passed within 0.05 dB, and the least attenuation above 9 kHz.
+        double passband_Hz;
+        float stopband_dB;
+    };
+    const Expectation expectations[] = { { ddsp::ResamplerQuality::kDraft, 4000.0, -60.0f },
+                                         { ddsp::ResamplerQuality::kStandard, 6000.0, -80.0f },
+                                         { ddsp::ResamplerQuality::kHigh, 6500.0, -100.0f } };
+
+    for (const auto& expectation : expectations)
+    {
+        for (const double sampleRate : { 44100.0, 48000.0 })
+        {
+            for (const double frequency_Hz : { 100.0, 1000.0, expectation.passband_Hz })
+                EXPECT_NEAR (resampledLevel_dB (sampleRate, frequency_Hz, expectation.quality), 0.0f, 0.05f)
+                    << sampleRate << " " << frequency_Hz;
+
+            // Anything that would fold back into the 8 kHz band is gone.
+            for (const double frequency_Hz : { 9000.0, 12000.0, 16000.0, 20000.0 })
+                EXPECT_LT (resampledLevel_dB (sampleRate, frequency_Hz, expectation.quality), expectation.stopband_dB)
+                    << sampleRate << " " << frequency_Hz;
+        }
+    }
+}
+
+TEST (PolyphaseResamplerTest, UpsamplesWithoutImages)
+{
+    constexpr double inputRate = ddsp::kModelSampleRate_Hz;
+    constexpr double outputRate = 48000.0;
+    constexpr double frequency_Hz = 3000.0;
+    constexpr int numInput = static_cast<int> (inputRate);
+
+    ddsp::PolyphaseResampler resampler (inputRate, outputRate);
+    EXPECT_EQ (resampler.getUpFactor(), 3);
+    EXPECT_EQ (resampler.getDownFactor(), 1);
+
+    const auto input = sine (frequency_Hz, inputRate, numInput);
+    std::vector<float> output (resampler.getMaxNumOutputSamples (numInput));
+    const int numOutput = resampler.process (input.data(), numInput, output.data());
+    ASSERT_EQ (numOutput, 3 * numInput);
+
+    // The output is the same sine at the higher rate, delayed by the filter. What is left once that
+    // is subtracted would be the images at 16 kHz +- 3 kHz.
+    const double delay = resampler.getLatencyInInputSamples() / inputRate;
+    double sumOfSquares = 0.0;
+    const int settled = resampler.getMaxNumOutputSamples (2 * resampler.getNumTapsPerPhase());
+    for (int n = settled; n < numOutput; ++n)
+    {
+        const double expected = std::sin (juce::MathConstants<double>::twoPi * frequency_Hz * (n / outputRate - delay));
+        sumOfSquares += (output[n] - expected) * (output[n] - expected);
+    }
+    EXPECT_LT (juce::Decibels::gainToDecibels (
+                   static_cast<float> (std::sqrt (2.0 * sumOfSquares / (numOutput - settled))), -200.0f),
+               -70.0f);
+}
+
+TEST (PolyphaseResamplerTest, SharesFilterTablesBetweenResamplers)
+{
+    ddsp::PolyphaseResampler a (44100.0, ddsp::kModelSampleRate_Hz);
+    ddsp::PolyphaseResampler b (44100.0, ddsp::kModelSampleRate_Hz);
+    ddsp::PolyphaseResampler high (44100.0, ddsp::kModelSampleRate_Hz, ddsp::ResamplerQuality::kHigh);
+    ddsp::PolyphaseResampler other (48000.0, ddsp::kModelSampleRate_Hz);
+
+    EXPECT_EQ (&a.getFilterTable(), &b.getFilterTable());
+    EXPECT_NE (&a.getFilterTable(), &high.getFilterTable());
+    EXPECT_NE (&a.getFilterTable(), &other.getFilterTable());
+
+    // Every branch is aligned and a whole number of lines long.
+    const auto& table = a.getFilterTable();
+    EXPECT_EQ (table.getBranchSize() % ddsp::PolyphaseFilterTable::kFloatsPerAlignment, 0);
+    for (int phase = 0; phase < table.getUpFactor(); ++phase)
+        ASSERT_EQ (reinterpret_cast<std::uintptr_t> (table.getBranch (phase))
+                       % ddsp::PolyphaseFilterTable::kAlignment_bytes,
+                   0u);
+}
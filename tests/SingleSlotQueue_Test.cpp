@@ -0,0 +1,88 @@
+/*
+Copyright 2022 The DDSP-VST Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <array>
+#include <thread>
+
+#include "util/SingleSlotQueue.h"
+
+#include <gtest/gtest.h>
+
+TEST (SingleSlotQueueTest, HoldsOneValueAtATime)
+{
+    ddsp::SingleSlotQueue<int> queue;
+    EXPECT_EQ (queue.prepareToRead(), nullptr);
+
+    int* slot = queue.prepareToWrite();
+    ASSERT_NE (slot, nullptr);
+    *slot = 42;
+    queue.finishedWrite();
+    EXPECT_EQ (queue.prepareToWrite(), nullptr);
+
+    const int* value = queue.prepareToRead();
+    ASSERT_NE (value, nullptr);
+    EXPECT_EQ (*value, 42);
+    queue.finishedRead();
+    EXPECT_EQ (queue.prepareToRead(), nullptr);
+    EXPECT_NE (queue.prepareToWrite(), nullptr);
+
+    queue.finishedWrite();
+    queue.reset();
+    EXPECT_EQ (queue.prepareToRead(), nullptr);
+}
+
+TEST (SingleSlotQueueTest, PassesValuesBetweenThreadsInOrder)
+{
+    constexpr int numValues = 100000;
+    // Large enough that a torn read would show.
+    using Value = std::array<int, 16>;
+    ddsp::SingleSlotQueue<Value> queue;
+
+    std::thread producer (
+        [&]
+        {
+            for (int i = 0; i < numValues;)
+            {
+                if (Value* slot = queue.prepareToWrite())
+                {
+                    slot->fill (i++);
+                    queue.finishedWrite();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+    int numMismatches = 0;
+    for (int i = 0; i < numValues;)
+    {
+        if (const Value* value = queue.prepareToRead())
+        {
+            for (int v : *value)
+                numMismatches += v != i ? 1 : 0;
+            ++i;
+            queue.finishedRead();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    EXPECT_EQ (numMismatches, 0);
+}